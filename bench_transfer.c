@@ -0,0 +1,497 @@
+// bench_transfer.c
+// Banc de mesure des transferts de fichiers : démarre un serveur local puis
+// enchaîne uploads (send_file -> file_transfer_thread) et téléchargements
+// (send_file_to_client -> receive_file_with_port) pour chaque combinaison
+// taille / nombre de transferts simultanés.
+#define _GNU_SOURCE  // Pour nftw
+#include "bench_transfer.h"
+#include <dirent.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static BenchConfig config = {
+    .server_bin = "./bin/server",
+    .workdir = NULL,
+    .repeat = 4,
+    .uploads = 1,
+    .downloads = 1
+};
+
+static pid_t server_pid = -1;
+static char workdir[512];
+static FILE *out;   // Résultats (stdout d'origine, les fonctions du client écrivent sur stdout)
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-b serveur] [-C dossier] [-z tailles] [-c simultanés] [-n répétitions] [-U | -D]\n"
+            "  -z 64K,1M,16M   tailles de fichier (suffixes K, M, G)\n"
+            "  -c 1,4          nombre de transferts simultanés\n"
+            "  -U / -D         uploads seulement / téléchargements seulement\n", prog);
+}
+
+static uint64_t parse_size(const char *s) {
+    char *end;
+    double value = strtod(s, &end);
+    switch (*end) {
+        case 'K': case 'k': value *= 1024; break;
+        case 'M': case 'm': value *= 1024 * 1024; break;
+        case 'G': case 'g': value *= 1024.0 * 1024 * 1024; break;
+    }
+    return (uint64_t)value;
+}
+
+static void format_size(uint64_t size, char *buffer, size_t len) {
+    if (size >= (1ULL << 30) && size % (1ULL << 30) == 0) snprintf(buffer, len, "%lluG", (unsigned long long)(size >> 30));
+    else if (size >= (1ULL << 20) && size % (1ULL << 20) == 0) snprintf(buffer, len, "%lluM", (unsigned long long)(size >> 20));
+    else if (size >= 1024 && size % 1024 == 0) snprintf(buffer, len, "%lluK", (unsigned long long)(size >> 10));
+    else snprintf(buffer, len, "%llu", (unsigned long long)size);
+}
+
+static int parse_list(char *list, int is_size) {
+    int n = 0;
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        if (is_size && n < BENCH_MAX_SIZES) config.sizes[n++] = parse_size(tok);
+        else if (!is_size && n < BENCH_MAX_LEVELS) config.levels[n++] = atoi(tok);
+    }
+    return n;
+}
+
+// Temps CPU et appels système d'un processus (pid 0 : le banc lui-même)
+static BenchUsage read_usage(pid_t pid) {
+    BenchUsage usage = {0, 0};
+    char path[64];
+
+    if (pid == 0) {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        usage.cpu_seconds = (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+                            (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+        snprintf(path, sizeof(path), "/proc/self/io");
+    } else {
+        snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+        FILE *f = fopen(path, "r");
+        if (f) {
+            char line[1024];
+            if (fgets(line, sizeof(line), f)) {
+                // Les champs utime et stime suivent le nom du processus entre parenthèses
+                char *p = strrchr(line, ')');
+                unsigned long utime = 0, stime = 0;
+                if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                                &utime, &stime) == 2) {
+                    usage.cpu_seconds = (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+                }
+            }
+            fclose(f);
+        }
+        snprintf(path, sizeof(path), "/proc/%d/io", (int)pid);
+    }
+
+    FILE *f = fopen(path, "r");
+    if (f) {
+        char key[32];
+        unsigned long long value;
+        while (fscanf(f, "%31[^:]: %llu\n", key, &value) == 2) {
+            if (strcmp(key, "syscr") == 0 || strcmp(key, "syscw") == 0) usage.syscalls += value;
+        }
+        fclose(f);
+    }
+    return usage;
+}
+
+static void empty_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *entry;
+    char path[1024];
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+// Fichier de test au contenu pseudo-aléatoire (non compressible)
+static int make_file(const char *path, uint64_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("Erreur lors de la création du fichier de test");
+        return -1;
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ULL ^ size;
+    uint64_t block[8192];
+    uint64_t left = size;
+    while (left > 0) {
+        for (size_t i = 0; i < sizeof(block) / sizeof(block[0]); i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            block[i] = state;
+        }
+        size_t chunk = left < sizeof(block) ? (size_t)left : sizeof(block);
+        if (fwrite(block, 1, chunk, f) != chunk) {
+            perror("Erreur lors de l'écriture du fichier de test");
+            fclose(f);
+            return -1;
+        }
+        left -= chunk;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int start_server(void) {
+    server_pid = fork();
+    if (server_pid < 0) {
+        perror("Erreur fork");
+        return -1;
+    }
+    if (server_pid == 0) {
+        if (chdir(workdir) < 0) _exit(127);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            close(devnull);
+        }
+        execl(config.server_bin, config.server_bin, (char *)NULL);
+        perror("Erreur exec du serveur");
+        _exit(127);
+    }
+    return 0;
+}
+
+static void stop_server(void) {
+    if (server_pid > 0) {
+        kill(server_pid, SIGINT);
+        waitpid(server_pid, NULL, 0);
+        server_pid = -1;
+    }
+}
+
+// Attend un @file_ready sur la session UDP du client
+static int wait_file_ready(Client *client, int *port) {
+    time_t deadline = time(NULL) + BENCH_READY_TIMEOUT;
+    Request response;
+    while (time(NULL) < deadline) {
+        ssize_t n = recv(client->socket_fd, &response, sizeof(Request), 0);
+        if (n < 0) continue;  // Timeout de la socket (1 s)
+        if (response.type == REQ_COMMAND && strncmp(response.content, "@file_ready ", 12) == 0) {
+            char filename[256];
+            if (sscanf(response.content, "@file_ready %255s %d", filename, port) == 2) return 0;
+        }
+    }
+    return -1;
+}
+
+static void drain_udp(Client *client) {
+    Request response;
+    while (recv(client->socket_fd, &response, sizeof(Request), MSG_DONTWAIT) > 0) {
+    }
+}
+
+static void *bench_worker(void *arg) {
+    BenchWorker *w = (BenchWorker *)arg;
+    pthread_barrier_wait(w->start);
+
+    for (int r = 0; r < w->repeat; r++) {
+        if (w->upload) {
+            if (send_file(w->source, "127.0.0.1") < 0) w->failures++;
+            continue;
+        }
+
+        drain_udp(&w->client);
+        char command[MAX_MSG_SIZE];
+        snprintf(command, sizeof(command), "@download %s", w->source);
+        Request req;
+        init_request(&req, REQ_COMMAND, w->client.username, "", command);
+
+        uint64_t start = metrics_now_ns();
+        int port;
+        if (send_request(&w->client, &req) < 0 || wait_file_ready(&w->client, &port) < 0) {
+            w->failures++;
+            continue;
+        }
+        uint64_t ready = metrics_now_ns() - start;
+
+        if (receive_file_with_port(w->save_dir, "127.0.0.1", port) < 0) {
+            w->failures++;
+        } else {
+            struct stat st;
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", w->save_dir, w->source);
+            if (stat(path, &st) == 0) w->bytes += (uint64_t)st.st_size;
+            pthread_mutex_lock(w->ttfb_mutex);
+            metrics_histogram_add(w->ttfb, ready);
+            pthread_mutex_unlock(w->ttfb_mutex);
+        }
+        empty_dir(w->save_dir);
+    }
+    return NULL;
+}
+
+// Fichiers publiés dans uploads/ (hors zone de transit) ayant la taille attendue
+static int count_published(uint64_t size) {
+    char dir[600];
+    snprintf(dir, sizeof(dir), "%s/uploads", workdir);
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    int count = 0;
+    struct dirent *entry;
+    char path[1024];
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.' || strncmp(entry->d_name, "up_", 3) != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) == 0 && (uint64_t)st.st_size == size) count++;
+    }
+    closedir(d);
+    return count;
+}
+
+static void remove_published_uploads(void) {
+    char dir[600];
+    snprintf(dir, sizeof(dir), "%s/uploads", workdir);
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *entry;
+    char path[1024];
+    while ((entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "up_", 3) != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+static void run_cell(BenchWorker *workers, int upload, uint64_t size, int level) {
+    char size_str[32];
+    format_size(size, size_str, sizeof(size_str));
+
+    char source[600];
+    if (upload) snprintf(source, sizeof(source), "%s/src/up_%s.bin", workdir, size_str);
+    else snprintf(source, sizeof(source), "dl_%s.bin", size_str);
+
+    MetricsHistogramData *ttfb = calloc(1, sizeof(MetricsHistogramData));
+    if (!ttfb) return;
+    pthread_mutex_t ttfb_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned int)level + 1);
+
+    pthread_t threads[level];
+    for (int i = 0; i < level; i++) {
+        BenchWorker *w = &workers[i];
+        w->source = source;
+        w->upload = upload;
+        w->repeat = config.repeat;
+        w->failures = 0;
+        w->bytes = 0;
+        w->ttfb = ttfb;
+        w->ttfb_mutex = &ttfb_mutex;
+        w->start = &start;
+        pthread_create(&threads[i], NULL, bench_worker, w);
+    }
+
+    BenchUsage server_before = read_usage(server_pid);
+    BenchUsage self_before = read_usage(0);
+    uint64_t t0 = metrics_now_ns();
+    pthread_barrier_wait(&start);
+
+    int failures = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < level; i++) {
+        pthread_join(threads[i], NULL);
+        failures += workers[i].failures;
+        bytes += workers[i].bytes;
+    }
+
+    // Un upload n'est terminé qu'une fois publié par le serveur
+    if (upload) {
+        int expected = level * config.repeat - failures;
+        time_t deadline = time(NULL) + BENCH_PUBLISH_TIMEOUT;
+        int published;
+        while ((published = count_published(size)) < expected && time(NULL) < deadline) {
+            usleep(1000);
+        }
+        failures = level * config.repeat - published;
+        bytes = (uint64_t)published * size;
+    }
+
+    uint64_t elapsed = metrics_now_ns() - t0;
+    BenchUsage server_after = read_usage(server_pid);
+    BenchUsage self_after = read_usage(0);
+
+    double mb = (double)bytes / (1024.0 * 1024.0);
+    double gb = mb / 1024.0;
+    double secs = (double)elapsed / 1e9;
+
+    fprintf(out, "%-8s %-6s %4d %6d %5d %9.1f %10.2f %10.2f %10.1f %10.1f",
+            upload ? "upload" : "download", size_str, level, level * config.repeat, failures,
+            secs > 0 ? mb / secs : 0.0,
+            gb > 0 ? (server_after.cpu_seconds - server_before.cpu_seconds) / gb : 0.0,
+            gb > 0 ? (self_after.cpu_seconds - self_before.cpu_seconds) / gb : 0.0,
+            mb > 0 ? (double)(server_after.syscalls - server_before.syscalls) / mb : 0.0,
+            mb > 0 ? (double)(self_after.syscalls - self_before.syscalls) / mb : 0.0);
+    if (upload || ttfb->count == 0) {
+        fprintf(out, " %9s %9s\n", "-", "-");
+    } else {
+        fprintf(out, " %9.2f %9.2f\n", metrics_percentile(ttfb, 0.50) / 1e6,
+                metrics_percentile(ttfb, 0.99) / 1e6);
+    }
+    fflush(out);
+
+    if (upload) remove_published_uploads();
+    pthread_barrier_destroy(&start);
+    free(ttfb);
+}
+
+int main(int argc, char *argv[]) {
+    char sizes[] = "64K,1M,16M";
+    char levels[] = "1,4";
+    config.nb_sizes = parse_list(sizes, 1);
+    config.nb_levels = parse_list(levels, 0);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:C:z:c:n:UDh")) != -1) {
+        switch (opt) {
+            case 'b': config.server_bin = optarg; break;
+            case 'C': config.workdir = optarg; break;
+            case 'z': config.nb_sizes = parse_list(optarg, 1); break;
+            case 'c': config.nb_levels = parse_list(optarg, 0); break;
+            case 'n': config.repeat = atoi(optarg); break;
+            case 'U': config.downloads = 0; break;
+            case 'D': config.uploads = 0; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (config.nb_sizes == 0 || config.nb_levels == 0 || config.repeat < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int max_level = 0;
+    for (int i = 0; i < config.nb_levels; i++) {
+        if (config.levels[i] < 1) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (config.levels[i] > max_level) max_level = config.levels[i];
+    }
+
+    // Chemin absolu du serveur : il est lancé depuis le dossier de travail
+    char server_path[PATH_MAX];
+    if (!realpath(config.server_bin, server_path)) {
+        perror("Serveur introuvable");
+        return EXIT_FAILURE;
+    }
+    config.server_bin = server_path;
+
+    if (config.workdir) {
+        snprintf(workdir, sizeof(workdir), "%s", config.workdir);
+        mkdir(workdir, 0755);
+    } else {
+        snprintf(workdir, sizeof(workdir), "/tmp/bench_transfer.XXXXXX");
+        if (!mkdtemp(workdir)) {
+            perror("Erreur mkdtemp");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Fichiers de test : sources des uploads et fichiers servis aux téléchargements
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/src", workdir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/uploads", workdir);
+    mkdir(path, 0755);
+    for (int s = 0; s < config.nb_sizes; s++) {
+        char size_str[32];
+        format_size(config.sizes[s], size_str, sizeof(size_str));
+        snprintf(path, sizeof(path), "%s/src/up_%s.bin", workdir, size_str);
+        if (make_file(path, config.sizes[s]) < 0) return EXIT_FAILURE;
+        snprintf(path, sizeof(path), "%s/uploads/dl_%s.bin", workdir, size_str);
+        if (make_file(path, config.sizes[s]) < 0) return EXIT_FAILURE;
+    }
+
+    // Les fonctions du client écrivent sur stdout : résultats sur une copie
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || !freopen("/dev/null", "w", stdout)) {
+        perror("Erreur redirection stdout");
+        return EXIT_FAILURE;
+    }
+
+    if (start_server() < 0) return EXIT_FAILURE;
+
+    BenchWorker *workers = calloc((size_t)max_level, sizeof(BenchWorker));
+    if (!workers) {
+        stop_server();
+        return EXIT_FAILURE;
+    }
+
+    // Une session UDP par client (nécessaire pour @download)
+    for (int i = 0; i < max_level; i++) {
+        BenchWorker *w = &workers[i];
+        w->id = i;
+        snprintf(w->save_dir, sizeof(w->save_dir), "%s/recv%d", workdir, i);
+        mkdir(w->save_dir, 0755);
+
+        char username[50];
+        snprintf(username, sizeof(username), "bench%d", i);
+        int connected = -1;
+        for (int attempt = 0; attempt < 10 && connected < 0; attempt++) {
+            if (init_client(&w->client, "127.0.0.1") < 0) break;
+            connected = connect_to_server(&w->client, username, BENCH_PASSWORD);
+            if (connected < 0) {
+                close(w->client.socket_fd);
+                usleep(200000);  // Serveur en cours de démarrage
+            }
+        }
+        if (connected < 0) {
+            fprintf(stderr, "Connexion au serveur impossible (%s)\n", username);
+            stop_server();
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(out, "# bench_transfer repeat=%d\n", config.repeat);
+    fprintf(out, "# syscalls = syscr+syscw de /proc/<pid>/io ; ttfb = délai jusqu'à @file_ready\n");
+    fprintf(out, "%-8s %-6s %4s %6s %5s %9s %10s %10s %10s %10s %9s %9s\n",
+            "op", "size", "conc", "files", "fail", "MB/s", "srv_cpu/GB", "cli_cpu/GB",
+            "srv_sc/MB", "cli_sc/MB", "ttfb_p50", "ttfb_p99");
+
+    for (int pass = 0; pass < 2; pass++) {
+        int upload = (pass == 0);
+        if ((upload && !config.uploads) || (!upload && !config.downloads)) continue;
+        for (int s = 0; s < config.nb_sizes; s++) {
+            for (int l = 0; l < config.nb_levels; l++) {
+                run_cell(workers, upload, config.sizes[s], config.levels[l]);
+            }
+        }
+    }
+
+    for (int i = 0; i < max_level; i++) {
+        Request req;
+        init_request(&req, REQ_DISCONNECT, workers[i].client.username, "", "");
+        send_request(&workers[i].client, &req);
+        close(workers[i].client.socket_fd);
+    }
+    stop_server();
+    free(workers);
+    fclose(out);
+
+    // Le dossier temporaire n'est conservé que s'il a été choisi avec -C
+    if (!config.workdir) nftw(workdir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return EXIT_SUCCESS;
+}
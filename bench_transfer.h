@@ -0,0 +1,50 @@
+// bench_transfer.h
+#ifndef BENCH_TRANSFER_H
+#define BENCH_TRANSFER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "client.h"
+#include "metrics.h"
+
+#define BENCH_MAX_SIZES        16
+#define BENCH_MAX_LEVELS       16
+#define BENCH_PASSWORD         "bench"
+#define BENCH_READY_TIMEOUT    10   // Attente maximale de @file_ready (secondes)
+#define BENCH_PUBLISH_TIMEOUT  60   // Attente maximale de la publication des uploads (secondes)
+
+// Paramètres de la campagne de mesure
+typedef struct {
+    const char *server_bin;    // Binaire du serveur démarré localement
+    const char *workdir;       // Dossier de travail du serveur (temporaire par défaut)
+    uint64_t sizes[BENCH_MAX_SIZES];
+    int nb_sizes;
+    int levels[BENCH_MAX_LEVELS];   // Nombre de transferts simultanés
+    int nb_levels;
+    int repeat;                // Transferts par client et par cellule
+    int uploads;               // 1 : mesurer les uploads
+    int downloads;             // 1 : mesurer les téléchargements
+} BenchConfig;
+
+// Consommation d'un processus (/proc/<pid>/stat et /proc/<pid>/io)
+typedef struct {
+    double cpu_seconds;
+    uint64_t syscalls;         // syscr + syscw (read/write et apparentés)
+} BenchUsage;
+
+// Client de mesure : une session UDP par client pour les téléchargements
+typedef struct {
+    int id;
+    Client client;
+    char save_dir[600];
+    const char *source;        // Fichier à envoyer (upload) ou nom à télécharger
+    int upload;
+    int repeat;
+    int failures;
+    uint64_t bytes;
+    MetricsHistogramData *ttfb; // Temps jusqu'à @file_ready (téléchargements)
+    pthread_mutex_t *ttfb_mutex;
+    pthread_barrier_t *start;
+} BenchWorker;
+
+#endif /* BENCH_TRANSFER_H */
@@ -0,0 +1,48 @@
+// command_table.h
+// Généré par gen_commands.awk depuis commands.def : ne pas modifier.
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#define COMMAND_COUNT      23
+#define COMMAND_HASH_SEED  2u
+#define COMMAND_HASH_SIZE  128
+
+static const Command commands[COMMAND_COUNT] = {
+    {"help", cmd_help, "Affiche la liste des commandes disponibles", ROLE_USER},
+    {"ping", cmd_ping, "Test de connectivité avec le serveur", ROLE_USER},
+    {"msg", cmd_msg, "Envoie un message privé (@msg <user> <message>)", ROLE_USER},
+    {"credits", cmd_credits, "Affiche les crédits de l'application", ROLE_USER},
+    {"shutdown", cmd_shutdown, "Arrête le serveur (admin uniquement)", ROLE_ADMIN},
+    {"list", cmd_list, "Affiche la liste des utilisateurs connectés (@list [curseur])", ROLE_USER},
+    {"download", cmd_download, "Télécharge un des fichiers du serveur pour le client", ROLE_USER},
+    {"upload", cmd_upload, "Envoie un fichier sur le serveur", ROLE_USER},
+    {"promote", cmd_promote, "Promeut un utilisateur au rang de modérateur (admin uniquement)", ROLE_ADMIN},
+    {"disconnect", cmd_disconnect, "Déconnecte explicitement du serveur", ROLE_USER},
+    {"presence", cmd_presence, "Choisit les arrivées et départs annoncés (@presence [tous|salon|contacts|aucun|+user|-user])", ROLE_USER},
+    {"files", cmd_files, "Affiche la liste des fichiers disponibles sur le serveur (@files [préfixe] [curseur])", ROLE_USER},
+    {"mute", cmd_mute, "Rend muet un utilisateur pendant une durée spécifiée (@mute <user> <minutes>)", ROLE_MODERATOR},
+    {"unmute", cmd_unmute, "Annule le mode muet d'un utilisateur (@unmute <user>)", ROLE_MODERATOR},
+    {"create", cmd_create, "Crée un nouveau salon (@create <nom_salon>)", ROLE_USER},
+    {"join", cmd_join, "Rejoint un salon et en fait le salon courant, sans quitter les autres (@join <nom_salon>)", ROLE_USER},
+    {"leave", cmd_leave, "Quitte un salon suivi, le salon courant par défaut (@leave [nom_salon])", ROLE_USER},
+    {"delete", cmd_delete, "Supprime un salon (créateur uniquement) (@delete <nom_salon>)", ROLE_USER},
+    {"rooms", cmd_rooms, "Affiche la liste des salons disponibles (@rooms [curseur])", ROLE_USER},
+    {"info", cmd_info, "Affiche les informations sur votre état actuel", ROLE_USER},
+    {"search", cmd_search, "Recherche dans l'historique d'un salon (@search <salon> <termes>)", ROLE_USER},
+    {"metrics", cmd_metrics, "Affiche les métriques du serveur (admin uniquement)", ROLE_ADMIN},
+    {"stats", cmd_stats, "Affiche la charge actuelle du serveur (admin uniquement)", ROLE_ADMIN}
+};
+
+// Emplacement -> indice + 1 dans commands (0 : aucune commande)
+static const unsigned char command_slots[COMMAND_HASH_SIZE] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 0, 0, 16, 22, 0, 0,
+    0, 18, 0, 0, 0, 0, 0, 0, 5, 3, 0, 0, 0, 0, 6, 0,
+    0, 9, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 21, 0,
+    0, 0, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 19, 7, 0, 0, 0, 0, 0, 0, 13, 0, 0, 0, 10, 0, 23,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 1, 17, 0, 0,
+    0, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 15, 0, 20, 0, 0, 0, 0,
+};
+
+#endif /* COMMAND_TABLE_H */
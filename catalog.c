@@ -0,0 +1,306 @@
+// catalog.c
+#include "catalog.h"
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+// Catalogue trié par nom : recherche dichotomique et pagination par préfixe
+static struct {
+    pthread_rwlock_t lock;
+    CatalogEntry *entries;
+    int count;
+    int capacity;
+
+    char dir[256];
+    int inotify_fd;
+    pthread_t thread;
+    int started;
+} catalog = { .inotify_fd = -1 };
+
+uint64_t catalog_digest_update(uint64_t digest, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        digest ^= p[i];
+        digest *= 1099511628211ULL;
+    }
+    return digest;
+}
+
+// Calcule l'empreinte d'un fichier existant
+static int digest_file(const char *path, uint64_t *digest) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    unsigned char buffer[64 * 1024];
+    size_t n;
+    uint64_t h = CATALOG_DIGEST_INIT;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        h = catalog_digest_update(h, buffer, n);
+    }
+    fclose(f);
+    *digest = h;
+    return 0;
+}
+
+// Position de name, ou position d'insertion si absent (*found à 0)
+static int catalog_search(const char *name, int *found) {
+    int lo = 0, hi = catalog.count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(catalog.entries[mid].name, name);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *found = 0;
+    return lo;
+}
+
+// Insertion ou remplacement (verrou d'écriture tenu)
+static void catalog_upsert_locked(const CatalogEntry *entry) {
+    int found;
+    int pos = catalog_search(entry->name, &found);
+    if (found) {
+        catalog.entries[pos] = *entry;
+        return;
+    }
+
+    if (catalog.count >= catalog.capacity) {
+        int new_capacity = catalog.capacity ? catalog.capacity * 2 : 64;
+        CatalogEntry *new_entries = realloc(catalog.entries, sizeof(CatalogEntry) * new_capacity);
+        if (!new_entries) {
+            perror("Échec realloc catalogue");
+            return;
+        }
+        catalog.entries = new_entries;
+        catalog.capacity = new_capacity;
+    }
+
+    memmove(&catalog.entries[pos + 1], &catalog.entries[pos],
+            sizeof(CatalogEntry) * (size_t)(catalog.count - pos));
+    catalog.entries[pos] = *entry;
+    catalog.count++;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const CatalogEntry *)a)->name, ((const CatalogEntry *)b)->name);
+}
+
+// Lit les métadonnées d'un fichier du dossier. Si known est fourni et que la
+// taille et la date n'ont pas changé, l'empreinte existante est conservée.
+static int build_entry(const char *name, CatalogEntry *entry, const CatalogEntry *known) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", catalog.dir, name);
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+
+    if (known && known->size == st.st_size && known->mtime == st.st_mtime) {
+        entry->digest = known->digest;
+        return 0;
+    }
+    return digest_file(path, &entry->digest);
+}
+
+// Reconstruit entièrement le catalogue à partir du dossier
+static void catalog_rescan(void) {
+    DIR *dir = opendir(catalog.dir);
+    if (!dir) return;
+
+    CatalogEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *d;
+    while ((d = readdir(dir)) != NULL) {
+        // Ignorer ".", ".." et la zone de transit des uploads
+        if (d->d_name[0] == '.') continue;
+
+        if (count >= capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            CatalogEntry *tmp = realloc(entries, sizeof(CatalogEntry) * new_capacity);
+            if (!tmp) break;
+            entries = tmp;
+            capacity = new_capacity;
+        }
+        if (build_entry(d->d_name, &entries[count], NULL) == 0) count++;
+    }
+    closedir(dir);
+
+    qsort(entries, (size_t)count, sizeof(CatalogEntry), compare_entries);
+
+    pthread_rwlock_wrlock(&catalog.lock);
+    free(catalog.entries);
+    catalog.entries = entries;
+    catalog.count = count;
+    catalog.capacity = capacity;
+    pthread_rwlock_unlock(&catalog.lock);
+}
+
+// Applique un événement inotify sur un fichier du dossier
+static void catalog_refresh(const char *name, int removed) {
+    if (name[0] == '.') return;
+
+    if (removed) {
+        catalog_remove(name);
+        return;
+    }
+
+    CatalogEntry known;
+    int have_known = (catalog_lookup(name, &known) == 0);
+
+    // L'empreinte est calculée hors verrou
+    CatalogEntry entry;
+    if (build_entry(name, &entry, have_known ? &known : NULL) != 0) {
+        catalog_remove(name);
+        return;
+    }
+
+    pthread_rwlock_wrlock(&catalog.lock);
+    catalog_upsert_locked(&entry);
+    pthread_rwlock_unlock(&catalog.lock);
+}
+
+// Suit les modifications faites dans le dossier en dehors du serveur
+static void *catalog_watch_thread(void *arg) {
+    (void)arg;
+    char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (running) {
+        struct pollfd pfd = { .fd = catalog.inotify_fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, 1000);  // Vérifier running toutes les secondes
+        if (ready <= 0) continue;
+
+        ssize_t len = read(catalog.inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) continue;
+
+        for (char *p = buffer; p < buffer + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Des événements ont été perdus : tout relire
+                catalog_rescan();
+                continue;
+            }
+            if (ev->len == 0 || (ev->mask & IN_ISDIR)) continue;
+
+            catalog_refresh(ev->name, (ev->mask & (IN_DELETE | IN_MOVED_FROM)) != 0);
+        }
+    }
+    return NULL;
+}
+
+int init_file_catalog(const char *dir) {
+    strncpy(catalog.dir, dir, sizeof(catalog.dir) - 1);
+    catalog.dir[sizeof(catalog.dir) - 1] = '\0';
+    pthread_rwlock_init(&catalog.lock, NULL);
+
+    mkdir(dir, 0755);
+    catalog_rescan();
+    printf("Catalogue des fichiers: %d fichier(s)\n", catalog.count);
+
+    catalog.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (catalog.inotify_fd < 0 ||
+        inotify_add_watch(catalog.inotify_fd, dir,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        perror("Erreur inotify (les modifications externes ne seront pas suivies)");
+        if (catalog.inotify_fd >= 0) close(catalog.inotify_fd);
+        catalog.inotify_fd = -1;
+        return 0; // Non fatal, le catalogue reste à jour pour les uploads du serveur
+    }
+
+    if (pthread_create(&catalog.thread, NULL, catalog_watch_thread, NULL) != 0) {
+        perror("Erreur lors de la création du thread du catalogue");
+        close(catalog.inotify_fd);
+        catalog.inotify_fd = -1;
+        return 0;
+    }
+    catalog.started = 1;
+    return 0;
+}
+
+void shutdown_file_catalog(void) {
+    if (catalog.started) {
+        pthread_join(catalog.thread, NULL);
+        catalog.started = 0;
+    }
+    if (catalog.inotify_fd >= 0) {
+        close(catalog.inotify_fd);
+        catalog.inotify_fd = -1;
+    }
+    free(catalog.entries);
+    catalog.entries = NULL;
+    catalog.count = catalog.capacity = 0;
+    pthread_rwlock_destroy(&catalog.lock);
+}
+
+void catalog_upsert(const char *name, off_t size, time_t mtime, uint64_t digest) {
+    CatalogEntry entry;
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.size = size;
+    entry.mtime = mtime;
+    entry.digest = digest;
+
+    pthread_rwlock_wrlock(&catalog.lock);
+    catalog_upsert_locked(&entry);
+    pthread_rwlock_unlock(&catalog.lock);
+}
+
+void catalog_remove(const char *name) {
+    pthread_rwlock_wrlock(&catalog.lock);
+    int found;
+    int pos = catalog_search(name, &found);
+    if (found) {
+        memmove(&catalog.entries[pos], &catalog.entries[pos + 1],
+                sizeof(CatalogEntry) * (size_t)(catalog.count - pos - 1));
+        catalog.count--;
+    }
+    pthread_rwlock_unlock(&catalog.lock);
+}
+
+int catalog_lookup(const char *name, CatalogEntry *entry) {
+    pthread_rwlock_rdlock(&catalog.lock);
+    int found;
+    int pos = catalog_search(name, &found);
+    if (found && entry) *entry = catalog.entries[pos];
+    pthread_rwlock_unlock(&catalog.lock);
+    return found ? 0 : -1;
+}
+
+int catalog_list(const char *prefix, int offset, CatalogEntry *entries, int max, int *total) {
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    int found;
+
+    pthread_rwlock_rdlock(&catalog.lock);
+
+    // Les noms qui partagent un préfixe sont contigus dans le tableau trié
+    int first = 0, last = catalog.count;
+    if (prefix_len) {
+        first = catalog_search(prefix, &found);
+        // Premier nom situé après tous ceux qui commencent par le préfixe
+        int lo = first, hi = catalog.count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (strncmp(catalog.entries[mid].name, prefix, prefix_len) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        last = lo;
+    }
+
+    int n = 0;
+    for (int i = first + offset; i < last && n < max; i++) {
+        entries[n++] = catalog.entries[i];
+    }
+    if (total) *total = last - first;
+
+    pthread_rwlock_unlock(&catalog.lock);
+    return n;
+}
@@ -0,0 +1,39 @@
+// catalog.h
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+#include <time.h>
+#include "common.h"
+
+#define CATALOG_LIST_BATCH   32  // Entrées copiées par appel à catalog_list depuis @files
+#define CATALOG_DIGEST_INIT  14695981039346656037ULL
+
+// Entrée du catalogue des fichiers partagés
+typedef struct {
+    char name[256];
+    off_t size;
+    time_t mtime;
+    uint64_t digest;   // Empreinte FNV-1a 64 bits du contenu
+} CatalogEntry;
+
+// Construit le catalogue à partir du dossier puis le garde synchronisé (inotify)
+int  init_file_catalog(const char *dir);
+void shutdown_file_catalog(void);
+
+// Met à jour l'empreinte avec un bloc de données (calcul incrémental)
+uint64_t catalog_digest_update(uint64_t digest, const void *data, size_t len);
+
+// Ajoute ou remplace une entrée (appelé après la publication d'un upload)
+void catalog_upsert(const char *name, off_t size, time_t mtime, uint64_t digest);
+void catalog_remove(const char *name);
+
+// Retourne 0 et copie l'entrée si le fichier existe, -1 sinon
+int  catalog_lookup(const char *name, CatalogEntry *entry);
+
+// Copie jusqu'à max entrées dont le nom commence par prefix, à partir de la
+// position offset parmi les résultats triés. Retourne le nombre copié et
+// renseigne le nombre total de fichiers correspondants.
+int  catalog_list(const char *prefix, int offset, CatalogEntry *entries, int max, int *total);
+
+#endif /* CATALOG_H */
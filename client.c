@@ -129,6 +129,11 @@ int init_client(Client *client, const char *server_ip) {
     
     // Initialiser le salon courant comme vide
     client->current_room[0] = '\0';
+    client->last_sent = 0;
+    
+    // Réception fiable désactivée par défaut (--reliable)
+    memset(&client->rx, 0, sizeof(client->rx));
+    pthread_mutex_init(&client->rx.lock, NULL);
     
     // Le gestionnaire de signal est déjà configuré dans common.c
     // Pas besoin de réinitialiser ici
@@ -136,6 +141,26 @@ int init_client(Client *client, const char *server_ip) {
     return 0;
 }
 
+static uint64_t client_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Renseigne l'acquittement cumulatif et sélectif. Appelé avec rx.lock verrouillé.
+static void fill_ack(ReliableReceiver *rx, Request *req) {
+    req->flags |= REQ_FLAG_RELIABLE;
+    req->ack = rx->next_seq ? rx->next_seq - 1 : 0;
+    req->sack = 0;
+    if (rx->next_seq == 0) return;
+    for (uint32_t i = 0; i < RELIABLE_SACK_BITS && i + 1 < RELIABLE_REORDER_WINDOW; i++) {
+        uint32_t seq = rx->next_seq + 1 + i;
+        Request *p = rx->pending[seq % RELIABLE_REORDER_WINDOW];
+        if (p && p->seq == seq) req->sack |= 1u << i;
+    }
+    rx->unacked = 0;
+}
+
 int connect_to_server(Client *client, const char *username, const char *password) {
     // Enregistrer les informations d'identification
     strncpy(client->username, username, sizeof(client->username) - 1);
@@ -169,6 +194,16 @@ int connect_to_server(Client *client, const char *username, const char *password
         return -1;
     }
     
+    // Session fiable : la première réponse fixe la session et le numéro de départ
+    if (client->rx.enabled && (response.flags & REQ_FLAG_RESYNC)) {
+        pthread_mutex_lock(&client->rx.lock);
+        client->rx.session = response.sack;
+        client->rx.next_seq = response.seq + 1;
+        client->rx.unacked = 1;
+        client->rx.first_unacked_ms = client_now_ms();
+        pthread_mutex_unlock(&client->rx.lock);
+    }
+    
     // Vérifier si la connexion a été acceptée
     if (strstr(response.content, "Erreur:") != NULL) {
         printf("\n[SERVER ERROR] %s\n", response.content);
@@ -196,6 +231,13 @@ int connect_to_server(Client *client, const char *username, const char *password
 }
 
 int send_request(Client *client, Request *req) {
+    // Session fiable : chaque requête porte l'acquittement des réponses reçues
+    if (client->rx.enabled) {
+        pthread_mutex_lock(&client->rx.lock);
+        fill_ack(&client->rx, req);
+        pthread_mutex_unlock(&client->rx.lock);
+    }
+    
     // Envoyer la requête au serveur
     ssize_t sent = sendto(client->socket_fd, req, sizeof(Request), 0,
                           (struct sockaddr*)&client->server_addr, 
@@ -205,6 +247,7 @@ int send_request(Client *client, Request *req) {
         perror("Erreur lors de l'envoi de la requête");
         return -1;
     }
+    __atomic_store_n(&client->last_sent, time(NULL), __ATOMIC_RELAXED);
     
     return 0;
 }
@@ -590,8 +633,14 @@ void *send_message_thread(void *arg) {
                     if (strncmp(buffer, "@disconnect", 11) == 0) {
                         running = 0;
                     }
+                } else if (buffer[0] == '#' && strchr(buffer, ' ')) {
+                    // "#salon message" : message pour un autre salon suivi
+                    char *text = strchr(buffer, ' ');
+                    *text++ = '\0';
+                    init_request(&req, REQ_MESSAGE, client->username, buffer + 1, text);
+                    send_request(client, &req);
                 } else {
-                    // C'est un message normal
+                    // C'est un message normal (salon courant)
                     init_request(&req, REQ_MESSAGE, client->username, "", buffer);
                     send_request(client, &req);
                 }
@@ -605,6 +654,12 @@ void *send_message_thread(void *arg) {
         
         // Vérifier si le thread doit se terminer
         if (!running) break;
+        
+        // Signal de présence si rien n'a été envoyé depuis HEARTBEAT_INTERVAL
+        if (time(NULL) - __atomic_load_n(&client->last_sent, __ATOMIC_RELAXED) >= HEARTBEAT_INTERVAL) {
+            init_request(&req, REQ_HEARTBEAT, client->username, "", "");
+            send_request(client, &req);
+        }
     }
     
     // Envoyer un message de déconnexion avant de quitter
@@ -614,6 +669,253 @@ void *send_message_thread(void *arg) {
     return NULL;
 }
 
+// Traite une réponse du serveur (dans l'ordre d'émission pour une session fiable)
+static void handle_response(Client *client, Request *response) {
+    Request ack_response;
+    
+    // Sonde de présence du serveur : répondre sans rien afficher
+    if (response->type == REQ_COMMAND && strcmp(response->content, "@keepalive") == 0) {
+        init_request(&ack_response, REQ_ACK, client->username, "", "keepalive");
+        send_request(client, &ack_response);
+        return;
+    }
+    
+    // Vérifier s'il s'agit d'une notification de fichier à télécharger
+    if (response->type == REQ_COMMAND && strncmp(response->content, "@file_ready ", 12) == 0) {
+        // Effacer la ligne actuelle
+        printf("\r                                                                               \r");
+        printf("Notification: Fichier prêt à être téléchargé.\n");
+        
+        // Extraire le nom du fichier et le port à utiliser
+        char filename[256];
+        int port = FILE_TRANSFER_PORT; // Port par défaut
+        
+        // Essayer d'obtenir le port personnalisé
+        if (sscanf(response->content, "@file_ready %255s %d", filename, &port) >= 1) {
+            printf("Préparation du téléchargement du fichier %s sur le port %d en arrière-plan\n", filename, port);
+        }
+        
+        // Télécharger le fichier en arrière-plan
+        char download_dir[256] = "./downloads"; // Dossier par défaut
+        
+        // Créer le dossier s'il n'existe pas
+        mkdir(download_dir, 0755);
+        
+        // Lancer le thread de téléchargement
+        pthread_t download_thread;
+        FileTransferThreadArgs *args = malloc(sizeof(FileTransferThreadArgs));
+        if (args) {
+            strncpy(args->filename, filename, sizeof(args->filename) - 1);
+            args->filename[sizeof(args->filename) - 1] = '\0';
+            strncpy(args->server_ip, inet_ntoa(client->server_addr.sin_addr), sizeof(args->server_ip) - 1);
+            args->server_ip[sizeof(args->server_ip) - 1] = '\0';
+            strncpy(args->save_dir, download_dir, sizeof(args->save_dir) - 1);
+            args->save_dir[sizeof(args->save_dir) - 1] = '\0';
+            args->port = port;
+            args->is_upload = 0;
+            
+            if (pthread_create(&download_thread, NULL, file_transfer_thread, args) != 0) {
+                perror("Erreur lors de la création du thread de téléchargement");
+                free(args);
+            } else {
+                pthread_detach(download_thread);
+            }
+        } else {
+            perror("Erreur d'allocation mémoire");
+        }
+        
+        // Réafficher le prompt
+        char prompt[100];
+        get_custom_prompt(client, prompt, sizeof(prompt));
+        printf("%s", prompt);
+        fflush(stdout);
+    } else {
+        // Vérifier s'il s'agit d'une réponse à une commande de salon
+        if (response->type == REQ_MESSAGE && strcmp(response->sender, "Server") == 0) {
+            // Détecter les messages de confirmation de salon
+            if (strstr(response->content, "Vous avez rejoint le salon") != NULL) {
+                // Extraire le nom du salon de la réponse
+                char *start = strstr(response->content, "'");
+                if (start) {
+                    start++; // Ignorer la première apostrophe
+                    char *end = strstr(start, "'");
+                    if (end) {
+                        char room_name[50];
+                        int len = end - start;
+                        if (len > 0 && len < 49) {
+                            strncpy(room_name, start, len);
+                            room_name[len] = '\0';
+                            update_current_room(client, room_name);
+                        }
+                    }
+                }
+            } else if (strstr(response->content, "Vous avez quitté le salon") != NULL) {
+                // Seul le départ du salon courant le vide : les autres salons suivis restent
+                char *start = strchr(response->content, '\'');
+                size_t len = strlen(client->current_room);
+                if (start && len > 0 && strncmp(start + 1, client->current_room, len) == 0 &&
+                    start[1 + len] == '\'') {
+                    update_current_room(client, "");
+                }
+            } else if (strstr(response->content, "créé avec succès") != NULL && 
+                      strstr(response->content, "Salon") != NULL) {
+                // Extraire le nom du salon créé
+                char *start = strstr(response->content, "'");
+                if (start) {
+                    start++;
+                    char *end = strstr(start, "'");
+                    if (end) {
+                        char room_name[50];
+                        int len = end - start;
+                        if (len > 0 && len < 49) {
+                            strncpy(room_name, start, len);
+                            room_name[len] = '\0';
+                            // Le créateur rejoint automatiquement son salon
+                            update_current_room(client, room_name);
+                        }
+                    }
+                }
+            } 
+            // AJOUT: Détecter les informations utilisateur (@info)
+            else if (strstr(response->content, "=== INFORMATIONS UTILISATEUR ===") != NULL) {
+                // Chercher l'information sur le salon courant
+                char *salon_line = strstr(response->content, "Salon courant: ");
+                if (salon_line) {
+                    salon_line += 15; // Avancer après "Salon courant: "
+                    
+                    // Vérifier si le salon est "Aucun"
+                    if (strncmp(salon_line, "Aucun", 5) == 0) {
+                        // L'utilisateur n'est dans aucun salon
+                        update_current_room(client, "");
+                    } else {
+                        // Extraire le nom du salon
+                        char salon[50] = "";
+                        int i = 0;
+                        
+                        // Copier jusqu'à rencontrer un '\n' ou un '\0'
+                        while (salon_line[i] && salon_line[i] != '\n' && i < 49) {
+                            salon[i] = salon_line[i];
+                            i++;
+                        }
+                        salon[i] = '\0';
+                        
+                        // Mettre à jour le salon courant
+                        update_current_room(client, salon);
+                    }
+                }
+            }
+        }
+        
+        // Effacer la ligne actuelle avant d'afficher un nouveau message
+        printf("\r                                                                               \r");
+        
+        // Traitement normal des messages
+        // Si c'est un message du serveur, on garde le format actuel
+        if (strcmp(response->sender, "Server") == 0) {
+            printf("[%s] %s\n", response->sender, response->content);
+        } 
+        // Si c'est un message d'un utilisateur, on ajoute ": " après le nom d'utilisateur
+        else {
+            // Le serveur indique le salon du message, le client pouvant en suivre plusieurs
+            printf("[%s] %s: %s\n", response->recipient[0] ? response->recipient : client->current_room,
+                   response->sender, response->content);
+        }
+        
+        // Réafficher le prompt avec le salon courant
+        char prompt[100];
+        get_custom_prompt(client, prompt, sizeof(prompt));
+        printf("%s", prompt);
+        fflush(stdout);
+    }
+}
+
+static void send_ack(Client *client) {
+    Request ack;
+    init_request(&ack, REQ_ACK, client->username, "", "");
+    send_request(client, &ack);
+}
+
+// Réordonne un datagramme numéroté puis délivre tout ce qui est devenu contigu
+static void receive_reliable(Client *client, Request *pkt) {
+    ReliableReceiver *rx = &client->rx;
+    Request *ready[2 * RELIABLE_REORDER_WINDOW + 1];
+    int nb_ready = 0;
+    int ack_now = 0;
+    
+    pthread_mutex_lock(&rx->lock);
+    if (pkt->sack != rx->session) {
+        // Datagramme d'une ancienne session, ou nouvelle session annoncée par le serveur
+        if (!(pkt->flags & REQ_FLAG_RESYNC)) {
+            pthread_mutex_unlock(&rx->lock);
+            return;
+        }
+        for (int i = 0; i < RELIABLE_REORDER_WINDOW; i++) {
+            free(rx->pending[i]);
+            rx->pending[i] = NULL;
+        }
+        rx->session = pkt->sack;
+        rx->next_seq = pkt->seq;
+    }
+    
+    // Le serveur a abandonné tout ce qui précède pkt->ack : ne plus l'attendre
+    if (pkt->ack >= rx->next_seq) {
+        uint32_t span = pkt->ack - rx->next_seq + 1;
+        if (span > RELIABLE_REORDER_WINDOW) span = RELIABLE_REORDER_WINDOW;
+        for (uint32_t i = 0; i < span; i++) {
+            uint32_t seq = rx->next_seq + i;
+            Request **slot = &rx->pending[seq % RELIABLE_REORDER_WINDOW];
+            if (*slot && (*slot)->seq == seq) {
+                ready[nb_ready++] = *slot;
+                *slot = NULL;
+            }
+        }
+        rx->next_seq = pkt->ack + 1;
+    }
+    
+    if (pkt->seq < rx->next_seq) {
+        ack_now = 1;  // Doublon : notre acquittement s'est perdu
+    } else if (pkt->seq == rx->next_seq) {
+        ready[nb_ready++] = pkt;
+        rx->next_seq++;
+    } else {
+        // En avance : garder pour plus tard et signaler le trou immédiatement
+        Request **slot = &rx->pending[pkt->seq % RELIABLE_REORDER_WINDOW];
+        if (pkt->seq - rx->next_seq < RELIABLE_REORDER_WINDOW && !*slot) {
+            *slot = malloc(sizeof(Request));
+            if (*slot) memcpy(*slot, pkt, sizeof(Request));
+        }
+        ack_now = 1;
+    }
+    
+    // Délivrer la suite devenue contiguë
+    Request **slot = &rx->pending[rx->next_seq % RELIABLE_REORDER_WINDOW];
+    while (*slot && (*slot)->seq == rx->next_seq) {
+        ready[nb_ready++] = *slot;
+        *slot = NULL;
+        rx->next_seq++;
+        slot = &rx->pending[rx->next_seq % RELIABLE_REORDER_WINDOW];
+    }
+    
+    if (rx->unacked++ == 0) rx->first_unacked_ms = client_now_ms();
+    if (rx->unacked >= CLIENT_ACK_EVERY) ack_now = 1;
+    pthread_mutex_unlock(&rx->lock);
+    
+    for (int i = 0; i < nb_ready; i++) {
+        handle_response(client, ready[i]);
+        if (ready[i] != pkt) free(ready[i]);
+    }
+    if (ack_now) send_ack(client);
+}
+
+// Acquittement différé : envoyé au plus CLIENT_ACK_DELAY_MS après la première réception
+static void flush_delayed_ack(Client *client) {
+    pthread_mutex_lock(&client->rx.lock);
+    int due = client->rx.unacked > 0 &&
+              client_now_ms() - client->rx.first_unacked_ms >= CLIENT_ACK_DELAY_MS;
+    pthread_mutex_unlock(&client->rx.lock);
+    if (due) send_ack(client);
+}
+
 void *receive_message_thread(void *arg) {
     Client *client = (Client *)arg;
     
@@ -621,7 +923,6 @@ void *receive_message_thread(void *arg) {
     pthread_setspecific(client_key, client);
     
     Request response;
-    Request ack_response;
     socklen_t server_len = sizeof(client->server_addr);
     
     while (running) {
@@ -636,6 +937,7 @@ void *receive_message_thread(void *arg) {
             
             // Si c'est un timeout, on continue la boucle
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (client->rx.enabled) flush_delayed_ack(client);
                 continue;
             }
             
@@ -644,151 +946,11 @@ void *receive_message_thread(void *arg) {
             continue;
         }
         
-        // Vérifier s'il s'agit d'une notification de fichier à télécharger
-        if (response.type == REQ_COMMAND && strncmp(response.content, "@file_ready ", 12) == 0) {
-            // Effacer la ligne actuelle
-            printf("\r                                                                               \r");
-            printf("Notification: Fichier prêt à être téléchargé.\n");
-            
-            // Extraire le nom du fichier et le port à utiliser
-            char filename[256];
-            int port = FILE_TRANSFER_PORT; // Port par défaut
-            
-            // Essayer d'obtenir le port personnalisé
-            if (sscanf(response.content, "@file_ready %255s %d", filename, &port) >= 1) {
-                printf("Préparation du téléchargement du fichier %s sur le port %d en arrière-plan\n", filename, port);
-            }
-            
-            // Télécharger le fichier en arrière-plan
-            char download_dir[256] = "./downloads"; // Dossier par défaut
-            
-            // Créer le dossier s'il n'existe pas
-            mkdir(download_dir, 0755);
-            
-            // Lancer le thread de téléchargement
-            pthread_t download_thread;
-            FileTransferThreadArgs *args = malloc(sizeof(FileTransferThreadArgs));
-            if (args) {
-                strncpy(args->filename, filename, sizeof(args->filename) - 1);
-                args->filename[sizeof(args->filename) - 1] = '\0';
-                strncpy(args->server_ip, inet_ntoa(client->server_addr.sin_addr), sizeof(args->server_ip) - 1);
-                args->server_ip[sizeof(args->server_ip) - 1] = '\0';
-                strncpy(args->save_dir, download_dir, sizeof(args->save_dir) - 1);
-                args->save_dir[sizeof(args->save_dir) - 1] = '\0';
-                args->port = port;
-                args->is_upload = 0;
-                
-                if (pthread_create(&download_thread, NULL, file_transfer_thread, args) != 0) {
-                    perror("Erreur lors de la création du thread de téléchargement");
-                    free(args);
-                } else {
-                    pthread_detach(download_thread);
-                }
-            } else {
-                perror("Erreur d'allocation mémoire");
-            }
-            
-            // Réafficher le prompt
-            char prompt[100];
-            get_custom_prompt(client, prompt, sizeof(prompt));
-            printf("%s", prompt);
-            fflush(stdout);
+        if (client->rx.enabled && response.seq != 0) {
+            receive_reliable(client, &response);
+            flush_delayed_ack(client);
         } else {
-            // Vérifier s'il s'agit d'une réponse à une commande de salon
-            if (response.type == REQ_MESSAGE && strcmp(response.sender, "Server") == 0) {
-                // Détecter les messages de confirmation de salon
-                if (strstr(response.content, "Vous avez rejoint le salon") != NULL) {
-                    // Extraire le nom du salon de la réponse
-                    char *start = strstr(response.content, "'");
-                    if (start) {
-                        start++; // Ignorer la première apostrophe
-                        char *end = strstr(start, "'");
-                        if (end) {
-                            char room_name[50];
-                            int len = end - start;
-                            if (len > 0 && len < 49) {
-                                strncpy(room_name, start, len);
-                                room_name[len] = '\0';
-                                update_current_room(client, room_name);
-                            }
-                        }
-                    }
-                } else if (strstr(response.content, "Vous avez quitté le salon") != NULL) {
-                    update_current_room(client, "");  // Salon vide
-                } else if (strstr(response.content, "créé avec succès") != NULL && 
-                          strstr(response.content, "Salon") != NULL) {
-                    // Extraire le nom du salon créé
-                    char *start = strstr(response.content, "'");
-                    if (start) {
-                        start++;
-                        char *end = strstr(start, "'");
-                        if (end) {
-                            char room_name[50];
-                            int len = end - start;
-                            if (len > 0 && len < 49) {
-                                strncpy(room_name, start, len);
-                                room_name[len] = '\0';
-                                // Le créateur rejoint automatiquement son salon
-                                update_current_room(client, room_name);
-                            }
-                        }
-                    }
-                } 
-                // AJOUT: Détecter les informations utilisateur (@info)
-                else if (strstr(response.content, "=== INFORMATIONS UTILISATEUR ===") != NULL) {
-                    // Chercher l'information sur le salon courant
-                    char *salon_line = strstr(response.content, "Salon courant: ");
-                    if (salon_line) {
-                        salon_line += 15; // Avancer après "Salon courant: "
-                        
-                        // Vérifier si le salon est "Aucun"
-                        if (strncmp(salon_line, "Aucun", 5) == 0) {
-                            // L'utilisateur n'est dans aucun salon
-                            update_current_room(client, "");
-                        } else {
-                            // Extraire le nom du salon
-                            char salon[50] = "";
-                            int i = 0;
-                            
-                            // Copier jusqu'à rencontrer un '\n' ou un '\0'
-                            while (salon_line[i] && salon_line[i] != '\n' && i < 49) {
-                                salon[i] = salon_line[i];
-                                i++;
-                            }
-                            salon[i] = '\0';
-                            
-                            // Mettre à jour le salon courant
-                            update_current_room(client, salon);
-                        }
-                    }
-                }
-            }
-            
-            // Effacer la ligne actuelle avant d'afficher un nouveau message
-            printf("\r                                                                               \r");
-            
-            // Traitement normal des messages
-            // Si c'est un message du serveur, on garde le format actuel
-            if (strcmp(response.sender, "Server") == 0) {
-                printf("[%s] %s\n", response.sender, response.content);
-            } 
-            // Si c'est un message d'un utilisateur, on ajoute ": " après le nom d'utilisateur
-            else {
-                printf("[%s] %s: %s\n", client->current_room, response.sender, response.content);
-            }
-            
-            // Réafficher le prompt avec le salon courant
-            char prompt[100];
-            get_custom_prompt(client, prompt, sizeof(prompt));
-            printf("%s", prompt);
-            fflush(stdout);
-        }
-
-        if (strcmp(response.sender, "Server") == 0 && 
-            strstr(response.content, "a quitté le chat") != NULL) {
-            init_request(&ack_response, REQ_MESSAGE, client->username, 
-                         "Server", "ACK notification déconnexion");
-            send_request(client, &ack_response);
+            handle_response(client, &response);
         }
     }
     
@@ -815,18 +977,25 @@ void get_custom_prompt(Client *client, char *prompt, size_t size) {
     }
 }
 
-// Fonction principale
+// Fonction principale (exclue quand client.c est lié aux outils de mesure)
+#ifndef CLIENT_NO_MAIN
 int main(int argc, char *argv[]) {
     printf("██████   ██████ ██████████  █████████   █████████    \n░░██████ ██████ ░░███░░░░░█ ███░░░░░███ ███░░░░░███  \n ░███░█████░███  ░███  █ ░ ░███    ░░░ ░███    ░░░   \n ░███░░███ ░███  ░██████   ░░█████████ ░░█████████   \n ░███ ░░░  ░███  ░███░░█    ░░░░░░░░███ ░░░░░░░░███  \n ░███      ░███  ░███ ░   █ ███    ░███ ███    ░███  \n █████     █████ ██████████░░█████████ ░░█████████   \n░░░░░     ░░░░░ ░░░░░░░░░░  ░░░░░░░░░   ░░░░░░░░░    \n                                                     \n                                                     \n                                                     \n ███████████    █████████    █████████  █████   █████\n░░███░░░░░███  ███░░░░░███  ███░░░░░███░░███   ░░███ \n ░███    ░███ ░███    ░███ ░███    ░░░  ░███    ░███ \n ░██████████  ░███████████ ░░█████████  ░███████████ \n ░███░░░░░███ ░███░░░░░███  ░░░░░░░░███ ░███░░░░░███ \n ░███    ░███ ░███    ░███  ███    ░███ ░███    ░███ \n ███████████  █████   █████░░█████████  █████   █████\n░░░░░░░░░░░  ░░░░░   ░░░░░  ░░░░░░░░░  ░░░░░   ░░░░░ \n");
-    const char* server_ip;
-    if(argc < 2){
+    const char* server_ip = NULL;
+    int reliable = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reliable") == 0) {
+            reliable = 1;
+        } else if (server_ip == NULL) {
+            server_ip = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--reliable] <server_ip>\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (server_ip == NULL) {
         printf("Running on localhost (127.0.0.1)\n");
         server_ip = "127.0.0.1";
-    }else if (argc == 2){
-        server_ip = argv[1];
-    }else {
-        fprintf(stderr, "Usage: %s <server_ip>\n", argv[0]);
-        return EXIT_FAILURE;
     }
     
     Client client;
@@ -837,6 +1006,7 @@ int main(int argc, char *argv[]) {
     if (init_client(&client, server_ip) < 0) {
         return EXIT_FAILURE;
     }
+    client.rx.enabled = reliable;
     
     // Initialiser la clé pour stocker le client dans les threads
     if (pthread_key_create(&client_key, NULL) != 0) {
@@ -863,6 +1033,15 @@ int main(int argc, char *argv[]) {
     
     printf("Connecté au serveur. Tapez vos messages (commandes préfixées par @).\n");
     
+    // Session fiable : réveiller le thread de réception assez souvent pour
+    // envoyer les acquittements différés
+    if (client.rx.enabled) {
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = CLIENT_ACK_DELAY_MS * 1000;
+        setsockopt(client.socket_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    
     // Créer les threads d'envoi et de réception
     pthread_t send_thread, receive_thread;
     
@@ -926,4 +1105,5 @@ int main(int argc, char *argv[]) {
     printf("Client déconnecté.\n");
     
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+#endif /* CLIENT_NO_MAIN */
@@ -4,6 +4,20 @@
 
 #include "common.h"
 
+#define CLIENT_ACK_EVERY     8    // Acquittement après ce nombre de datagrammes reçus
+#define CLIENT_ACK_DELAY_MS  40   // ... ou après ce délai (acquittement différé)
+
+// Réception fiable (client lancé avec --reliable)
+typedef struct {
+    int enabled;
+    uint32_t session;            // Identifiant de session annoncé par le serveur
+    uint32_t next_seq;           // Prochain numéro attendu (0 : pas encore synchronisé)
+    Request *pending[RELIABLE_REORDER_WINDOW]; // Reçus en avance, indice seq % fenêtre
+    int unacked;                 // Reçus depuis le dernier acquittement envoyé
+    uint64_t first_unacked_ms;
+    pthread_mutex_t lock;        // Partagé avec le thread d'envoi (acquittement porté)
+} ReliableReceiver;
+
 // Structure pour stocker les informations du client
 typedef struct {
     int socket_fd;
@@ -11,6 +25,8 @@ typedef struct {
     char username[50];
     char password[50];
     char current_room[50];  // Salon courant
+    ReliableReceiver rx;
+    time_t last_sent;       // Dernière requête envoyée (REQ_HEARTBEAT au-delà de HEARTBEAT_INTERVAL)
 } Client;
 
 // Structure pour les arguments du thread de transfert de fichier
@@ -1,5 +1,15 @@
 // command.c
 #include "command.h"
+#include "search.h"
+#include "offline.h"
+#include "catalog.h"
+#include "metrics.h"
+#include "ratelimit.h"
+#include "stats.h"
+#include "slab.h"
+#include "preload.h"
+#include "reply.h"
+#include "presence.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,103 +17,82 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <libgen.h>
-#include <dirent.h>
+#include <limits.h>
 
-// Tableau des commandes disponibles
-static Command commands[] = {
-    {"help", cmd_help, "Affiche la liste des commandes disponibles", ROLE_USER},
-    {"ping", cmd_ping, "Test de connectivité avec le serveur", ROLE_USER},
-    {"msg", cmd_msg, "Envoie un message privé (@msg <user> <message>)", ROLE_USER},
-    {"credits", cmd_credits, "Affiche les crédits de l'application", ROLE_USER},
-    {"shutdown", cmd_shutdown, "Arrête le serveur (admin uniquement)", ROLE_ADMIN},
-    {"list", cmd_list, "Affiche la liste des utilisateurs connectés", ROLE_USER},
-    {"download", cmd_download, "Télécharge un des fichiers du serveur pour le client", ROLE_USER},
-    {"upload", cmd_upload, "Envoie un fichier sur le serveur", ROLE_USER},
-    {"promote", cmd_promote, "Promeut un utilisateur au rang de modérateur (admin uniquement)", ROLE_ADMIN},
-    {"disconnect", cmd_disconnect, "Déconnecte explicitement du serveur", ROLE_USER},
-    {"files", cmd_files, "Affiche la liste des fichiers disponibles sur le serveur", ROLE_USER},
-    {"mute", cmd_mute, "Rend muet un utilisateur pendant une durée spécifiée (@mute <user> <minutes>)", ROLE_MODERATOR},
-    {"unmute", cmd_unmute, "Annule le mode muet d'un utilisateur (@unmute <user>)", ROLE_MODERATOR},
-    {"create", cmd_create, "Crée un nouveau salon (@create <nom_salon>)", ROLE_USER},
-    {"join", cmd_join, "Rejoint un salon existant (@join <nom_salon>)", ROLE_USER},
-    {"leave", cmd_leave, "Quitte le salon courant", ROLE_USER},
-    {"delete", cmd_delete, "Supprime un salon (créateur uniquement) (@delete <nom_salon>)", ROLE_USER},
-    {"rooms", cmd_rooms, "Affiche la liste des salons disponibles", ROLE_USER},
-    {"info", cmd_info, "Affiche les informations sur votre état actuel", ROLE_USER}
-};
+// Tableau des commandes et hachage parfait de leurs noms, générés depuis commands.def
+#include "command_table.h"
 
-static int command_count = sizeof(commands) / sizeof(Command);
+static const int command_count = COMMAND_COUNT;
+
+// Textes envoyés quand help.txt ou credits.txt est illisible
+static char help_fallback[COMMAND_COUNT * 160];
+static const char credits_fallback[] =
+    "Application de messagerie\nDéveloppée dans le cadre du projet FAR\nÉquipe : [Vos noms ici]";
 
 void init_command_system(void) {
+    for (int i = 0; i < command_count; i++) {
+        metrics_register_command(i, commands[i].name);
+    }
+
+    size_t len = snprintf(help_fallback, sizeof(help_fallback), "Commandes disponibles:\n");
+    for (int i = 0; i < command_count && len < sizeof(help_fallback); i++) {
+        len += snprintf(help_fallback + len, sizeof(help_fallback) - len, "@%s - %s\n",
+                        commands[i].name, commands[i].description);
+    }
+    preload_register(PRELOAD_HELP, "help.txt", help_fallback);
+    preload_register(PRELOAD_CREDITS, "credits.txt", credits_fallback);
+
     printf("Système de commandes initialisé avec %d commandes\n", command_count);
 }
 
-char* get_command_name(const char *command_str) {
-    static char name[32];
-    
+// Envoie une réponse préchargée trame par trame. Chaque trame est copiée : la
+// numérotation des sessions fiables écrit dans la requête envoyée.
+static void send_preloaded(Server *server, PreloadId id, struct sockaddr_in *client_addr) {
+    const PreloadedReply *reply = preload_acquire(id);
+    if (reply) {
+        Request frame;
+        for (int f = 0; f < reply->nb_frames; f++) {
+            frame = reply->frames[f];
+            send_response(server, &frame, client_addr);
+        }
+    }
+    preload_release();
+}
+
+StrView get_command_name(const char *command_str) {
     // Ignorer le '@' initial
     const char *start = (command_str[0] == '@') ? command_str + 1 : command_str;
-    
-    // Copier jusqu'au premier espace
-    int i = 0;
-    while (start[i] && start[i] != ' ' && i < 31) {
-        name[i] = start[i];
-        i++;
-    }
-    name[i] = '\0';
-    
+    StrView name = { start, strcspn(start, " ") };
     return name;
 }
 
-char* get_command_args(const char *command_str) {
-    static char args[MAX_MSG_SIZE];
-    
-    // Trouver le premier espace
+const char *get_command_args(const char *command_str) {
     const char *space = strchr(command_str, ' ');
-    if (!space) {
-        args[0] = '\0';
-        return args;
-    }
-    
-    // Copier tout après le premier espace
-    strncpy(args, space + 1, MAX_MSG_SIZE - 1);
-    args[MAX_MSG_SIZE - 1] = '\0';
-    
-    return args;
+    return space ? space + 1 : "";
 }
 
-char* read_file_content(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        char *error_msg = malloc(128);
-        sprintf(error_msg, "Erreur: impossible d'ouvrir le fichier %s", filename);
-        return error_msg;
+// Même fonction que gen_commands.awk, qui a choisi la graine sans collision
+static uint32_t command_hash(StrView name) {
+    uint32_t h = (uint32_t)name.len;
+    for (size_t i = 0; i < name.len; i++) {
+        h = (h * COMMAND_HASH_SEED + (unsigned char)name.ptr[i]) % 65521u;
     }
-    
-    // Obtenir la taille du fichier
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    rewind(file);
-    
-    // Allouer la mémoire
-    char *content = malloc(size + 1);
-    if (!content) {
-        fclose(file);
-        char *error_msg = malloc(64);
-        sprintf(error_msg, "Erreur: allocation mémoire insuffisante");
-        return error_msg;
+    return h % COMMAND_HASH_SIZE;
+}
+
+// Indice de la commande nommée name dans la table, -1 si inconnue : un seul
+// emplacement à examiner, quel que soit le nombre de commandes
+static int find_command(StrView name) {
+    if (name.len >= sizeof(commands[0].name)) return -1;
+    int i = command_slots[command_hash(name)] - 1;
+    if (i < 0 || memcmp(commands[i].name, name.ptr, name.len) != 0 || commands[i].name[name.len] != '\0') {
+        return -1;
     }
-    
-    // Lire le fichier
-    fread(content, 1, size, file);
-    content[size] = '\0';
-    
-    fclose(file);
-    return content;
+    return i;
 }
 
 CommandResult process_command(Server *server, Request *req, struct sockaddr_in *client_addr) {
-    char *cmd_name = get_command_name(req->content);
+    StrView cmd_name = get_command_name(req->content);
     
     // Trouver l'utilisateur
     int client_idx = find_client_by_username(server, req->sender);
@@ -120,24 +109,28 @@ CommandResult process_command(Server *server, Request *req, struct sockaddr_in *
     UserRole user_role = server->clients[client_idx].role;
     
     // Chercher la commande dans le tableau
-    for (int i = 0; i < command_count; i++) {
-        if (strcmp(cmd_name, commands[i].name) == 0) {
-            // Vérifier les droits d'accès
-            if (user_role < commands[i].min_role) {
-                // Droits insuffisants
-                Request response;
-                init_request(&response, REQ_MESSAGE, "Server", "", 
-                             "Erreur: Vous n'avez pas les droits suffisants pour exécuter cette commande.");
-                send_response(server, &response, client_addr);
-                return CMD_ERROR;
-            }
-            
-            // Exécuter la commande
-            return commands[i].handler(server, req, client_addr);
+    int i = find_command(cmd_name);
+    if (i >= 0) {
+        // Vérifier les droits d'accès
+        if (user_role < commands[i].min_role) {
+            // Droits insuffisants
+            Request response;
+            init_request(&response, REQ_MESSAGE, "Server", "", 
+                         "Erreur: Vous n'avez pas les droits suffisants pour exécuter cette commande.");
+            send_response(server, &response, client_addr);
+            metrics_inc(M_COMMANDS_DENIED);
+            return CMD_ERROR;
         }
+        
+        // Exécuter la commande
+        uint64_t start = metrics_now_ns();
+        CommandResult result = commands[i].handler(server, req, client_addr);
+        metrics_record_command(i, metrics_now_ns() - start);
+        return result;
     }
     
     // Commande inconnue
+    metrics_inc(M_COMMANDS_UNKNOWN);
     Request response;
     init_request(&response, REQ_MESSAGE, "Server", "", 
                  "Commande inconnue. Tapez @help pour voir les commandes disponibles.");
@@ -149,34 +142,8 @@ CommandResult process_command(Server *server, Request *req, struct sockaddr_in *
 CommandResult cmd_help(Server *server, Request *req, struct sockaddr_in *client_addr) {
     (void)req;  // Mark parameter as intentionally unused to fix warning
     
-    Request response;
-    
-    // Essayer de lire le fichier help.txt
-    char *content = read_file_content("help.txt");
-    
-    // Si le fichier n'existe pas, afficher la liste des commandes
-    if (strstr(content, "Erreur") != NULL) {
-        free(content);
-        
-        char help_msg[MAX_MSG_SIZE];
-        strcpy(help_msg, "Commandes disponibles:\n");
-        
-        for (int i = 0; i < command_count; i++) {
-            char line[128];
-            // Use snprintf to avoid buffer overflow
-            snprintf(line, sizeof(line), "@%s - %s\n", commands[i].name, commands[i].description);
-            if (strlen(help_msg) + strlen(line) < MAX_MSG_SIZE - 1) {
-                strcat(help_msg, line);
-            }
-        }
-        
-        init_request(&response, REQ_MESSAGE, "Server", "", help_msg);
-    } else {
-        init_request(&response, REQ_MESSAGE, "Server", "", content);
-        free(content);
-    }
-    
-    send_response(server, &response, client_addr);
+    // help.txt, ou la liste des commandes s'il est illisible (préchargé)
+    send_preloaded(server, PRELOAD_HELP, client_addr);
     return CMD_SUCCESS;
 }
 
@@ -189,9 +156,69 @@ CommandResult cmd_ping(Server *server, Request *req, struct sockaddr_in *client_
     return CMD_SUCCESS;
 }
 
+CommandResult cmd_metrics(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    (void)req;
+    
+    Request response;
+    char summary[MAX_MSG_SIZE];
+    metrics_format_summary(summary, sizeof(summary));
+    init_request(&response, REQ_MESSAGE, "Server", "", summary);
+    send_response(server, &response, client_addr);
+    return CMD_SUCCESS;
+}
+
+CommandResult cmd_stats(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    (void)req;
+    
+    Request response;
+    StatsSnapshot st;
+    
+    // Lecture du dernier échantillon publié : aucun verrou du serveur n'est pris
+    if (stats_read(&st) < 0) {
+        init_request(&response, REQ_MESSAGE, "Server", "",
+                     "Statistiques pas encore disponibles, réessayez dans une seconde.");
+        send_response(server, &response, client_addr);
+        return CMD_ERROR;
+    }
+    
+    char content[MAX_MSG_SIZE];
+    int len = snprintf(content, sizeof(content),
+        "=== STATISTIQUES (sur %.1f s, il y a %lld s) ===\n"
+        "Entrée: %.1f msg/s, %.1f Ko/s\n"
+        "Sortie: %.1f msg/s, %.1f Ko/s (%.1f diffusions/s)\n"
+        "Traitement: p50 %llu µs, p99 %llu µs (%llu requêtes)\n"
+        "Clients connectés: %d / %d inscrits\n"
+        "Transferts actifs: %lld upload(s), %lld download(s)\n"
+        "File d'envoi: %llu en attente, %llu attentes (file pleine)\n"
+        "Contention clients_mutex: %llu / %llu acquisitions\n"
+        "Contention salons_mutex: %llu / %llu acquisitions\n"
+        "Salons: %d",
+        st.interval, (long long)(time(NULL) - st.sampled_at),
+        st.requests_per_sec, st.bytes_in_per_sec / 1024.0,
+        st.responses_per_sec, st.bytes_out_per_sec / 1024.0, st.broadcasts_per_sec,
+        (unsigned long long)(st.p50_ns / 1000), (unsigned long long)(st.p99_ns / 1000),
+        (unsigned long long)st.window_requests,
+        st.connected_clients, st.registered_clients,
+        (long long)st.active_uploads, (long long)st.active_downloads,
+        (unsigned long long)st.egress_pending, (unsigned long long)st.egress_queue_full,
+        (unsigned long long)st.clients_lock_contended, (unsigned long long)st.clients_lock_acquired,
+        (unsigned long long)st.salons_lock_contended, (unsigned long long)st.salons_lock_acquired,
+        st.nb_rooms);
+    
+    for (int i = 0; i < st.nb_top_rooms && len > 0 && len < (int)sizeof(content); i++) {
+        len += snprintf(content + len, sizeof(content) - (size_t)len, "%s %s (%d)",
+                        i == 0 ? ", plus grands:" : ",", st.top_rooms[i].nom,
+                        st.top_rooms[i].nb_membres);
+    }
+    
+    init_request(&response, REQ_MESSAGE, "Server", "", content);
+    send_response(server, &response, client_addr);
+    return CMD_SUCCESS;
+}
+
 CommandResult cmd_msg(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Parser les arguments : @msg <user> <message>
     char recipient[50];
@@ -205,16 +232,35 @@ CommandResult cmd_msg(Server *server, Request *req, struct sockaddr_in *client_a
     }
     
     // Trouver le destinataire
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
     int recipient_idx = find_client_by_username(server, recipient);
     
     if (recipient_idx < 0) {
+        // Le destinataire est peut-être inscrit mais hors ligne
+        int registered = find_registered_client(server, intern_find(recipient)) >= 0;
         pthread_mutex_unlock(&server->clients_mutex);
+        
         char error[128];
-        snprintf(error, sizeof(error), "Utilisateur '%s' non trouvé", recipient);
+        if (!registered) {
+            snprintf(error, sizeof(error), "Utilisateur '%s' non trouvé", recipient);
+            init_request(&response, REQ_MESSAGE, "Server", "", error);
+            send_response(server, &response, client_addr);
+            return CMD_ERROR;
+        }
+        
+        // Mettre le message en attente jusqu'à la prochaine connexion
+        int pending = offline_enqueue(recipient, req->sender, message);
+        if (pending == -1) {
+            snprintf(error, sizeof(error), "Erreur: La boîte de '%s' est pleine, message non délivré", recipient);
+        } else if (pending < 0) {
+            snprintf(error, sizeof(error), "Erreur: Impossible de mettre le message en attente pour '%s'", recipient);
+        } else {
+            snprintf(error, sizeof(error), "%s est hors ligne: message mis en attente (%d/%d)", 
+                     recipient, pending, OFFLINE_MAX_MESSAGES);
+        }
         init_request(&response, REQ_MESSAGE, "Server", "", error);
         send_response(server, &response, client_addr);
-        return CMD_ERROR;
+        return pending < 0 ? CMD_ERROR : CMD_SUCCESS;
     }
     
     // Envoyer le message privé
@@ -222,7 +268,7 @@ CommandResult cmd_msg(Server *server, Request *req, struct sockaddr_in *client_a
     // Use snprintf to prevent buffer overflow
     snprintf(private_msg, sizeof(private_msg), "[Message privé de %s]: %s", req->sender, message);
     init_request(&response, REQ_MESSAGE, "Server", "", private_msg);
-    send_response(server, &response, &server->clients[recipient_idx].addr);
+    send_response(server, &response, &server->client_hot[recipient_idx].addr);
     
     // Confirmer l'envoi à l'expéditeur
     snprintf(private_msg, sizeof(private_msg), "Message privé envoyé à %s", recipient);
@@ -236,22 +282,8 @@ CommandResult cmd_msg(Server *server, Request *req, struct sockaddr_in *client_a
 CommandResult cmd_credits(Server *server, Request *req, struct sockaddr_in *client_addr) {
     (void)req;  // Mark parameter as intentionally unused to fix warning
     
-    Request response;
-    
-    // Lire le fichier credits.txt
-    char *content = read_file_content("credits.txt");
-    
-    // Si le fichier n'existe pas, afficher des crédits par défaut
-    if (strstr(content, "Erreur") != NULL) {
-        free(content);
-        content = malloc(256);
-        strcpy(content, "Application de messagerie\nDéveloppée dans le cadre du projet FAR\nÉquipe : [Vos noms ici]");
-    }
-    
-    init_request(&response, REQ_MESSAGE, "Server", "", content);
-    send_response(server, &response, client_addr);
-    
-    free(content);
+    // credits.txt, ou des crédits par défaut s'il est illisible (préchargé)
+    send_preloaded(server, PRELOAD_CREDITS, client_addr);
     return CMD_SUCCESS;
 }
 
@@ -284,53 +316,129 @@ const char* get_role_name(UserRole role) {
     }
 }
 
-CommandResult cmd_list(Server *server, Request *req, struct sockaddr_in *client_addr) {
-    (void)req;  // Mark parameter as intentionally unused to fix warning
-    
-    Request response;
-    char message[MAX_MSG_SIZE];
-    strcpy(message, "Utilisateurs connectés:\n");
+// Curseur de reprise d'une liste : l'indice donné en argument, 0 par défaut
+static int parse_cursor(const char *text) {
+    long cursor = strtol(text, NULL, 10);
+    if (cursor < 0) return 0;
+    return cursor > INT_MAX / 2 ? INT_MAX / 2 : (int)cursor;  // Borné : offset + indice sans débordement
+}
+
+// Rend une page de @list ; le curseur est l'indice du premier client affiché
+static unsigned long render_user_list(Server *server, int cursor, ReplyBuilder *reply) {
+    reply_printf(reply, "Utilisateurs connectés:\n");
     
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
+    unsigned long version = server->clients_version;
     
     int connected_count = 0;
+    int next = -1;  // Premier client non affiché, page pleine
     for (int i = 0; i < server->client_count; i++) {
-        if (server->clients[i].connected) {
-            char line[128]; // Agrandi pour inclure le rôle
-            
-            // Ajouter une indication visuelle pour les utilisateurs muets
-            if (server->clients[i].is_muted) {
-                sprintf(line, "- %s [%s] (muet)\n", 
-                        server->clients[i].username, 
-                        get_role_name(server->clients[i].role));
-            } else {
-                sprintf(line, "- %s [%s]\n", 
-                        server->clients[i].username, 
-                        get_role_name(server->clients[i].role));
-            }
-            
-            if (strlen(message) + strlen(line) < MAX_MSG_SIZE - 1) {
-                strcat(message, line);
-                connected_count++;
-            }
+        if (!server->client_hot[i].connected) continue;
+        connected_count++;
+        if (i < cursor || next >= 0) continue;
+        if (reply_page_full(reply)) {
+            next = i;
+            continue;
         }
+        // Ajouter une indication visuelle pour les utilisateurs muets
+        reply_printf(reply, "- %s [%s]%s\n",
+                     client_name(server, i),
+                     get_role_name(server->clients[i].role),
+                     server->clients[i].is_muted ? " (muet)" : "");
     }
     
+    pthread_mutex_unlock(&server->clients_mutex);
+    
     if (connected_count == 0) {
-        strcpy(message, "Aucun utilisateur connecté");
+        reply_free(reply);
+        reply_printf(reply, "Aucun utilisateur connecté");
     } else {
-        char count_line[64];
-        sprintf(count_line, "\nTotal: %d utilisateur(s) connecté(s)", connected_count);
-        if (strlen(message) + strlen(count_line) < MAX_MSG_SIZE - 1) {
-            strcat(message, count_line);
+        reply_printf(reply, "\nTotal: %d utilisateur(s) connecté(s)", connected_count);
+        if (next >= 0) {
+            reply_printf(reply, "\nSuite: @list %d", next);
         }
     }
+    return version;
+}
+
+CommandResult cmd_list(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    // Syntaxe: @list [curseur]. La page est rendue une fois par version de la table.
+    int cursor = parse_cursor(get_command_args(req->content));
+    reply_send_cached(server, server->client_listings, &server->clients_version, cursor,
+                      render_user_list, client_addr);
+    return CMD_SUCCESS;
+}
+
+static const char *presence_mode_names[] = { "tous", "salon", "contacts", "aucun" };
+
+CommandResult cmd_presence(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    Request response;
+    const char *args = get_command_args(req->content);
+    
+    // Syntaxe: @presence [tous|salon|contacts|aucun], @presence +pseudo, @presence -pseudo
+    char arg[64] = "";
+    sscanf(args, "%63s", arg);
+    
+    char message[MAX_MSG_SIZE];
+    int status = CMD_SUCCESS;
+    
+    lock_clients(server);
+    int client_idx = find_client_by_username(server, req->sender);
+    if (client_idx < 0) {
+        pthread_mutex_unlock(&server->clients_mutex);
+        return CMD_ERROR;
+    }
+    ClientInfo *client = &server->clients[client_idx];
     
+    if (arg[0] == '+' || arg[0] == '-') {
+        NameId id = arg[1] ? intern_find(arg + 1) : INTERN_NONE;
+        int pos = -1;
+        for (int i = 0; i < client->nb_contacts; i++) {
+            if (client->contacts[i] == id) pos = i;
+        }
+        
+        if (id == INTERN_NONE || find_registered_client(server, id) < 0) {
+            snprintf(message, sizeof(message), "Erreur: Utilisateur '%s' inconnu", arg + 1);
+            status = CMD_ERROR;
+        } else if (arg[0] == '+') {
+            if (pos < 0 && client->nb_contacts == PRESENCE_CONTACTS_MAX) {
+                snprintf(message, sizeof(message), "Erreur: Liste de contacts pleine (%d au plus)",
+                         PRESENCE_CONTACTS_MAX);
+                status = CMD_ERROR;
+            } else {
+                if (pos < 0) client->contacts[client->nb_contacts++] = id;
+                snprintf(message, sizeof(message), "'%s' ajouté à vos contacts", arg + 1);
+            }
+        } else {
+            if (pos >= 0) client->contacts[pos] = client->contacts[--client->nb_contacts];
+            snprintf(message, sizeof(message), "'%s' retiré de vos contacts", arg + 1);
+        }
+    } else if (arg[0]) {
+        int mode = -1;
+        for (int m = 0; m <= PRESENCE_NONE; m++) {
+            if (strcmp(arg, presence_mode_names[m]) == 0) mode = m;
+        }
+        if (mode < 0) {
+            snprintf(message, sizeof(message),
+                     "Usage: @presence [tous|salon|contacts|aucun] ou @presence +pseudo / -pseudo");
+            status = CMD_ERROR;
+        } else {
+            client->presence_mode = (PresenceMode)mode;
+            snprintf(message, sizeof(message), "Annonces d'arrivée et de départ: %s", presence_mode_names[mode]);
+        }
+    } else {
+        // Sans argument : abonnement et contacts actuels
+        int len = snprintf(message, sizeof(message), "Annonces d'arrivée et de départ: %s\nContacts (%d):",
+                           presence_mode_names[client->presence_mode], client->nb_contacts);
+        for (int i = 0; i < client->nb_contacts && len < (int)sizeof(message) - 64; i++) {
+            len += snprintf(message + len, sizeof(message) - (size_t)len, " %s", intern_str(client->contacts[i]));
+        }
+    }
     pthread_mutex_unlock(&server->clients_mutex);
     
     init_request(&response, REQ_MESSAGE, "Server", "", message);
     send_response(server, &response, client_addr);
-    return CMD_SUCCESS;
+    return status;
 }
 
 CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_addr) {
@@ -347,7 +455,7 @@ CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_
         return CMD_ERROR;
     }
     
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
     
     char info_msg[MAX_MSG_SIZE];
     char current_room[MAX_NOM_SALON];
@@ -359,20 +467,16 @@ CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_
              "=== INFORMATIONS UTILISATEUR ===\n"
              "Pseudonyme: %s\n"
              "Rôle: %s\n", 
-             server->clients[client_idx].username,
+             client_name(server, client_idx),
              get_role_name(server->clients[client_idx].role));
     
-    // Statut de mute
+    // Statut de mute (levé par son minuteur à l'échéance)
     if (server->clients[client_idx].is_muted) {
-        time_t now = time(NULL);
-        if (now < server->clients[client_idx].mute_until) {
-            int minutes_left = (int)((server->clients[client_idx].mute_until - now) / 60) + 1;
-            char mute_info[128];
-            snprintf(mute_info, sizeof(mute_info), "Statut: MUET (encore %d minute(s))\n", minutes_left);
-            strcat(info_msg, mute_info);
-        } else {
-            strcat(info_msg, "Statut: Actif\n");
-        }
+        int minutes_left = (int)((server->clients[client_idx].mute_until - time(NULL)) / 60) + 1;
+        if (minutes_left < 1) minutes_left = 1;
+        char mute_info[128];
+        snprintf(mute_info, sizeof(mute_info), "Statut: MUET (encore %d minute(s))\n", minutes_left);
+        strcat(info_msg, mute_info);
     } else {
         strcat(info_msg, "Statut: Actif\n");
     }
@@ -384,7 +488,7 @@ CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_
         strcat(info_msg, room_info);
         
         // Trouver des informations sur le salon
-        pthread_mutex_lock(&server->salons_mutex);
+        lock_salons(server);
         for (int i = 0; i < server->nb_salons; i++) {
             if (strcmp(server->salons[i].nom, current_room) == 0) {
                 char salon_details[128];
@@ -392,7 +496,7 @@ CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_
                          "Membres dans le salon: %d\n"
                          "Créateur du salon: %s\n",
                          server->salons[i].nb_membres,
-                         server->salons[i].createur);
+                         intern_str(server->salons[i].createur));
                 strcat(info_msg, salon_details);
                 break;
             }
@@ -402,11 +506,27 @@ CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_
         strcat(info_msg, "Salon courant: Aucun (vous devez rejoindre un salon pour envoyer des messages)\n");
     }
     
-    // Adresse IP
+    // Tous les salons suivis
+    size_t len = strlen(info_msg);
+    int followed = 0;
+    NameId self = server->client_hot[client_idx].id;
+    len += snprintf(info_msg + len, sizeof(info_msg) - len, "Salons suivis:");
+    lock_salons(server);
+    for (int i = 0; i < server->nb_salons && len < sizeof(info_msg) - 128; i++) {
+        if (room_has_member(&server->salons[i], self)) {
+            len += snprintf(info_msg + len, sizeof(info_msg) - len, " %s", server->salons[i].nom);
+            followed++;
+        }
+    }
+    pthread_mutex_unlock(&server->salons_mutex);
+    snprintf(info_msg + len, sizeof(info_msg) - len, "%s\n", followed ? "" : " aucun");
+    
+    // Adresse IP (inet_ntop : inet_ntoa partage un tampon entre les threads)
+    char ip[INET_ADDRSTRLEN];
     char ip_info[64];
-    snprintf(ip_info, sizeof(ip_info), "Adresse IP: %s:%d", 
-             inet_ntoa(server->clients[client_idx].addr.sin_addr),
-             ntohs(server->clients[client_idx].addr.sin_port));
+    inet_ntop(AF_INET, &server->client_hot[client_idx].addr.sin_addr, ip, sizeof(ip));
+    snprintf(ip_info, sizeof(ip_info), "Adresse IP: %s:%d", ip,
+             ntohs(server->client_hot[client_idx].addr.sin_port));
     strcat(info_msg, ip_info);
     
     pthread_mutex_unlock(&server->clients_mutex);
@@ -420,7 +540,7 @@ CommandResult cmd_download(Server *server, Request *req, struct sockaddr_in *cli
     (void)req;  // Mark parameter as intentionally unused to fix warning
     
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Check if args is empty
     if (args[0] == '\0') {
@@ -434,23 +554,22 @@ CommandResult cmd_download(Server *server, Request *req, struct sockaddr_in *cli
     char filename[256];
     sscanf(args, "%255s", filename);
     
-    // Full path to file (in uploads directory as that's what server can share)
-    char filepath[512];
-    sprintf(filepath, "./uploads/%s", filename);
-    
-    // Log what file we're trying to open
-    printf("Attempting to open file: %s\n", filepath);
+    // Refuser les chemins et les fichiers cachés (dont les uploads en cours)
+    if (filename[0] == '.' || strchr(filename, '/') != NULL) {
+        init_request(&response, REQ_MESSAGE, "Server", "", 
+                     "Erreur: Nom de fichier invalide");
+        send_response(server, &response, client_addr);
+        return CMD_ERROR;
+    }
     
-    // Check if file exists
-    FILE *file = fopen(filepath, "rb");  // Use binary mode for images and other binary files
-    if (!file) {
-        char error_msg[256];
-        sprintf(error_msg, "Erreur: Fichier '%s' introuvable sur le serveur", filename);
+    // Check if file exists (catalog lookup, no filesystem probe)
+    if (catalog_lookup(filename, NULL) < 0) {
+        char error_msg[320];
+        snprintf(error_msg, sizeof(error_msg), "Erreur: Fichier '%s' introuvable sur le serveur", filename);
         init_request(&response, REQ_MESSAGE, "Server", "", error_msg);
         send_response(server, &response, client_addr);
         return CMD_ERROR;
     }
-    fclose(file);
     
     // Notify client that file transfer will start
     char notify_msg[256];
@@ -460,7 +579,7 @@ CommandResult cmd_download(Server *server, Request *req, struct sockaddr_in *cli
     
     // Start file transfer thread
     pthread_t file_thread;
-    FileTransferArgs *args_struct = malloc(sizeof(FileTransferArgs));
+    FileTransferArgs *args_struct = slab_alloc(sizeof(FileTransferArgs));
     if (!args_struct) {
         init_request(&response, REQ_MESSAGE, "Server", "", 
                      "Erreur: Impossible d'allouer la mémoire pour le transfert");
@@ -468,13 +587,14 @@ CommandResult cmd_download(Server *server, Request *req, struct sockaddr_in *cli
         return CMD_ERROR;
     }
     
-    // Configure transfer args
+    // Configure transfer args (libérés par le thread)
+    memset(args_struct, 0, sizeof(FileTransferArgs));
     strncpy(args_struct->filename, filename, sizeof(args_struct->filename) - 1);
     memcpy(&args_struct->client_addr, client_addr, sizeof(struct sockaddr_in));
     
     // Create thread for file transfer
     if (pthread_create(&file_thread, NULL, file_send_thread_func, args_struct) != 0) {
-        free(args_struct);
+        slab_free(args_struct, sizeof(FileTransferArgs));
         init_request(&response, REQ_MESSAGE, "Server", "", 
                      "Erreur: Impossible de démarrer le thread de transfert");
         send_response(server, &response, client_addr);
@@ -491,7 +611,7 @@ CommandResult cmd_upload(Server *server, Request *req, struct sockaddr_in *clien
     (void)req;  // Mark parameter as intentionally unused to fix warning
     
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Check if args is empty
     if (args[0] == '\0') {
@@ -520,34 +640,10 @@ CommandResult cmd_upload(Server *server, Request *req, struct sockaddr_in *clien
         mkdir("./uploads", 0700);
     }
     
-    // Generate destination path
-    char dest_path[512];
-    char unique_filename[256];
-    generate_unique_filename("./uploads", base_filename, unique_filename, sizeof(unique_filename));
-    sprintf(dest_path, "./uploads/%s", unique_filename);
-    
-    // Get client IP
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &(client_addr->sin_addr), client_ip, INET_ADDRSTRLEN);
-    
-    // Create thread for file transfer
+    // Start file transfer thread (le nom est lu sur la connexion TCP et le nom
+    // définitif choisi par commit_upload : aucun argument)
     pthread_t file_thread;
-    FileTransferArgs *args_struct = malloc(sizeof(FileTransferArgs));
-    if (!args_struct) {
-        init_request(&response, REQ_MESSAGE, "Server", "", 
-                     "Erreur: Impossible d'allouer la mémoire pour le transfert");
-        send_response(server, &response, client_addr);
-        return CMD_ERROR;
-    }
-    
-    // Configure transfer args
-    strncpy(args_struct->filename, unique_filename, sizeof(args_struct->filename) - 1);
-    memcpy(&args_struct->client_addr, client_addr, sizeof(struct sockaddr_in));
-    args_struct->success = 0;
-    
-    // Start file transfer thread
-    if (pthread_create(&file_thread, NULL, file_transfer_thread, args_struct) != 0) {
-        free(args_struct);
+    if (pthread_create(&file_thread, NULL, file_transfer_thread, NULL) != 0) {
         init_request(&response, REQ_MESSAGE, "Server", "", 
                      "Erreur: Impossible de démarrer le thread de réception");
         send_response(server, &response, client_addr);
@@ -562,7 +658,7 @@ CommandResult cmd_upload(Server *server, Request *req, struct sockaddr_in *clien
 
 CommandResult cmd_promote(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     if (args[0] == '\0') {
@@ -577,7 +673,7 @@ CommandResult cmd_promote(Server *server, Request *req, struct sockaddr_in *clie
     sscanf(args, "%49s", username);
     
     // Trouver l'utilisateur à promouvoir
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
     int user_idx = find_client_by_username(server, username);
     
     if (user_idx < 0) {
@@ -601,6 +697,8 @@ CommandResult cmd_promote(Server *server, Request *req, struct sockaddr_in *clie
     
     // Promouvoir l'utilisateur
     server->clients[user_idx].role = ROLE_MODERATOR;
+    touch_clients(server);
+    ratelimit_set_role(username, ROLE_MODERATOR);
     pthread_mutex_unlock(&server->clients_mutex);
     
     // Envoyer confirmation
@@ -613,7 +711,7 @@ CommandResult cmd_promote(Server *server, Request *req, struct sockaddr_in *clie
     char notify[128];
     snprintf(notify, sizeof(notify), "Vous avez été promu au rang de modérateur par '%s'", req->sender);
     init_request(&response, REQ_MESSAGE, "Server", "", notify);
-    send_response(server, &response, &server->clients[user_idx].addr);
+    send_response(server, &response, &server->client_hot[user_idx].addr);
     
     return CMD_SUCCESS;
 }
@@ -637,93 +735,138 @@ CommandResult cmd_disconnect(Server *server, Request *req, struct sockaddr_in *c
     send_response(server, &response, client_addr);
     
     // Marquer l'utilisateur comme déconnecté
-    pthread_mutex_lock(&server->clients_mutex);
-    server->clients[client_idx].connected = false;
-    pthread_mutex_unlock(&server->clients_mutex);
-    
-    // Annoncer la déconnexion aux autres clients
-    char announce[100];
-    sprintf(announce, "%s a quitté le chat", req->sender);
-    init_request(&response, REQ_MESSAGE, "Server", "", announce);
-    
-    pthread_mutex_lock(&server->clients_mutex);
-    for (int i = 0; i < server->client_count; i++) {
-        if (i != client_idx && server->clients[i].connected) {
-            send_response(server, &response, &server->clients[i].addr);
-        }
-    }
+    lock_clients(server);
+    server->client_hot[client_idx].connected = false;
+    touch_clients(server);
+    ratelimit_bind(req->sender, NULL);
+    presence_event(server, client_idx, 0, 0);  // Annonce regroupée
     pthread_mutex_unlock(&server->clients_mutex);
     
     return CMD_SUCCESS;
 }
 
+// Formate une taille de fichier lisible (o, Ko, Mo, Go)
+static void format_size(off_t size, char *out, size_t out_size) {
+    const char *units[] = {"o", "Ko", "Mo", "Go"};
+    double value = (double)size;
+    int unit = 0;
+    while (value >= 1024.0 && unit < 3) {
+        value /= 1024.0;
+        unit++;
+    }
+    if (unit == 0) {
+        snprintf(out, out_size, "%lld %s", (long long)size, units[0]);
+    } else {
+        snprintf(out, out_size, "%.1f %s", value, units[unit]);
+    }
+}
+
 CommandResult cmd_files(Server *server, Request *req, struct sockaddr_in *client_addr) {
-    (void)req;  // Pour éviter l'avertissement de paramètre non utilisé
-    
     Request response;
-    char message[MAX_MSG_SIZE] = "Fichiers disponibles sur le serveur:\n";
+    const char *args = get_command_args(req->content);
+    
+    // Syntaxe: @files [préfixe|*] [curseur] ou @files <curseur>
+    char first[256] = "";
+    char second[32] = "";
+    char prefix[256] = "";
+    int cursor = 0;
+    int nb_args = sscanf(args, "%255s %31s", first, second);
+    
+    if (nb_args == 1 && strspn(first, "0123456789") == strlen(first)) {
+        cursor = parse_cursor(first);
+    } else if (nb_args >= 1) {
+        if (strcmp(first, "*") != 0) {
+            strcpy(prefix, first);
+        }
+        if (nb_args == 2) {
+            cursor = parse_cursor(second);
+        }
+    }
     
-    // Ouvrir le répertoire
-    DIR *dir = opendir("./uploads");
-    if (!dir) {
-        // Si le répertoire n'existe pas, le créer et envoyer message vide
-        mkdir("./uploads", 0755);
-        init_request(&response, REQ_MESSAGE, "Server", "", 
-                     "Aucun fichier disponible sur le serveur");
+    // Servir la liste depuis le catalogue (aucun parcours du dossier), par lots
+    CatalogEntry entries[CATALOG_LIST_BATCH];
+    int total = 0;
+    int count = catalog_list(prefix, cursor, entries, CATALOG_LIST_BATCH, &total);
+    
+    if (total == 0) {
+        char empty_msg[320];
+        if (prefix[0]) {
+            snprintf(empty_msg, sizeof(empty_msg), "Aucun fichier commençant par '%s' sur le serveur", prefix);
+        } else {
+            snprintf(empty_msg, sizeof(empty_msg), "Aucun fichier disponible sur le serveur");
+        }
+        init_request(&response, REQ_MESSAGE, "Server", "", empty_msg);
         send_response(server, &response, client_addr);
         return CMD_SUCCESS;
     }
     
-    // Lire les entrées du répertoire
-    struct dirent *entry;
-    int file_count = 0;
+    if (count == 0) {
+        char error[128];
+        snprintf(error, sizeof(error), "Erreur: Curseur %d hors de la liste (%d fichier(s))", cursor, total);
+        init_request(&response, REQ_MESSAGE, "Server", "", error);
+        send_response(server, &response, client_addr);
+        return CMD_ERROR;
+    }
     
-    while ((entry = readdir(dir)) != NULL) {
-        // Ignorer "." et ".."
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        // Ajouter le nom du fichier à la liste
-        char line[256];
-        snprintf(line, sizeof(line), "- %s\n", entry->d_name);
-        
-        // Vérifier si l'ajout dépasserait la taille maximale
-        if (strlen(message) + strlen(line) < MAX_MSG_SIZE - 64) {
-            strcat(message, line);
-            file_count++;
-        } else {
-            // Trop de fichiers, ajouter message de troncation
-            strcat(message, "...(liste tronquée)\n");
-            break;
+    ReplyBuilder reply;
+    reply_init(&reply);
+    reply_printf(&reply, "Fichiers disponibles sur le serveur (à partir du n°%d):\n", cursor + 1);
+    
+    int next = cursor;  // Position du prochain fichier à afficher
+    while (count > 0) {
+        int i;
+        for (i = 0; i < count && !reply_page_full(&reply); i++) {
+            char size_str[32];
+            format_size(entries[i].size, size_str, sizeof(size_str));
+            reply_printf(&reply, "- %s (%s)\n", entries[i].name, size_str);
         }
+        next += i;
+        if (i < count || next >= total) break;
+        count = catalog_list(prefix, next, entries, CATALOG_LIST_BATCH, NULL);
     }
     
-    closedir(dir);
-    
-    // Si aucun fichier trouvé
-    if (file_count == 0) {
-        init_request(&response, REQ_MESSAGE, "Server", "", 
-                     "Aucun fichier disponible sur le serveur");
-    } else {
-        // Ajouter récapitulatif
-        char summary[64];
-        snprintf(summary, sizeof(summary), "\nTotal: %d fichier(s)\n", file_count);
-        strcat(message, summary);
-        
-        // Ajouter instruction pour téléchargement
-        strcat(message, "Pour télécharger un fichier: @download <nom_fichier>");
-        
-        init_request(&response, REQ_MESSAGE, "Server", "", message);
+    // Ajouter récapitulatif et navigation
+    reply_printf(&reply, "\nTotal: %d fichier(s)\n", total);
+    if (next < total) {
+        reply_printf(&reply, "Suite: @files %s %d\n", prefix[0] ? prefix : "*", next);
     }
+    reply_printf(&reply, "Pour télécharger un fichier: @download <nom_fichier>");
     
-    send_response(server, &response, client_addr);
+    reply_send(server, &reply, client_addr);
     return CMD_SUCCESS;
 }
 
+int apply_mute(Server *server, const char *username, int minutes,
+               const struct sockaddr_in *from, struct sockaddr_in *target_addr) {
+    lock_clients(server);
+    int user_idx = find_client_by_username(server, username);
+    
+    // Avec from, le pseudonyme doit correspondre à l'adresse d'où vient la requête
+    if (user_idx < 0 ||
+        (from && (server->client_hot[user_idx].addr.sin_addr.s_addr != from->sin_addr.s_addr ||
+                  server->client_hot[user_idx].addr.sin_port != from->sin_port))) {
+        pthread_mutex_unlock(&server->clients_mutex);
+        return -1;
+    }
+    
+    if (server->clients[user_idx].role >= ROLE_MODERATOR) {
+        pthread_mutex_unlock(&server->clients_mutex);
+        return -2;
+    }
+    
+    server->clients[user_idx].is_muted = true;
+    server->clients[user_idx].mute_until = time(NULL) + (minutes * 60);
+    touch_clients(server);
+    schedule_mute_expiry(server, user_idx);
+    if (target_addr) *target_addr = server->client_hot[user_idx].addr;
+    
+    pthread_mutex_unlock(&server->clients_mutex);
+    return 0;
+}
+
 CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     char username[50];
@@ -743,12 +886,11 @@ CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_
         minutes = 1; // Minimum 1 minute
     }
     
-    // Trouver l'utilisateur à rendre muet
-    pthread_mutex_lock(&server->clients_mutex);
-    int user_idx = find_client_by_username(server, username);
+    // Rendre l'utilisateur muet
+    struct sockaddr_in target_addr;
+    int result = apply_mute(server, username, minutes, NULL, &target_addr);
     
-    if (user_idx < 0) {
-        pthread_mutex_unlock(&server->clients_mutex);
+    if (result == -1) {
         char error[128];
         snprintf(error, sizeof(error), "Utilisateur '%s' non trouvé", username);
         init_request(&response, REQ_MESSAGE, "Server", "", error);
@@ -757,8 +899,7 @@ CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_
     }
     
     // Ne pas permettre de rendre muet un administrateur ou un modérateur
-    if (server->clients[user_idx].role >= ROLE_MODERATOR) {
-        pthread_mutex_unlock(&server->clients_mutex);
+    if (result == -2) {
         char error[128];
         snprintf(error, sizeof(error), "Vous ne pouvez pas rendre muet un modérateur ou un administrateur");
         init_request(&response, REQ_MESSAGE, "Server", "", error);
@@ -766,12 +907,6 @@ CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_
         return CMD_ERROR;
     }
     
-    // Rendre l'utilisateur muet
-    server->clients[user_idx].is_muted = true;
-    server->clients[user_idx].mute_until = time(NULL) + (minutes * 60);
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-    
     // Envoyer confirmation
     char confirm[128];
     snprintf(confirm, sizeof(confirm), "L'utilisateur '%s' a été rendu muet pendant %d minutes", username, minutes);
@@ -782,14 +917,14 @@ CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_
     char notify[128];
     snprintf(notify, sizeof(notify), "Vous avez été rendu muet par '%s' pendant %d minutes", req->sender, minutes);
     init_request(&response, REQ_MESSAGE, "Server", "", notify);
-    send_response(server, &response, &server->clients[user_idx].addr);
+    send_response(server, &response, &target_addr);
     
     return CMD_SUCCESS;
 }
 
 CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     char username[50];
@@ -802,7 +937,7 @@ CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *clien
     }
     
     // Trouver l'utilisateur
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
     int user_idx = find_client_by_username(server, username);
     
     if (user_idx < 0) {
@@ -827,6 +962,8 @@ CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *clien
     // Annuler le mode muet
     server->clients[user_idx].is_muted = false;
     server->clients[user_idx].mute_until = 0;
+    touch_clients(server);
+    cancel_mute_expiry(user_idx);
     
     pthread_mutex_unlock(&server->clients_mutex);
     
@@ -840,7 +977,7 @@ CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *clien
     char notify[128];
     snprintf(notify, sizeof(notify), "Votre mode muet a été annulé par '%s'", req->sender);
     init_request(&response, REQ_MESSAGE, "Server", "", notify);
-    send_response(server, &response, &server->clients[user_idx].addr);
+    send_response(server, &response, &server->client_hot[user_idx].addr);
     
     return CMD_SUCCESS;
 }
@@ -849,7 +986,7 @@ CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *clien
 
 CommandResult cmd_create(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     if (args[0] == '\0') {
@@ -883,7 +1020,7 @@ CommandResult cmd_create(Server *server, Request *req, struct sockaddr_in *clien
 
 CommandResult cmd_join(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     if (args[0] == '\0') {
@@ -897,8 +1034,16 @@ CommandResult cmd_join(Server *server, Request *req, struct sockaddr_in *client_
     char room_name[MAX_NOM_SALON];
     sscanf(args, "%49s", room_name);
     
-    // Rejoindre le salon
-    if (join_room(server, req->sender, room_name) == 0) {
+    // Rejoindre le salon (les autres salons suivis sont conservés)
+    int joined = join_room(server, req->sender, room_name);
+    if (joined == 1) {
+        // Déjà membre : le salon devient seulement le salon courant
+        char switch_msg[160];
+        snprintf(switch_msg, sizeof(switch_msg),
+                 "Vous avez rejoint le salon '%s' (déjà suivi, il devient votre salon courant).", room_name);
+        init_request(&response, REQ_MESSAGE, "Server", "", switch_msg);
+        send_response(server, &response, client_addr);
+    } else if (joined == 0) {
         char success_msg[128];
         snprintf(success_msg, sizeof(success_msg), "Vous avez rejoint le salon '%s'.", room_name);
         init_request(&response, REQ_MESSAGE, "Server", "", success_msg);
@@ -921,6 +1066,7 @@ CommandResult cmd_join(Server *server, Request *req, struct sockaddr_in *client_
 
 CommandResult cmd_leave(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
+    const char *args = get_command_args(req->content);
     
     // Trouver l'utilisateur
     int client_idx = find_client_by_username(server, req->sender);
@@ -931,44 +1077,46 @@ CommandResult cmd_leave(Server *server, Request *req, struct sockaddr_in *client
         return CMD_ERROR;
     }
     
-    // Récupérer le nom du salon courant
-    char current_room[MAX_NOM_SALON];
-    pthread_mutex_lock(&server->clients_mutex);
-    strncpy(current_room, server->clients[client_idx].salon_courant, MAX_NOM_SALON - 1);
-    current_room[MAX_NOM_SALON - 1] = '\0';
-    pthread_mutex_unlock(&server->clients_mutex);
+    // Syntaxe: @leave [nom_salon], le salon courant par défaut
+    char room[MAX_NOM_SALON] = "";
+    if (sscanf(args, "%49s", room) != 1) {
+        lock_clients(server);
+        snprintf(room, sizeof(room), "%s", server->clients[client_idx].salon_courant);
+        pthread_mutex_unlock(&server->clients_mutex);
+        
+        if (room[0] == '\0') {
+            init_request(&response, REQ_MESSAGE, "Server", "", 
+                         "Vous n'êtes dans aucun salon.");
+            send_response(server, &response, client_addr);
+            return CMD_ERROR;
+        }
+    }
     
-    // Vérifier si l'utilisateur est dans un salon
-    if (strlen(current_room) == 0) {
-        init_request(&response, REQ_MESSAGE, "Server", "", 
-                     "Vous n'êtes dans aucun salon.");
+    // Quitter le salon
+    if (remove_user(server, req->sender, room) < 0) {
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg), "Erreur: Vous ne suivez pas le salon '%s'.", room);
+        init_request(&response, REQ_MESSAGE, "Server", "", error_msg);
         send_response(server, &response, client_addr);
         return CMD_ERROR;
     }
     
-    // Annoncer le départ dans le salon
+    char success_msg[128];
+    snprintf(success_msg, sizeof(success_msg), "Vous avez quitté le salon '%s'.", room);
+    init_request(&response, REQ_MESSAGE, "Server", "", success_msg);
+    send_response(server, &response, client_addr);
+    
+    // Annoncer le départ aux membres restants
     char announce_msg[128];
     snprintf(announce_msg, sizeof(announce_msg), "%s a quitté le salon", req->sender);
     init_request(&response, REQ_MESSAGE, "Server", "", announce_msg);
-    broadcast_room(server, current_room, &response, req->sender);
-    
-    // Quitter le salon
-    if (remove_user(server, req->sender, NULL) == 0) {
-        char success_msg[128];
-        snprintf(success_msg, sizeof(success_msg), "Vous avez quitté le salon '%s'.", current_room);
-        init_request(&response, REQ_MESSAGE, "Server", "", success_msg);
-    } else {
-        init_request(&response, REQ_MESSAGE, "Server", "", 
-                     "Erreur lors de la sortie du salon.");
-    }
-    
-    send_response(server, &response, client_addr);
+    broadcast_room(server, room, &response, req->sender);
     return CMD_SUCCESS;
 }
 
 CommandResult cmd_delete(Server *server, Request *req, struct sockaddr_in *client_addr) {
     Request response;
-    char *args = get_command_args(req->content);
+    const char *args = get_command_args(req->content);
     
     // Vérifier les arguments
     if (args[0] == '\0') {
@@ -1002,45 +1150,98 @@ CommandResult cmd_delete(Server *server, Request *req, struct sockaddr_in *clien
     return CMD_SUCCESS;
 }
 
-CommandResult cmd_rooms(Server *server, Request *req, struct sockaddr_in *client_addr) {
-    (void)req;  // Paramètre non utilisé
-    
-    Request response;
-    char message[MAX_MSG_SIZE] = "Salons disponibles:\n";
-    
-    pthread_mutex_lock(&server->salons_mutex);
+// Rend une page de @rooms ; le curseur est l'indice du premier salon affiché
+static unsigned long render_room_list(Server *server, int cursor, ReplyBuilder *reply) {
+    lock_salons(server);
+    unsigned long version = server->salons_version;
     
     if (server->nb_salons == 0) {
-        strcpy(message, "Aucun salon disponible. Utilisez @create <nom> pour créer un salon.");
+        reply_printf(reply, "Aucun salon disponible. Utilisez @create <nom> pour créer un salon.");
     } else {
-        for (int i = 0; i < server->nb_salons; i++) {
-            char line[256];
-            snprintf(line, sizeof(line), "- %s (%d membre(s)) [Créateur: %s]\n", 
-                     server->salons[i].nom, 
-                     server->salons[i].nb_membres,
-                     server->salons[i].createur);
-            
-            // Vérifier si l'ajout dépasserait la taille maximale
-            if (strlen(message) + strlen(line) < MAX_MSG_SIZE - 128) {
-                strcat(message, line);
-            } else {
-                strcat(message, "...(liste tronquée)\n");
-                break;
-            }
+        reply_printf(reply, "Salons disponibles:\n");
+        int i;
+        for (i = cursor; i < server->nb_salons && !reply_page_full(reply); i++) {
+            reply_printf(reply, "- %s (%d membre(s)) [Créateur: %s]\n",
+                         server->salons[i].nom,
+                         server->salons[i].nb_membres,
+                         intern_str(server->salons[i].createur));
         }
         
-        // Ajouter récapitulatif
-        char summary[64];
-        snprintf(summary, sizeof(summary), "\nTotal: %d salon(s)\n", server->nb_salons);
-        strcat(message, summary);
-        
-        // Ajouter instruction
-        strcat(message, "Pour rejoindre un salon: @join <nom_salon>");
+        // Ajouter récapitulatif et navigation
+        reply_printf(reply, "\nTotal: %d salon(s)\n", server->nb_salons);
+        if (i < server->nb_salons) {
+            reply_printf(reply, "Suite: @rooms %d\n", i);
+        }
+        reply_printf(reply, "Pour rejoindre un salon: @join <nom_salon>");
     }
     
     pthread_mutex_unlock(&server->salons_mutex);
+    return version;
+}
+
+CommandResult cmd_rooms(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    // Syntaxe: @rooms [curseur]. La page est rendue une fois par version de la table.
+    int cursor = parse_cursor(get_command_args(req->content));
+    reply_send_cached(server, server->salon_listings, &server->salons_version, cursor,
+                      render_room_list, client_addr);
+    return CMD_SUCCESS;
+}
+
+CommandResult cmd_search(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    Request response;
+    const char *args = get_command_args(req->content);
+    
+    // Parser les arguments : @search <salon> <termes>
+    char room_name[MAX_NOM_SALON];
+    char terms[MAX_MSG_SIZE];
+    
+    if (sscanf(args, "%49s %[^\n]", room_name, terms) != 2) {
+        init_request(&response, REQ_MESSAGE, "Server", "", 
+                     "Usage: @search <nom_salon> <termes> - Recherche dans l'historique d'un salon");
+        send_response(server, &response, client_addr);
+        return CMD_ERROR;
+    }
+    
+    SearchHit hits[SEARCH_MAX_RESULTS];
+    int total = 0;
+    int found = search_room(room_name, terms, hits, SEARCH_MAX_RESULTS, &total);
+    
+    if (found < 0) {
+        init_request(&response, REQ_MESSAGE, "Server", "", 
+                     "Erreur: Recherche impossible (termes invalides ou historique indisponible).");
+        send_response(server, &response, client_addr);
+        return CMD_ERROR;
+    }
+    
+    if (found == 0) {
+        char message[MAX_MSG_SIZE];
+        snprintf(message, sizeof(message), "Aucun message ne correspond à '%.200s' dans le salon '%s'.", 
+                 terms, room_name);
+        init_request(&response, REQ_MESSAGE, "Server", "", message);
+        send_response(server, &response, client_addr);
+        return CMD_SUCCESS;
+    }
+    
+    char message[MAX_MSG_SIZE];
+    int len = snprintf(message, sizeof(message), "Résultats dans '%s' (%d sur %d):\n", 
+                       room_name, found, total);
+    
+    for (int i = 0; i < found && len < (int)sizeof(message) - 1; i++) {
+        char when[16];
+        struct tm tm_info;
+        localtime_r(&hits[i].timestamp, &tm_info);
+        strftime(when, sizeof(when), "%d/%m %H:%M", &tm_info);
+        
+        // Tronquer les lignes trop longues plutôt que de perdre les suivantes
+        int written = snprintf(message + len, sizeof(message) - (size_t)len, "[%s] %s: %.120s\n", 
+                               when, hits[i].sender, hits[i].content);
+        if (written < 0 || len + written >= (int)sizeof(message)) {
+            break;
+        }
+        len += written;
+    }
     
     init_request(&response, REQ_MESSAGE, "Server", "", message);
     send_response(server, &response, client_addr);
     return CMD_SUCCESS;
-}
\ No newline at end of file
+}
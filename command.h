@@ -39,7 +39,16 @@ CommandResult cmd_promote(Server *server, Request *req, struct sockaddr_in *clie
 CommandResult cmd_disconnect(Server *server, Request *req, struct sockaddr_in *client_addr);
 CommandResult cmd_files(Server *server, Request *req, struct sockaddr_in *client_addr);
 CommandResult cmd_mute(Server *server, Request *req, struct sockaddr_in *client_addr);
+// Rend muet un utilisateur pendant minutes (partagé par @mute et la limitation de
+// débit). Avec from non NULL, l'utilisateur doit être connecté depuis cette adresse.
+// Retourne -1 si introuvable, -2 pour un modérateur ou un administrateur ; en cas
+// de succès, *target_addr (si non NULL) reçoit son adresse.
+int apply_mute(Server *server, const char *username, int minutes,
+               const struct sockaddr_in *from, struct sockaddr_in *target_addr);
 CommandResult cmd_unmute(Server *server, Request *req, struct sockaddr_in *client_addr);
+CommandResult cmd_metrics(Server *server, Request *req, struct sockaddr_in *client_addr);
+CommandResult cmd_stats(Server *server, Request *req, struct sockaddr_in *client_addr);
+CommandResult cmd_presence(Server *server, Request *req, struct sockaddr_in *client_addr);
 
 // Commandes relatives aux salons
 CommandResult cmd_create(Server *server, Request *req, struct sockaddr_in *client_addr);
@@ -48,10 +57,18 @@ CommandResult cmd_leave(Server *server, Request *req, struct sockaddr_in *client
 CommandResult cmd_delete(Server *server, Request *req, struct sockaddr_in *client_addr);
 CommandResult cmd_rooms(Server *server, Request *req, struct sockaddr_in *client_addr);
 CommandResult cmd_info(Server *server, Request *req, struct sockaddr_in *client_addr);
+CommandResult cmd_search(Server *server, Request *req, struct sockaddr_in *client_addr);
 
-// Utilitaires
-char* read_file_content(const char *filename);
-char* get_command_name(const char *command_str);
-char* get_command_args(const char *command_str);
+// Vue sur une partie d'une chaîne, sans copie ni terminateur
+typedef struct {
+    const char *ptr;
+    size_t len;
+} StrView;
+
+// Utilitaires (réentrants, sans allocation)
+// Nom de la commande (sans '@'), vue sur command_str jusqu'au premier espace
+StrView get_command_name(const char *command_str);
+// Arguments : pointeur dans command_str après le premier espace, "" si aucun
+const char *get_command_args(const char *command_str);
 
 #endif /* COMMAND_H */
\ No newline at end of file
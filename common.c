@@ -7,6 +7,10 @@ int global_socket_fd = -1;  // Initialisation de la variable globale
 void init_request(Request *req, RequestType type, const char *sender, 
                   const char *recipient, const char *content) {
     req->type = type;
+    req->seq = 0;
+    req->ack = 0;
+    req->sack = 0;
+    req->flags = 0;
     
     strncpy(req->sender, sender, sizeof(req->sender) - 1);
     req->sender[sizeof(req->sender) - 1] = '\0';
@@ -18,6 +22,17 @@ void init_request(Request *req, RequestType type, const char *sender,
     req->content[sizeof(req->content) - 1] = '\0';
 }
 
+size_t split_frame(const char *text, size_t remaining, size_t max) {
+    if (remaining <= max) return remaining;
+
+    for (size_t i = max; i > max / 2; i--) {
+        if (text[i - 1] == '\n') return i;
+    }
+    size_t len = max;
+    while (len > 0 && ((unsigned char)text[len] & 0xC0) == 0x80) len--;
+    return len;
+}
+
 void handle_sigint(int sig) {
     printf("\nInterruption reçue (signal %d). Arrêt en cours...\n", sig);
     // Just set the running flag to 0, don't close the socket here
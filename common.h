@@ -2,6 +2,7 @@
 #define COMMON_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -29,21 +30,47 @@ typedef enum {
     REQ_MESSAGE,       // Message standard
     REQ_COMMAND,       // Commande (préfixée par @)
     REQ_CONNECT,       // Connexion d'un utilisateur
-    REQ_DISCONNECT     // Déconnexion
+    REQ_DISCONNECT,    // Déconnexion
+    REQ_ACK,           // Acquittement seul (session fiable, sans contenu)
+    REQ_HEARTBEAT      // Signal de présence périodique du client (sans contenu)
 } RequestType;
 
+// Un client silencieux envoie REQ_HEARTBEAT à cet intervalle (s)
+#define HEARTBEAT_INTERVAL 10
+
+// Drapeaux de la couche de fiabilité (champ flags)
+#define REQ_FLAG_RELIABLE  0x1  // Client -> serveur : session fiable demandée / acquittement valide
+                                // Serveur -> client : seq est un numéro de séquence
+#define REQ_FLAG_RESYNC    0x2  // Nouvelle session : le récepteur repart de ce numéro
+
+// Fenêtre de réordonnancement côté client et portée de l'acquittement sélectif
+#define RELIABLE_REORDER_WINDOW  64
+#define RELIABLE_SACK_BITS       32
+
 // Structure de requête
 typedef struct {
     RequestType type;
     char sender[50];           // Expéditeur
     char recipient[50];        // Destinataire (pour messages privés)
     char content[MAX_MSG_SIZE]; // Contenu du message/commande
+
+    // Fiabilité optionnelle (tout à 0 hors session fiable)
+    uint32_t seq;              // Numéro de séquence serveur -> client (0 : hors séquence)
+    uint32_t ack;              // Client : tout jusqu'à ack inclus est reçu
+                               // Serveur : tout jusqu'à ack inclus est acquitté ou abandonné
+    uint32_t sack;             // Client : bit i => ack + 2 + i reçu (acquittement sélectif)
+    uint32_t flags;            // REQ_FLAG_*
 } Request;
 
 // Fonction pour initialiser une requête
 void init_request(Request *req, RequestType type, const char *sender, 
                   const char *recipient, const char *content);
 
+// Longueur du prochain morceau (au plus max octets) d'un texte découpé en trames :
+// coupe après le dernier saut de ligne de la seconde moitié, sinon entre deux
+// caractères UTF-8
+size_t split_frame(const char *text, size_t remaining, size_t max);
+
 // Gestionnaire de signal pour SIGINT
 void handle_sigint(int sig);
 
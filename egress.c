@@ -0,0 +1,329 @@
+// egress.c
+// Envoi asynchrone des réponses UDP : les threads de traitement déposent les
+// datagrammes dans des files sans verrou (une par thread d'envoi), vidées par
+// lots avec sendmmsg. Aucun appel système n'est fait sous clients_mutex.
+#define _GNU_SOURCE  // Pour sendmmsg
+#include "egress.h"
+#include "metrics.h"
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+
+#define EGRESS_QUEUE_MASK  (EGRESS_QUEUE_SIZE - 1)
+
+// File bornée multi-producteurs / multi-consommateurs (algorithme de Vyukov) :
+// chaque case porte un numéro de séquence qui indique si elle est libre ou pleine
+typedef struct {
+    size_t seq;
+    struct sockaddr_in addr;
+    int bulk;            // 1 : peut être abandonné si la socket est saturée
+    Request req;
+} EgressCell;
+
+typedef struct {
+    _Alignas(64) size_t enqueue_pos;
+    _Alignas(64) size_t dequeue_pos;
+    _Alignas(64) int sleeping;          // 1 : le thread attend sur cond
+    EgressCell *cells;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int started;
+} EgressWorker;
+
+static EgressWorker workers[EGRESS_WORKERS];
+static int egress_fd = -1;
+static int egress_active = 0;     // 0 : envois synchrones
+static int egress_stopping = 0;
+static int egress_users = 0;      // Producteurs en cours d'utilisation des files
+
+static int ring_push(EgressWorker *w, const Request *req, const struct sockaddr_in *addr, int bulk) {
+    size_t pos = __atomic_load_n(&w->enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        EgressCell *cell = &w->cells[pos & EGRESS_QUEUE_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&w->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(&cell->req, req, sizeof(Request));
+                cell->addr = *addr;
+                cell->bulk = bulk;
+                __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;  // File pleine
+        } else {
+            pos = __atomic_load_n(&w->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int ring_pop(EgressWorker *w, EgressCell *out) {
+    size_t pos = __atomic_load_n(&w->dequeue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        EgressCell *cell = &w->cells[pos & EGRESS_QUEUE_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&w->dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(out, cell, sizeof(EgressCell));
+                __atomic_store_n(&cell->seq, pos + EGRESS_QUEUE_SIZE, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;  // File vide
+        } else {
+            pos = __atomic_load_n(&w->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int ring_empty(EgressWorker *w) {
+    size_t pos = __atomic_load_n(&w->dequeue_pos, __ATOMIC_RELAXED);
+    return __atomic_load_n(&w->cells[pos & EGRESS_QUEUE_MASK].seq, __ATOMIC_ACQUIRE) != pos + 1;
+}
+
+// Même destination, même thread : l'ordre des datagrammes est conservé
+static EgressWorker *worker_for(const struct sockaddr_in *addr) {
+    uint32_t h = addr->sin_addr.s_addr ^ ((uint32_t)addr->sin_port * 2654435761u);
+    return &workers[(h ^ (h >> 16)) % EGRESS_WORKERS];
+}
+
+static int send_now(const Request *req, const struct sockaddr_in *addr) {
+    ssize_t sent = sendto(egress_fd, req, sizeof(Request), 0,
+                          (const struct sockaddr*)addr, sizeof(struct sockaddr_in));
+    if (sent < 0) {
+        metrics_inc(M_SEND_FAILURES);
+        perror("Erreur lors de l'envoi de la réponse");
+        return -1;
+    }
+    metrics_inc(M_RESPONSES_SENT);
+    metrics_add(M_BYTES_SENT, (uint64_t)sent);
+    return 0;
+}
+
+// Envoie un lot ; un datagramme en échec est compté puis ignoré
+static void flush_batch(EgressCell *batch, int count) {
+    struct mmsghdr msgs[EGRESS_BATCH];
+    struct iovec iov[EGRESS_BATCH];
+    memset(msgs, 0, sizeof(struct mmsghdr) * (size_t)count);
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = &batch[i].req;
+        iov[i].iov_len = sizeof(Request);
+        msgs[i].msg_hdr.msg_name = &batch[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Envoi non bloquant : la socket est partagée avec la réception et un tampon
+    // d'envoi plein ne doit pas immobiliser ce thread indéfiniment
+    int done = 0, sent_ok = 0, waited_ms = 0;
+    uint64_t bytes = 0;
+    while (done < count) {
+        int sent = sendmmsg(egress_fd, msgs + done, (unsigned int)(count - done), MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                // Tampon plein : les diffusions sont abandonnées après un court délai,
+                // les réponses directes attendent qu'il se libère
+                if (batch[done].bulk && waited_ms >= EGRESS_BULK_WAIT_MS) {
+                    metrics_inc(M_FLOW_DROPPED_QUEUE);
+                    done++;
+                    continue;
+                }
+                struct pollfd pfd = {.fd = egress_fd, .events = POLLOUT};
+                poll(&pfd, 1, EGRESS_POLL_MS);
+                waited_ms += EGRESS_POLL_MS;
+                continue;
+            }
+            metrics_inc(M_SEND_FAILURES);
+            perror("Erreur lors de l'envoi de la réponse");
+            done++;
+            continue;
+        }
+        for (int i = done; i < done + sent; i++) bytes += msgs[i].msg_len;
+        sent_ok += sent;
+        done += sent;
+        waited_ms = 0;
+    }
+
+    metrics_add(M_RESPONSES_SENT, (uint64_t)sent_ok);
+    metrics_add(M_BYTES_SENT, bytes);
+    metrics_inc(M_EGRESS_BATCHES);
+    metrics_record(H_EGRESS_BATCH, (uint64_t)count);
+}
+
+// Vide la file par lots. Retourne le nombre de datagrammes envoyés.
+static int drain(EgressWorker *w, EgressCell *batch) {
+    int total = 0, count;
+    do {
+        count = 0;
+        while (count < EGRESS_BATCH && ring_pop(w, &batch[count]) == 0) count++;
+        if (count > 0) flush_batch(batch, count);
+        total += count;
+    } while (count == EGRESS_BATCH);
+    return total;
+}
+
+static void *egress_thread(void *arg) {
+    EgressWorker *w = (EgressWorker *)arg;
+    EgressCell *batch = malloc(sizeof(EgressCell) * EGRESS_BATCH);
+    if (!batch) {
+        perror("Erreur d'allocation du lot d'envoi");
+        return NULL;
+    }
+
+    for (;;) {
+        if (drain(w, batch) > 0) continue;
+        if (__atomic_load_n(&egress_stopping, __ATOMIC_ACQUIRE)) break;
+
+        // Annoncer l'attente puis revérifier la file : un producteur qui a déposé
+        // entre-temps voit sleeping et signale sous le mutex
+        pthread_mutex_lock(&w->mutex);
+        __atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (ring_empty(w) && !__atomic_load_n(&egress_stopping, __ATOMIC_ACQUIRE)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += EGRESS_IDLE_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&w->cond, &w->mutex, &deadline);
+        }
+        __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&w->mutex);
+    }
+
+    // Dernier passage : ce qui a été déposé pendant l'arrêt
+    drain(w, batch);
+    free(batch);
+    return NULL;
+}
+
+static void wake(EgressWorker *w) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&w->mutex);
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+    }
+}
+
+static int enqueue(const Request *req, const struct sockaddr_in *addr, int bulk) {
+    // Référence tenue pendant l'accès aux files : shutdown_egress l'attend avant
+    // d'arrêter les threads et de libérer les cases
+    __atomic_add_fetch(&egress_users, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&egress_active, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&egress_users, 1, __ATOMIC_RELEASE);
+        return send_now(req, addr);
+    }
+
+    EgressWorker *w = worker_for(addr);
+    int waited = 0;
+    while (ring_push(w, req, addr, bulk) < 0) {
+        if (bulk) {
+            __atomic_sub_fetch(&egress_users, 1, __ATOMIC_RELEASE);
+            metrics_inc(M_FLOW_DROPPED_QUEUE);
+            return -2;
+        }
+        // File pleine : attendre une place plutôt que d'envoyer directement, ce
+        // qui doublerait les datagrammes de la même destination encore en file
+        if (!waited) metrics_inc(M_EGRESS_QUEUE_FULL);
+        waited = 1;
+        wake(w);
+        struct timespec pause = {0, EGRESS_FULL_WAIT_US * 1000L};
+        nanosleep(&pause, NULL);
+    }
+
+    wake(w);
+    __atomic_sub_fetch(&egress_users, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int egress_send(const Request *req, const struct sockaddr_in *addr) {
+    return enqueue(req, addr, 0);
+}
+
+int egress_send_bulk(const Request *req, const struct sockaddr_in *addr) {
+    return enqueue(req, addr, 1);
+}
+
+uint64_t egress_pending(void) {
+    uint64_t pending = 0;
+    for (int i = 0; i < EGRESS_WORKERS; i++) {
+        size_t head = __atomic_load_n(&workers[i].dequeue_pos, __ATOMIC_RELAXED);
+        size_t tail = __atomic_load_n(&workers[i].enqueue_pos, __ATOMIC_RELAXED);
+        if (tail > head) pending += tail - head;
+    }
+    return pending;
+}
+
+int init_egress(int socket_fd) {
+    egress_fd = socket_fd;
+    egress_stopping = 0;
+
+    // Un tampon plus grand absorbe les rafales de diffusion (limité par net.core.wmem_max)
+    int sndbuf = EGRESS_SNDBUF;
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+        perror("Erreur lors de la configuration du tampon d'envoi");
+    }
+
+    for (int i = 0; i < EGRESS_WORKERS; i++) {
+        EgressWorker *w = &workers[i];
+        w->cells = malloc(sizeof(EgressCell) * EGRESS_QUEUE_SIZE);
+        if (!w->cells) {
+            perror("Erreur d'allocation de la file d'envoi");
+            shutdown_egress();
+            return -1;
+        }
+        for (size_t c = 0; c < EGRESS_QUEUE_SIZE; c++) w->cells[c].seq = c;
+        w->enqueue_pos = 0;
+        w->dequeue_pos = 0;
+        w->sleeping = 0;
+        pthread_mutex_init(&w->mutex, NULL);
+        pthread_cond_init(&w->cond, NULL);
+
+        if (pthread_create(&w->thread, NULL, egress_thread, w) != 0) {
+            perror("Erreur lors de la création du thread d'envoi");
+            pthread_mutex_destroy(&w->mutex);
+            pthread_cond_destroy(&w->cond);
+            free(w->cells);
+            w->cells = NULL;
+            shutdown_egress();
+            return -1;
+        }
+        w->started = 1;
+    }
+
+    __atomic_store_n(&egress_active, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void shutdown_egress(void) {
+    // Les nouveaux envois redeviennent synchrones. Les producteurs déjà engagés
+    // terminent leur dépôt (les threads tournent encore), puis les files sont
+    // vidées avant l'arrêt.
+    __atomic_store_n(&egress_active, 0, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&egress_users, __ATOMIC_SEQ_CST) > 0) sched_yield();
+    __atomic_store_n(&egress_stopping, 1, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < EGRESS_WORKERS; i++) {
+        EgressWorker *w = &workers[i];
+        if (!w->started) continue;
+        pthread_mutex_lock(&w->mutex);
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->mutex);
+        pthread_cond_destroy(&w->cond);
+        free(w->cells);
+        w->cells = NULL;
+        w->started = 0;
+    }
+}
@@ -0,0 +1,37 @@
+// egress.h
+#ifndef EGRESS_H
+#define EGRESS_H
+
+#include <stdint.h>
+#include "common.h"
+
+#define EGRESS_WORKERS     2      // Threads d'envoi
+#define EGRESS_QUEUE_SIZE  1024   // Datagrammes en attente par thread (puissance de 2)
+#define EGRESS_BATCH       32     // Datagrammes envoyés par appel à sendmmsg
+#define EGRESS_IDLE_MS     100    // Réveil de sécurité d'un thread inactif
+#define EGRESS_SNDBUF      (4 * 1024 * 1024)  // Tampon d'envoi demandé pour la socket UDP
+#define EGRESS_POLL_MS     10     // Attente de place dans le tampon d'envoi
+#define EGRESS_BULK_WAIT_MS 50    // Au-delà, un datagramme de diffusion est abandonné
+#define EGRESS_FULL_WAIT_US 100   // Pause d'une réponse directe qui attend une place en file
+
+// Démarre les threads d'envoi sur la socket UDP du serveur
+int  init_egress(int socket_fd);
+
+// Arrête les threads après avoir envoyé tout ce qui reste en file
+void shutdown_egress(void);
+
+// Met un datagramme en file pour envoi asynchrone. Tous les datagrammes d'une même
+// destination passent par le même thread et partent dans l'ordre. Si la file est
+// pleine, l'appelant attend qu'une place se libère ; threads arrêtés, l'envoi est
+// fait immédiatement par l'appelant. Retourne -1 uniquement si cet envoi échoue.
+int  egress_send(const Request *req, const struct sockaddr_in *addr);
+
+// Variante pour les diffusions (salons, annonces) : abandonnée plutôt que
+// d'attendre quand la file ou le tampon d'envoi de la socket est saturé.
+// Retourne -2 si le datagramme est abandonné.
+int  egress_send_bulk(const Request *req, const struct sockaddr_in *addr);
+
+// Datagrammes en attente dans l'ensemble des files
+uint64_t egress_pending(void);
+
+#endif /* EGRESS_H */
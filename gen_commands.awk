@@ -0,0 +1,97 @@
+# gen_commands.awk
+# Génère command_table.h depuis commands.def : le tableau commands[] et une table
+# de hachage parfaite (aucune collision) de COMMAND_HASH_SIZE emplacements.
+# La fonction de hachage doit rester identique à command_hash() dans command.c :
+#   h = longueur ; pour chaque octet c : h = (h * graine + c) % 65521
+#   emplacement = h % COMMAND_HASH_SIZE
+# Usage : LC_ALL=C awk -f gen_commands.awk commands.def > command_table.h
+
+BEGIN {
+    for (i = 1; i < 256; i++) ord[sprintf("%c", i)] = i
+    n = 0
+}
+
+/^[ \t]*(#|$)/ { next }
+
+{
+    if (NF < 4) {
+        printf("commands.def:%d: ligne incomplète\n", NR) > "/dev/stderr"
+        failed = 1
+        exit 1
+    }
+    name[n] = $1
+    handler[n] = $2
+    role[n] = $3
+    desc = $0
+    sub(/^[ \t]*[^ \t]+[ \t]+[^ \t]+[ \t]+[^ \t]+[ \t]+/, "", desc)
+    gsub(/\\/, "\\\\", desc)
+    gsub(/"/, "\\\"", desc)
+    description[n] = desc
+    for (k = 0; k < n; k++) {
+        if (name[k] == $1) {
+            printf("commands.def:%d: commande '%s' en double\n", NR, $1) > "/dev/stderr"
+            failed = 1
+            exit 1
+        }
+    }
+    n++
+}
+
+function hash(s, seed,    h, i) {
+    h = length(s)
+    for (i = 1; i <= length(s); i++) h = (h * seed + ord[substr(s, i, 1)]) % 65521
+    return h
+}
+
+END {
+    if (failed) exit 1
+    if (n > 254) {
+        print "gen_commands.awk: trop de commandes pour command_slots" > "/dev/stderr"
+        exit 1
+    }
+
+    # Au moins 4 emplacements par commande : une graine se trouve en quelques essais
+    size = 1
+    while (size < 4 * n) size *= 2
+
+    for (seed = 1; seed < 65521; seed++) {
+        split("", used)
+        ok = 1
+        for (k = 0; k < n && ok; k++) {
+            s = hash(name[k], seed) % size
+            if (s in used) ok = 0
+            else used[s] = k
+        }
+        if (ok) break
+    }
+    if (!ok) {
+        print "gen_commands.awk: aucune graine sans collision" > "/dev/stderr"
+        exit 1
+    }
+
+    print "// command_table.h"
+    print "// Généré par gen_commands.awk depuis commands.def : ne pas modifier."
+    print "#ifndef COMMAND_TABLE_H"
+    print "#define COMMAND_TABLE_H"
+    print ""
+    printf("#define COMMAND_COUNT      %d\n", n)
+    printf("#define COMMAND_HASH_SEED  %du\n", seed)
+    printf("#define COMMAND_HASH_SIZE  %d\n", size)
+    print ""
+    print "static const Command commands[COMMAND_COUNT] = {"
+    for (k = 0; k < n; k++) {
+        printf("    {\"%s\", %s, \"%s\", %s}%s\n", name[k], handler[k], description[k], role[k],
+               k < n - 1 ? "," : "")
+    }
+    print "};"
+    print ""
+    print "// Emplacement -> indice + 1 dans commands (0 : aucune commande)"
+    printf("static const unsigned char command_slots[COMMAND_HASH_SIZE] = {")
+    for (s = 0; s < size; s++) {
+        if (s % 16 == 0) printf("\n   ")
+        printf(" %d,", (s in used) ? used[s] + 1 : 0)
+    }
+    print "\n};"
+    print ""
+    print "#endif /* COMMAND_TABLE_H */"
+}
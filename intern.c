@@ -0,0 +1,101 @@
+// intern.c
+// Table des pseudonymes : chaque pseudonyme reçoit un identifiant 32 bits stable
+// à son enregistrement. Les chaînes sont rangées par blocs qui ne sont jamais
+// déplacés ; l'index est à adressage ouvert, lu sans verrou. Seule l'attribution
+// d'un nouvel identifiant prend intern_mutex.
+#include "intern.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_BLOCK       1024                              // Pseudonymes par bloc
+#define INTERN_BLOCKS      ((INTERN_MAX_NAMES + INTERN_BLOCK - 1) / INTERN_BLOCK)
+#define INTERN_TABLE_SIZE  (2 * INTERN_MAX_NAMES)            // Remplissage <= 50 %
+
+typedef char InternName[INTERN_NAME_SIZE];
+
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+static InternName *blocks[INTERN_BLOCKS];
+static uint32_t name_count = 0;
+
+// Empreinte << 32 | (identifiant + 1), 0 : libre
+static uint64_t index_slots[INTERN_TABLE_SIZE];
+
+static uint32_t name_hash(const char *name) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+// Pseudonyme tronqué comme les champs de 50 octets du protocole
+static size_t make_key(const char *name, char *key) {
+    size_t len = strnlen(name, INTERN_NAME_SIZE - 1);
+    memcpy(key, name, len);
+    key[len] = '\0';
+    return len;
+}
+
+const char *intern_str(NameId id) {
+    if (id == INTERN_NONE || id >= INTERN_MAX_NAMES) return "";
+    InternName *block = __atomic_load_n(&blocks[id / INTERN_BLOCK], __ATOMIC_ACQUIRE);
+    return block ? block[id % INTERN_BLOCK] : "";
+}
+
+// Parcourt les sondes de hash ; *free_slot reçoit le premier emplacement libre
+static NameId lookup(const char *name, uint32_t hash, size_t *free_slot) {
+    size_t mask = INTERN_TABLE_SIZE - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        uint64_t slot = __atomic_load_n(&index_slots[i], __ATOMIC_ACQUIRE);
+        if (slot == 0) {
+            if (free_slot) *free_slot = i;
+            return INTERN_NONE;
+        }
+        if ((uint32_t)(slot >> 32) == hash) {
+            NameId id = (NameId)(uint32_t)slot - 1;
+            if (strncmp(intern_str(id), name, INTERN_NAME_SIZE - 1) == 0) return id;
+        }
+    }
+}
+
+NameId intern_find(const char *name) {
+    if (!name || !name[0]) return INTERN_NONE;
+    char key[INTERN_NAME_SIZE];
+    make_key(name, key);
+    return lookup(key, name_hash(key), NULL);
+}
+
+NameId intern_name(const char *name) {
+    if (!name || !name[0]) return INTERN_NONE;
+    char key[INTERN_NAME_SIZE];
+    size_t len = make_key(name, key);
+    uint32_t hash = name_hash(key);
+
+    NameId id = lookup(key, hash, NULL);
+    if (id != INTERN_NONE) return id;
+
+    pthread_mutex_lock(&intern_mutex);
+    size_t free_slot;
+    id = lookup(key, hash, &free_slot);  // Attribué entre-temps ?
+    if (id == INTERN_NONE && name_count < INTERN_MAX_NAMES) {
+        uint32_t b = name_count / INTERN_BLOCK;
+        if (!blocks[b]) {
+            InternName *block = calloc(INTERN_BLOCK, sizeof(InternName));
+            if (!block) {
+                perror("Erreur d'allocation de la table des pseudonymes");
+                pthread_mutex_unlock(&intern_mutex);
+                return INTERN_NONE;
+            }
+            __atomic_store_n(&blocks[b], block, __ATOMIC_RELEASE);
+        }
+        id = name_count++;
+        memcpy(blocks[b][id % INTERN_BLOCK], key, len + 1);
+
+        // La chaîne est écrite avant que l'index ne la rende visible
+        __atomic_store_n(&index_slots[free_slot], ((uint64_t)hash << 32) | (id + 1), __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&intern_mutex);
+    return id;
+}
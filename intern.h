@@ -0,0 +1,27 @@
+// intern.h
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+
+#define INTERN_NAME_SIZE  50     // Comme Request.sender, terminateur compris
+#ifndef INTERN_MAX_NAMES
+#define INTERN_MAX_NAMES  (1 << 17)  // Pseudonymes distincts (modifiable à la compilation)
+#endif
+#define INTERN_NONE       UINT32_MAX
+
+// Identifiant d'un pseudonyme, attribué une fois pour toute la durée du serveur.
+// Deux pseudonymes égaux ont le même identifiant : on compare des entiers.
+typedef uint32_t NameId;
+
+// Identifiant de name, attribué s'il n'existe pas encore. INTERN_NONE si name est
+// vide ou si la table est pleine.
+NameId intern_name(const char *name);
+
+// Identifiant de name s'il a déjà été attribué, sinon INTERN_NONE. Sans verrou.
+NameId intern_find(const char *name);
+
+// Pseudonyme d'un identifiant ("" pour INTERN_NONE). La chaîne ne bouge plus.
+const char *intern_str(NameId id);
+
+#endif /* INTERN_H */
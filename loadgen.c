@@ -0,0 +1,417 @@
+// loadgen.c
+// Générateur de charge : simule de nombreux utilisateurs depuis un seul
+// processus et mesure la latence de bout en bout et les pertes des messages
+// diffusés dans les salons.
+#include "loadgen.h"
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+static LoadGenConfig config = {
+    .server_ip = "127.0.0.1",
+    .prefix = "lg",
+    .users = 100,
+    .rooms = 10,
+    .rate = 1000.0,
+    .duration = 10,
+    .drain = 2,
+    .size = 64
+};
+
+static LoadGenUser *users = NULL;
+static int *room_members = NULL;   // Utilisateurs simulés ayant rejoint chaque salon
+static int epoll_fd = -1;
+static struct sockaddr_in server_addr;
+static LoadGenResults results;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-s ip] [-u utilisateurs] [-r salons] [-m messages/s] [-d secondes]\n"
+            "          [-w secondes d'attente] [-l taille] [-n préfixe]\n"
+            "Le serveur limite le nombre d'inscrits à MAX_CLIENTS (compiler avec\n"
+            "-DMAX_CLIENTS=... pour simuler plus d'utilisateurs).\n", prog);
+}
+
+static int send_to_server(LoadGenUser *u, RequestType type, const char *content) {
+    Request req;
+    init_request(&req, type, u->username, "", content);
+    ssize_t sent = sendto(u->fd, &req, sizeof(Request), 0,
+                          (struct sockaddr *)&server_addr, sizeof(server_addr));
+    return sent == (ssize_t)sizeof(Request) ? 0 : -1;
+}
+
+// Le nombre de sockets dépasse souvent la limite par défaut de descripteurs
+static void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static int create_users(void) {
+    users = calloc((size_t)config.users, sizeof(LoadGenUser));
+    room_members = calloc((size_t)config.rooms, sizeof(int));
+    if (!users || !room_members) {
+        perror("Échec calloc utilisateurs simulés");
+        return -1;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("Erreur epoll_create1");
+        return -1;
+    }
+
+    for (int i = 0; i < config.users; i++) {
+        LoadGenUser *u = &users[i];
+        snprintf(u->username, sizeof(u->username), "%s%d", config.prefix, i);
+        u->room = i % config.rooms;
+
+        u->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (u->fd < 0) {
+            perror("Erreur lors de la création de la socket");
+            return -1;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, u->fd, &ev) < 0) {
+            perror("Erreur epoll_ctl");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Message généré reçu : latence calculée à partir de l'horodatage embarqué
+static void handle_generated(const Request *req, uint64_t now) {
+    unsigned long long sent_ns, seq;
+    if (sscanf(req->content + strlen(LOADGEN_MARKER), "%llu %llu", &sent_ns, &seq) != 2) {
+        results.other++;
+        return;
+    }
+    if (now >= sent_ns) metrics_histogram_add(&results.latency, now - sent_ns);
+    results.delivered++;
+    results.last_delivery_ns = now;
+}
+
+// Réponse du serveur pendant la mise en place
+static void handle_setup_reply(LoadGenUser *u, LoadGenStep step, const char *content) {
+    if (!u->pending) return;
+
+    switch (step) {
+        case STEP_CONNECT:
+            // Réponse perdue puis nouvelle tentative : le serveur nous connaît déjà
+            if (strstr(content, "Connexion réussie") ||
+                (u->retries > 0 && strstr(content, "déjà utilisé"))) {
+                u->connected = 1;
+                u->pending = 0;
+            } else if (strncmp(content, "Erreur", 6) == 0) {
+                fprintf(stderr, "%s: %s\n", u->username, content);
+                u->pending = 0;
+            }
+            break;
+
+        case STEP_CREATE:
+            if (strstr(content, "créé avec succès")) {
+                u->joined = 1;
+                u->pending = 0;
+            } else if (strstr(content, "existe déjà")) {
+                u->pending = 0;  // Rejoint à l'étape suivante
+            }
+            break;
+
+        case STEP_JOIN:
+            if (strstr(content, "Vous avez rejoint")) {
+                u->joined = 1;
+                u->pending = 0;
+            } else if (strncmp(content, "Erreur", 6) == 0) {
+                fprintf(stderr, "%s: %s\n", u->username, content);
+                u->pending = 0;
+            }
+            break;
+    }
+}
+
+// Lit tout ce qui est disponible sur les sockets prêtes
+static void poll_sockets(int timeout_ms, int setup, LoadGenStep step) {
+    struct epoll_event events[256];
+    int n = epoll_wait(epoll_fd, events, 256, timeout_ms);
+    if (n < 0) {
+        if (errno != EINTR) perror("Erreur epoll_wait");
+        return;
+    }
+
+    for (int e = 0; e < n; e++) {
+        LoadGenUser *u = &users[events[e].data.u32];
+        Request req;
+        while (recv(u->fd, &req, sizeof(Request), 0) > 0) {
+            req.content[MAX_MSG_SIZE - 1] = '\0';
+            uint64_t now = metrics_now_ns();
+
+            if (strncmp(req.content, LOADGEN_MARKER, strlen(LOADGEN_MARKER)) == 0) {
+                handle_generated(&req, now);
+            } else if (setup) {
+                handle_setup_reply(u, step, req.content);
+            } else {
+                results.other++;
+            }
+        }
+    }
+}
+
+static int step_wanted(const LoadGenUser *u, int index, LoadGenStep step) {
+    switch (step) {
+        case STEP_CONNECT: return 1;
+        case STEP_CREATE:  return u->connected && index < config.rooms;
+        case STEP_JOIN:    return u->connected && !u->joined;
+    }
+    return 0;
+}
+
+static void step_send(LoadGenUser *u, LoadGenStep step) {
+    char content[MAX_MSG_SIZE];
+    switch (step) {
+        case STEP_CONNECT:
+            snprintf(content, sizeof(content), "%s %s", u->username, LOADGEN_PASSWORD);
+            send_to_server(u, REQ_CONNECT, content);
+            break;
+        case STEP_CREATE:
+            snprintf(content, sizeof(content), "@create %s_room%d", config.prefix, u->room);
+            send_to_server(u, REQ_COMMAND, content);
+            break;
+        case STEP_JOIN:
+            snprintf(content, sizeof(content), "@join %s_room%d", config.prefix, u->room);
+            send_to_server(u, REQ_COMMAND, content);
+            break;
+    }
+    u->deadline_ns = metrics_now_ns() + (uint64_t)LOADGEN_REPLY_TIMEOUT * 1000000ULL;
+}
+
+// Fait passer les utilisateurs concernés par une étape requête/réponse, avec
+// au plus LOADGEN_WINDOW requêtes en vol pour ne pas saturer le serveur
+static int run_step(LoadGenStep step) {
+    int next = 0, in_flight = 0, done = 0;
+
+    while (running) {
+        // Compléter la fenêtre
+        while (in_flight < LOADGEN_WINDOW && next < config.users) {
+            LoadGenUser *u = &users[next];
+            if (step_wanted(u, next, step)) {
+                u->pending = 1;
+                u->retries = 0;
+                step_send(u, step);
+                in_flight++;
+            }
+            next++;
+        }
+
+        poll_sockets(10, 1, step);
+
+        // Réponses reçues et délais dépassés
+        uint64_t now = metrics_now_ns();
+        in_flight = 0;
+        for (int i = 0; i < next; i++) {
+            LoadGenUser *u = &users[i];
+            if (!u->pending) continue;
+            if (now >= u->deadline_ns) {
+                if (u->retries >= LOADGEN_RETRIES) {
+                    fprintf(stderr, "%s: pas de réponse du serveur\n", u->username);
+                    u->pending = 0;
+                    continue;
+                }
+                u->retries++;
+                step_send(u, step);
+            }
+            in_flight++;
+        }
+
+        if (next >= config.users && in_flight == 0) break;
+    }
+
+    for (int i = 0; i < config.users; i++) {
+        if ((step == STEP_CONNECT && users[i].connected) ||
+            (step != STEP_CONNECT && users[i].joined)) {
+            done++;
+        }
+    }
+    return done;
+}
+
+static void send_traffic(void) {
+    char content[MAX_MSG_SIZE];
+    int size = config.size;
+    if (size < 48) size = 48;
+    if (size > MAX_MSG_SIZE - 1) size = MAX_MSG_SIZE - 1;
+
+    uint64_t duration_ns = (uint64_t)config.duration * 1000000000ULL;
+    uint64_t seq = 0;
+    int cursor = 0;
+
+    results.start_ns = metrics_now_ns();
+    uint64_t heartbeat_ns = (uint64_t)HEARTBEAT_INTERVAL * 1000000000ULL;
+    uint64_t next_heartbeat = results.start_ns + heartbeat_ns;
+    while (running) {
+        uint64_t now = metrics_now_ns();
+        uint64_t elapsed = now - results.start_ns;
+        if (elapsed >= duration_ns) break;
+
+        // Les utilisateurs peu actifs ne doivent pas être exclus des diffusions
+        if (now >= next_heartbeat) {
+            for (int i = 0; i < config.users; i++) {
+                if (users[i].connected) send_to_server(&users[i], REQ_HEARTBEAT, "");
+            }
+            next_heartbeat = now + heartbeat_ns;
+        }
+
+        // Rattraper le nombre de messages dû à ce rythme
+        uint64_t due = (uint64_t)((double)elapsed * config.rate / 1e9);
+        int batch = 0;
+        while (results.sent < due && batch < LOADGEN_SEND_BATCH) {
+            LoadGenUser *u = NULL;
+            for (int tries = 0; tries < config.users && !u; tries++) {
+                LoadGenUser *candidate = &users[cursor];
+                cursor = (cursor + 1) % config.users;
+                if (candidate->joined) u = candidate;
+            }
+            if (!u) return;
+
+            int len = snprintf(content, sizeof(content), LOADGEN_MARKER "%llu %llu ",
+                               (unsigned long long)metrics_now_ns(), (unsigned long long)seq++);
+            if (len < size) {
+                memset(content + len, 'x', (size_t)(size - len));
+                len = size;
+            }
+            content[len] = '\0';
+
+            if (send_to_server(u, REQ_MESSAGE, content) < 0) {
+                results.send_errors++;
+            } else {
+                results.expected += (uint64_t)(room_members[u->room] - 1);
+            }
+            results.sent++;
+            batch++;
+        }
+
+        poll_sockets(batch == LOADGEN_SEND_BATCH ? 0 : 1, 0, STEP_CONNECT);
+    }
+    results.send_end_ns = metrics_now_ns();
+
+    // Attendre les derniers messages en transit
+    uint64_t drain_end = results.send_end_ns + (uint64_t)config.drain * 1000000000ULL;
+    while (running && metrics_now_ns() < drain_end && results.delivered < results.expected) {
+        poll_sockets(10, 0, STEP_CONNECT);
+    }
+}
+
+static void disconnect_users(void) {
+    for (int i = 0; i < config.users; i++) {
+        if (users[i].connected) {
+            send_to_server(&users[i], REQ_DISCONNECT, "");
+            // Laisser le serveur absorber les annonces de départ
+            if (i % LOADGEN_WINDOW == LOADGEN_WINDOW - 1) usleep(1000);
+        }
+    }
+}
+
+static void print_results(int connected, int joined) {
+    double send_secs = (double)(results.send_end_ns - results.start_ns) / 1e9;
+    uint64_t last = results.last_delivery_ns > results.start_ns ? results.last_delivery_ns : results.send_end_ns;
+    double recv_secs = (double)(last - results.start_ns) / 1e9;
+    double loss = results.expected ? 100.0 * (double)(results.expected - (results.delivered < results.expected ? results.delivered : results.expected)) / (double)results.expected : 0.0;
+    const MetricsHistogramData *h = &results.latency;
+
+    printf("# loadgen users=%d rooms=%d rate=%.0f duration=%d size=%d\n",
+           config.users, config.rooms, config.rate, config.duration, config.size);
+    printf("connected %d\n", connected);
+    printf("joined %d\n", joined);
+    printf("sent %llu\n", (unsigned long long)results.sent);
+    printf("send_errors %llu\n", (unsigned long long)results.send_errors);
+    printf("expected %llu\n", (unsigned long long)results.expected);
+    printf("delivered %llu\n", (unsigned long long)results.delivered);
+    printf("other_received %llu\n", (unsigned long long)results.other);
+    printf("loss_pct %.3f\n", loss);
+    printf("send_rate_msg_s %.1f\n", send_secs > 0 ? (double)results.sent / send_secs : 0.0);
+    printf("delivery_rate_msg_s %.1f\n", recv_secs > 0 ? (double)results.delivered / recv_secs : 0.0);
+    printf("delivery_rate_kb_s %.1f\n",
+           recv_secs > 0 ? (double)results.delivered * sizeof(Request) / 1024.0 / recv_secs : 0.0);
+    printf("latency_us p50=%.1f p90=%.1f p99=%.1f p999=%.1f max=%.1f mean=%.1f\n",
+           metrics_percentile(h, 0.50) / 1000.0, metrics_percentile(h, 0.90) / 1000.0,
+           metrics_percentile(h, 0.99) / 1000.0, metrics_percentile(h, 0.999) / 1000.0,
+           h->max / 1000.0, h->count ? (double)h->sum / (double)h->count / 1000.0 : 0.0);
+
+    // Histogramme regroupé par puissance de 2
+    const int sub_count = 1 << METRICS_SUB_BITS;
+    printf("# histogram: le_us count pct\n");
+    for (int g = 0; g < METRICS_BUCKETS / sub_count; g++) {
+        uint64_t count = 0;
+        for (int b = g * sub_count; b < (g + 1) * sub_count; b++) count += h->buckets[b];
+        if (count == 0) continue;
+        printf("le_us %.1f %llu %.2f\n", (metrics_bucket_upper_bound(g * sub_count + sub_count - 1) + 1) / 1000.0,
+               (unsigned long long)count, 100.0 * (double)count / (double)h->count);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "s:u:r:m:d:w:l:n:h")) != -1) {
+        switch (opt) {
+            case 's': config.server_ip = optarg; break;
+            case 'u': config.users = atoi(optarg); break;
+            case 'r': config.rooms = atoi(optarg); break;
+            case 'm': config.rate = atof(optarg); break;
+            case 'd': config.duration = atoi(optarg); break;
+            case 'w': config.drain = atoi(optarg); break;
+            case 'l': config.size = atoi(optarg); break;
+            case 'n': config.prefix = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (config.users < 2 || config.rooms < 1 || config.rooms > config.users || config.rate <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, handle_sigint);
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(SERVER_PORT);
+    if (inet_pton(AF_INET, config.server_ip, &server_addr.sin_addr) <= 0) {
+        fprintf(stderr, "Adresse IP invalide: %s\n", config.server_ip);
+        return EXIT_FAILURE;
+    }
+
+    raise_fd_limit();
+    if (create_users() < 0) return EXIT_FAILURE;
+
+    fprintf(stderr, "Connexion de %d utilisateurs...\n", config.users);
+    int connected = run_step(STEP_CONNECT);
+
+    fprintf(stderr, "%d connectés, création de %d salons...\n", connected, config.rooms);
+    run_step(STEP_CREATE);
+    int joined = run_step(STEP_JOIN);
+    for (int i = 0; i < config.users; i++) {
+        if (users[i].joined) room_members[users[i].room]++;
+    }
+
+    // Laisser passer les annonces d'arrivée avant de mesurer
+    uint64_t settle = metrics_now_ns() + 500000000ULL;
+    while (running && metrics_now_ns() < settle) poll_sockets(10, 0, STEP_CONNECT);
+    results.other = 0;
+
+    fprintf(stderr, "%d dans un salon, envoi à %.0f msg/s pendant %d s...\n",
+            joined, config.rate, config.duration);
+    send_traffic();
+
+    print_results(connected, joined);
+
+    disconnect_users();
+    for (int i = 0; i < config.users; i++) close(users[i].fd);
+    close(epoll_fd);
+    free(users);
+    free(room_members);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+// loadgen.h
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <stdint.h>
+#include "common.h"
+#include "metrics.h"
+
+#define LOADGEN_PASSWORD       "loadgen"
+#define LOADGEN_WINDOW         64    // Requêtes de mise en place en vol simultanément
+#define LOADGEN_RETRIES        3     // Nouvelles tentatives avant abandon d'un utilisateur
+#define LOADGEN_REPLY_TIMEOUT  1000  // Délai d'attente d'une réponse (ms)
+#define LOADGEN_SEND_BATCH     256   // Envois maximum par tour de boucle
+#define LOADGEN_MARKER         "LG "  // Préfixe des messages générés
+
+// Paramètres de la charge
+typedef struct {
+    const char *server_ip;
+    const char *prefix;   // Préfixe des pseudonymes et des salons
+    int users;
+    int rooms;
+    double rate;          // Messages envoyés par seconde (tous utilisateurs)
+    int duration;         // Durée de l'envoi (secondes)
+    int drain;            // Attente des derniers messages après l'envoi (secondes)
+    int size;             // Taille du contenu des messages (octets)
+} LoadGenConfig;
+
+// Étapes de mise en place
+typedef enum {
+    STEP_CONNECT,
+    STEP_CREATE,
+    STEP_JOIN
+} LoadGenStep;
+
+// Utilisateur simulé : une socket UDP par utilisateur
+typedef struct {
+    int fd;
+    char username[50];
+    int room;
+    int connected;
+    int joined;
+    int pending;          // Réponse attendue pour l'étape en cours
+    int retries;
+    uint64_t deadline_ns;
+} LoadGenUser;
+
+// Résultats mesurés
+typedef struct {
+    uint64_t sent;
+    uint64_t send_errors;
+    uint64_t expected;    // Livraisons attendues (membres du salon hors expéditeur)
+    uint64_t delivered;
+    uint64_t other;       // Messages reçus non générés (annonces, erreurs)
+    uint64_t start_ns;
+    uint64_t send_end_ns;
+    uint64_t last_delivery_ns;
+    MetricsHistogramData latency;  // Latence de bout en bout (ns)
+} LoadGenResults;
+
+#endif /* LOADGEN_H */
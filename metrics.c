@@ -0,0 +1,452 @@
+// metrics.c
+#include "metrics.h"
+#include "common.h"
+#include <time.h>
+
+// Emplacement de métriques d'un thread, aligné sur une ligne de cache pour
+// qu'aucun autre thread n'écrive dans les mêmes lignes
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    MetricsHistogramData histograms[METRIC_HISTOGRAM_COUNT];
+    MetricsHistogramData commands[METRICS_MAX_COMMANDS];
+    int shared;   // 1 : emplacement partagé, mises à jour atomiques
+    int in_use;   // 1 : attribué à un thread vivant
+} __attribute__((aligned(64))) MetricsSlot;
+
+static MetricsSlot *slots[METRICS_MAX_THREADS];
+static int nb_slots = 0;
+static MetricsSlot shared_slot = { .shared = 1, .in_use = 1 };
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+static __thread MetricsSlot *thread_slot = NULL;
+
+// Une jauge par ligne de cache : mises à jour atomiques, rares (transferts)
+static struct {
+    int64_t value;
+    char pad[64 - sizeof(int64_t)];
+} gauges[METRIC_GAUGE_COUNT] __attribute__((aligned(64)));
+
+static char command_names[METRICS_MAX_COMMANDS][32];
+static int nb_commands = 0;
+
+static pthread_t dump_thread;
+static int dump_started = 0;
+
+// Libère l'emplacement à la fin du thread ; ses valeurs restent comptées
+static void release_slot(void *arg) {
+    MetricsSlot *slot = arg;
+    pthread_mutex_lock(&registry_mutex);
+    slot->in_use = 0;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void create_slot_key(void) {
+    pthread_key_create(&slot_key, release_slot);
+}
+
+static MetricsSlot *get_slot(void) {
+    if (thread_slot) return thread_slot;
+
+    pthread_once(&slot_key_once, create_slot_key);
+
+    MetricsSlot *slot = NULL;
+    pthread_mutex_lock(&registry_mutex);
+    // Réutiliser l'emplacement d'un thread terminé
+    for (int i = 0; i < nb_slots; i++) {
+        if (!slots[i]->in_use) {
+            slot = slots[i];
+            break;
+        }
+    }
+    if (!slot && nb_slots < METRICS_MAX_THREADS) {
+        slot = aligned_alloc(64, sizeof(MetricsSlot));
+        if (slot) {
+            memset(slot, 0, sizeof(MetricsSlot));
+            // Publier l'emplacement après son initialisation
+            __atomic_store_n(&slots[nb_slots], slot, __ATOMIC_RELEASE);
+            __atomic_store_n(&nb_slots, nb_slots + 1, __ATOMIC_RELEASE);
+        }
+    }
+    if (slot) {
+        slot->in_use = 1;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (!slot) {
+        // Trop de threads : emplacement commun mis à jour atomiquement
+        thread_slot = &shared_slot;
+        return thread_slot;
+    }
+
+    pthread_setspecific(slot_key, slot);
+    thread_slot = slot;
+    return slot;
+}
+
+// Un seul écrivain par emplacement : une lecture et une écriture simples suffisent
+static inline void slot_add(const MetricsSlot *slot, uint64_t *value, uint64_t delta) {
+    if (slot->shared) {
+        __atomic_fetch_add(value, delta, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void slot_max(const MetricsSlot *slot, uint64_t *value, uint64_t candidate) {
+    uint64_t current = __atomic_load_n(value, __ATOMIC_RELAXED);
+    if (!slot->shared) {
+        if (candidate > current) __atomic_store_n(value, candidate, __ATOMIC_RELAXED);
+        return;
+    }
+    while (candidate > current &&
+           !__atomic_compare_exchange_n(value, &current, candidate, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline int bucket_index(uint64_t value) {
+    const int sub_count = 1 << METRICS_SUB_BITS;
+    if (value < (uint64_t)sub_count) return (int)value;
+
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > METRICS_MAX_EXPONENT) return METRICS_BUCKETS - 1;
+
+    int sub = (int)((value >> (exponent - METRICS_SUB_BITS)) & (uint64_t)(sub_count - 1));
+    return (exponent - METRICS_SUB_BITS + 1) * sub_count + sub;
+}
+
+uint64_t metrics_bucket_upper_bound(int index) {
+    const int sub_count = 1 << METRICS_SUB_BITS;
+    if (index < sub_count) return (uint64_t)index;
+
+    int group = index / sub_count;
+    int sub = index % sub_count;
+    int exponent = group + METRICS_SUB_BITS - 1;
+    int shift = exponent - METRICS_SUB_BITS;
+    uint64_t lower = (uint64_t)(sub_count + sub) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+static void histogram_record(const MetricsSlot *slot, MetricsHistogramData *h, uint64_t value) {
+    slot_add(slot, &h->buckets[bucket_index(value)], 1);
+    slot_add(slot, &h->count, 1);
+    slot_add(slot, &h->sum, value);
+    slot_max(slot, &h->max, value);
+}
+
+void metrics_histogram_add(MetricsHistogramData *h, uint64_t value) {
+    h->buckets[bucket_index(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+void metrics_add(MetricCounter counter, uint64_t value) {
+    MetricsSlot *slot = get_slot();
+    slot_add(slot, &slot->counters[counter], value);
+}
+
+void metrics_record(MetricHistogram histogram, uint64_t value) {
+    MetricsSlot *slot = get_slot();
+    histogram_record(slot, &slot->histograms[histogram], value);
+}
+
+void metrics_record_command(int index, uint64_t duration_ns) {
+    if (index < 0 || index >= METRICS_MAX_COMMANDS) return;
+    MetricsSlot *slot = get_slot();
+    histogram_record(slot, &slot->commands[index], duration_ns);
+    histogram_record(slot, &slot->histograms[H_PROCESS_COMMAND], duration_ns);
+}
+
+void metrics_register_command(int index, const char *name) {
+    if (index < 0 || index >= METRICS_MAX_COMMANDS) return;
+    strncpy(command_names[index], name, sizeof(command_names[index]) - 1);
+    if (index >= nb_commands) nb_commands = index + 1;
+}
+
+void metrics_gauge_add(MetricGauge gauge, int64_t delta) {
+    __atomic_fetch_add(&gauges[gauge].value, delta, __ATOMIC_RELAXED);
+}
+
+int64_t metrics_gauge_get(MetricGauge gauge) {
+    return __atomic_load_n(&gauges[gauge].value, __ATOMIC_RELAXED);
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void histogram_merge(MetricsHistogramData *dst, const MetricsHistogramData *src) {
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (max > dst->max) dst->max = max;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        dst->buckets[b] += __atomic_load_n(&src->buckets[b], __ATOMIC_RELAXED);
+    }
+}
+
+static void slot_merge(MetricsSnapshot *snapshot, const MetricsSlot *slot) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        snapshot->counters[c] += __atomic_load_n(&slot->counters[c], __ATOMIC_RELAXED);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        histogram_merge(&snapshot->histograms[h], &slot->histograms[h]);
+    }
+    for (int c = 0; c < snapshot->nb_commands; c++) {
+        histogram_merge(&snapshot->commands[c], &slot->commands[c]);
+    }
+}
+
+void metrics_snapshot(MetricsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(MetricsSnapshot));
+    snapshot->nb_commands = nb_commands;
+
+    slot_merge(snapshot, &shared_slot);
+    int count = __atomic_load_n(&nb_slots, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        slot_merge(snapshot, __atomic_load_n(&slots[i], __ATOMIC_ACQUIRE));
+    }
+}
+
+uint64_t metrics_percentile(const MetricsHistogramData *histogram, double q) {
+    if (histogram->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(q * (double)histogram->count);
+    if (rank >= histogram->count) rank = histogram->count - 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen > rank) {
+            uint64_t bound = metrics_bucket_upper_bound(b);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+static const char *counter_names[METRIC_COUNTER_COUNT] = {
+    "requests_received", "bytes_received", "recv_errors",
+    "responses_sent", "bytes_sent", "send_failures",
+    "messages_broadcast", "fanout_sends",
+    "commands_unknown", "commands_denied",
+    "uploads_completed", "uploads_failed", "upload_bytes",
+    "downloads_completed", "downloads_failed", "download_bytes",
+    "clients_lock_acquired", "clients_lock_contended",
+    "salons_lock_acquired", "salons_lock_contended",
+    "egress_batches", "egress_queue_full",
+    "reliable_sent", "reliable_retransmits", "reliable_acks", "reliable_abandoned",
+    "flow_dropped_credits", "flow_dropped_queue", "flow_notices",
+    "ratelimit_message", "ratelimit_command", "ratelimit_heavy", "ratelimit_connect",
+    "ratelimit_mutes",
+    "timers_fired", "clients_evicted", "transfer_timeouts",
+    "fanout_skipped",
+    "slab_allocs", "slab_frees", "slab_refills", "slab_large",
+    "listing_renders", "listing_hits",
+    "presence_events", "presence_coalesced", "presence_notices"
+};
+
+static const char *gauge_names[METRIC_GAUGE_COUNT] = {
+    "active_uploads", "active_downloads", "slab_pages"
+};
+
+static const char *histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    "process_request_ns", "process_command_ns", "broadcast_room_ns",
+    "fanout_size", "upload_ns", "download_ns", "egress_batch_size",
+    "reliable_rtt_ns"
+};
+
+static void write_histogram(FILE *f, const char *name, const char *label,
+                            const MetricsHistogramData *h) {
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    const char *sep = label[0] ? "," : "";
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        fprintf(f, "far_%s{%s%squantile=\"%g\"} %llu\n", name, label, sep, quantiles[i],
+                (unsigned long long)metrics_percentile(h, quantiles[i]));
+    }
+    const char *lbrace = label[0] ? "{" : "";
+    const char *rbrace = label[0] ? "}" : "";
+    fprintf(f, "far_%s_max%s%s%s %llu\n", name, lbrace, label, rbrace, (unsigned long long)h->max);
+    fprintf(f, "far_%s_sum%s%s%s %llu\n", name, lbrace, label, rbrace, (unsigned long long)h->sum);
+    fprintf(f, "far_%s_count%s%s%s %llu\n", name, lbrace, label, rbrace, (unsigned long long)h->count);
+}
+
+// Réécrit le fichier de métriques de façon atomique (fichier temporaire + rename)
+static void metrics_dump_file(const char *path) {
+    MetricsSnapshot *snapshot = malloc(sizeof(MetricsSnapshot));
+    if (!snapshot) return;
+    metrics_snapshot(snapshot);
+
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        perror("Erreur lors de l'écriture des métriques");
+        free(snapshot);
+        return;
+    }
+
+    fprintf(f, "# Métriques du serveur FAR (%lld)\n", (long long)time(NULL));
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        fprintf(f, "far_%s_total %llu\n", counter_names[c], (unsigned long long)snapshot->counters[c]);
+    }
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+        fprintf(f, "far_%s %lld\n", gauge_names[g], (long long)metrics_gauge_get((MetricGauge)g));
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        write_histogram(f, histogram_names[h], "", &snapshot->histograms[h]);
+    }
+    for (int c = 0; c < snapshot->nb_commands; c++) {
+        if (command_names[c][0] == '\0') continue;
+        char label[64];
+        snprintf(label, sizeof(label), "command=\"%s\"", command_names[c]);
+        write_histogram(f, "command_ns", label, &snapshot->commands[c]);
+    }
+
+    fclose(f);
+    rename(tmp_path, path);
+    free(snapshot);
+}
+
+static void *metrics_dump_thread(void *arg) {
+    (void)arg;
+    int elapsed = 0;
+    while (running) {
+        sleep(1);
+        if (++elapsed >= METRICS_DUMP_INTERVAL) {
+            metrics_dump_file(METRICS_FILE);
+            elapsed = 0;
+        }
+    }
+    // Dernière écriture à l'arrêt
+    metrics_dump_file(METRICS_FILE);
+    return NULL;
+}
+
+int init_metrics(void) {
+    if (pthread_create(&dump_thread, NULL, metrics_dump_thread, NULL) != 0) {
+        perror("Erreur lors de la création du thread des métriques");
+        return -1;
+    }
+    dump_started = 1;
+    return 0;
+}
+
+void shutdown_metrics(void) {
+    if (dump_started) {
+        pthread_join(dump_thread, NULL);
+        dump_started = 0;
+    }
+}
+
+int metrics_format_summary(char *buffer, size_t size) {
+    MetricsSnapshot *s = malloc(sizeof(MetricsSnapshot));
+    if (!s) return snprintf(buffer, size, "Erreur: allocation mémoire insuffisante");
+    metrics_snapshot(s);
+
+    const MetricsHistogramData *req = &s->histograms[H_PROCESS_REQUEST];
+    const MetricsHistogramData *cmd = &s->histograms[H_PROCESS_COMMAND];
+    const MetricsHistogramData *bc = &s->histograms[H_BROADCAST];
+    const MetricsHistogramData *fan = &s->histograms[H_FANOUT_SIZE];
+    const MetricsHistogramData *batch = &s->histograms[H_EGRESS_BATCH];
+    const MetricsHistogramData *rtt = &s->histograms[H_RELIABLE_RTT];
+
+    int len = snprintf(buffer, size,
+        "=== MÉTRIQUES SERVEUR ===\n"
+        "Reçu: %llu requêtes, %llu octets, %llu erreurs\n"
+        "Envoyé: %llu réponses, %llu octets, %llu échecs\n"
+        "Lots d'envoi: %llu (taille p50/max %llu/%llu), %llu attentes (file pleine)\n"
+        "Fiabilité: %llu numérotés, %llu retransmis, %llu acquittements, %llu abandonnés, RTT p50/p99 %llu/%llu µs\n"
+        "Contrôle de flux: %llu diffusions refusées (crédits), %llu abandonnées (file saturée), %llu avis\n"
+        "Limitation de débit: %llu messages, %llu commandes, %llu commandes coûteuses, %llu connexions refusés, %llu mutes automatiques\n"
+        "Diffusions: %llu (%llu envois, %llu suspects ignorés, taille p50/p99/max %llu/%llu/%llu)\n"
+        "Commandes: %llu inconnues, %llu refusées\n"
+        "Listes: %llu pages rendues, %llu servies depuis le cache\n"
+        "Allocateur: %llu objets en cours, %llu allocations, %llu remplissages de cache, %llu hors classe, %lld pages\n"
+        "Uploads: %llu ok, %llu échecs, %llu octets\n"
+        "Downloads: %llu ok, %llu échecs, %llu octets\n"
+        "Latence p50/p99/max (µs):\n"
+        " requête %llu/%llu/%llu\n"
+        " commande %llu/%llu/%llu\n"
+        " diffusion %llu/%llu/%llu\n",
+        (unsigned long long)s->counters[M_REQUESTS_RECEIVED],
+        (unsigned long long)s->counters[M_BYTES_RECEIVED],
+        (unsigned long long)s->counters[M_RECV_ERRORS],
+        (unsigned long long)s->counters[M_RESPONSES_SENT],
+        (unsigned long long)s->counters[M_BYTES_SENT],
+        (unsigned long long)s->counters[M_SEND_FAILURES],
+        (unsigned long long)s->counters[M_EGRESS_BATCHES],
+        (unsigned long long)metrics_percentile(batch, 0.5),
+        (unsigned long long)batch->max,
+        (unsigned long long)s->counters[M_EGRESS_QUEUE_FULL],
+        (unsigned long long)s->counters[M_RELIABLE_SENT],
+        (unsigned long long)s->counters[M_RELIABLE_RETRANSMITS],
+        (unsigned long long)s->counters[M_RELIABLE_ACKS],
+        (unsigned long long)s->counters[M_RELIABLE_ABANDONED],
+        (unsigned long long)(metrics_percentile(rtt, 0.5) / 1000),
+        (unsigned long long)(metrics_percentile(rtt, 0.99) / 1000),
+        (unsigned long long)s->counters[M_FLOW_DROPPED_CREDITS],
+        (unsigned long long)s->counters[M_FLOW_DROPPED_QUEUE],
+        (unsigned long long)s->counters[M_FLOW_NOTICES],
+        (unsigned long long)s->counters[M_RATELIMIT_MESSAGE],
+        (unsigned long long)s->counters[M_RATELIMIT_COMMAND],
+        (unsigned long long)s->counters[M_RATELIMIT_HEAVY],
+        (unsigned long long)s->counters[M_RATELIMIT_CONNECT],
+        (unsigned long long)s->counters[M_RATELIMIT_MUTES],
+        (unsigned long long)s->counters[M_MESSAGES_BROADCAST],
+        (unsigned long long)s->counters[M_FANOUT_SENDS],
+        (unsigned long long)s->counters[M_FANOUT_SKIPPED],
+        (unsigned long long)metrics_percentile(fan, 0.5),
+        (unsigned long long)metrics_percentile(fan, 0.99),
+        (unsigned long long)fan->max,
+        (unsigned long long)s->counters[M_COMMANDS_UNKNOWN],
+        (unsigned long long)s->counters[M_COMMANDS_DENIED],
+        (unsigned long long)s->counters[M_LISTING_RENDERS],
+        (unsigned long long)s->counters[M_LISTING_HITS],
+        (unsigned long long)(s->counters[M_SLAB_ALLOCS] - s->counters[M_SLAB_FREES]),
+        (unsigned long long)s->counters[M_SLAB_ALLOCS],
+        (unsigned long long)s->counters[M_SLAB_REFILLS],
+        (unsigned long long)s->counters[M_SLAB_LARGE],
+        (long long)metrics_gauge_get(G_SLAB_PAGES),
+        (unsigned long long)s->counters[M_UPLOADS_COMPLETED],
+        (unsigned long long)s->counters[M_UPLOADS_FAILED],
+        (unsigned long long)s->counters[M_UPLOAD_BYTES],
+        (unsigned long long)s->counters[M_DOWNLOADS_COMPLETED],
+        (unsigned long long)s->counters[M_DOWNLOADS_FAILED],
+        (unsigned long long)s->counters[M_DOWNLOAD_BYTES],
+        (unsigned long long)(metrics_percentile(req, 0.5) / 1000),
+        (unsigned long long)(metrics_percentile(req, 0.99) / 1000),
+        (unsigned long long)(req->max / 1000),
+        (unsigned long long)(metrics_percentile(cmd, 0.5) / 1000),
+        (unsigned long long)(metrics_percentile(cmd, 0.99) / 1000),
+        (unsigned long long)(cmd->max / 1000),
+        (unsigned long long)(metrics_percentile(bc, 0.5) / 1000),
+        (unsigned long long)(metrics_percentile(bc, 0.99) / 1000),
+        (unsigned long long)(bc->max / 1000));
+
+    // Commandes les plus utilisées
+    int used[METRICS_MAX_COMMANDS] = {0};
+    if (len > 0 && (size_t)len < size) {
+        len += snprintf(buffer + len, size - (size_t)len, "Top commandes:");
+    }
+    for (int rank = 0; rank < 5 && len > 0 && (size_t)len < size; rank++) {
+        int best = -1;
+        for (int c = 0; c < s->nb_commands; c++) {
+            if (!used[c] && s->commands[c].count > 0 &&
+                (best < 0 || s->commands[c].count > s->commands[best].count)) {
+                best = c;
+            }
+        }
+        if (best < 0) break;
+        used[best] = 1;
+        len += snprintf(buffer + len, size - (size_t)len, " %s=%llu", command_names[best],
+                        (unsigned long long)s->commands[best].count);
+    }
+
+    free(s);
+    return len;
+}
@@ -0,0 +1,154 @@
+// metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define METRICS_FILE           "metrics.txt"
+#define METRICS_DUMP_INTERVAL  10   // Secondes entre deux réécritures du fichier
+#define METRICS_MAX_THREADS    64   // Emplacements par thread (au-delà : emplacement partagé)
+#define METRICS_MAX_COMMANDS   32
+
+// Histogrammes log-linéaires (type HDR) : 8 sous-intervalles par puissance de 2,
+// soit une précision relative d'environ 12%, valeurs jusqu'à 2^36 (~68 s en ns)
+#define METRICS_SUB_BITS       3
+#define METRICS_MAX_EXPONENT   36
+#define METRICS_BUCKETS        ((1 << METRICS_SUB_BITS) * (METRICS_MAX_EXPONENT - METRICS_SUB_BITS + 2))
+
+// Compteurs
+typedef enum {
+    M_REQUESTS_RECEIVED,
+    M_BYTES_RECEIVED,
+    M_RECV_ERRORS,
+    M_RESPONSES_SENT,
+    M_BYTES_SENT,
+    M_SEND_FAILURES,
+    M_MESSAGES_BROADCAST,
+    M_FANOUT_SENDS,
+    M_COMMANDS_UNKNOWN,
+    M_COMMANDS_DENIED,
+    M_UPLOADS_COMPLETED,
+    M_UPLOADS_FAILED,
+    M_UPLOAD_BYTES,
+    M_DOWNLOADS_COMPLETED,
+    M_DOWNLOADS_FAILED,
+    M_DOWNLOAD_BYTES,
+    M_CLIENTS_LOCK_ACQUIRED,
+    M_CLIENTS_LOCK_CONTENDED,
+    M_SALONS_LOCK_ACQUIRED,
+    M_SALONS_LOCK_CONTENDED,
+    M_EGRESS_BATCHES,
+    M_EGRESS_QUEUE_FULL,
+    M_RELIABLE_SENT,
+    M_RELIABLE_RETRANSMITS,
+    M_RELIABLE_ACKS,
+    M_RELIABLE_ABANDONED,
+    M_FLOW_DROPPED_CREDITS,
+    M_FLOW_DROPPED_QUEUE,
+    M_FLOW_NOTICES,
+    M_RATELIMIT_MESSAGE,      // Refus par classe, dans l'ordre de RateClass
+    M_RATELIMIT_COMMAND,
+    M_RATELIMIT_HEAVY,
+    M_RATELIMIT_CONNECT,
+    M_RATELIMIT_MUTES,
+    M_TIMERS_FIRED,
+    M_CLIENTS_EVICTED,
+    M_TRANSFER_TIMEOUTS,
+    M_FANOUT_SKIPPED,         // Destinataires suspects exclus d'une diffusion
+    M_SLAB_ALLOCS,            // Objets de l'allocateur slab (voir slab.h)
+    M_SLAB_FREES,
+    M_SLAB_REFILLS,           // Échanges entre un cache de thread et la liste commune
+    M_SLAB_LARGE,             // Demandes trop grandes, servies par malloc
+    M_LISTING_RENDERS,        // Pages de @list / @rooms rendues
+    M_LISTING_HITS,           // Pages envoyées depuis le cache, table inchangée
+    M_PRESENCE_EVENTS,        // Arrivées et départs enregistrés (voir presence.h)
+    M_PRESENCE_COALESCED,     // Allers-retours annulés avant l'annonce
+    M_PRESENCE_NOTICES,       // Messages d'annonce envoyés
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+// Histogrammes (durées en nanosecondes sauf H_FANOUT_SIZE et H_EGRESS_BATCH)
+typedef enum {
+    H_PROCESS_REQUEST,
+    H_PROCESS_COMMAND,
+    H_BROADCAST,
+    H_FANOUT_SIZE,
+    H_UPLOAD,
+    H_DOWNLOAD,
+    H_EGRESS_BATCH,
+    H_RELIABLE_RTT,
+    METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+// Jauges (valeurs instantanées, peuvent diminuer)
+typedef enum {
+    G_ACTIVE_UPLOADS,
+    G_ACTIVE_DOWNLOADS,
+    G_SLAB_PAGES,
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[METRICS_BUCKETS];
+} MetricsHistogramData;
+
+// Vue agrégée de tous les threads (lue sans verrou)
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    MetricsHistogramData histograms[METRIC_HISTOGRAM_COUNT];
+    MetricsHistogramData commands[METRICS_MAX_COMMANDS];
+    int nb_commands;
+} MetricsSnapshot;
+
+// Démarre le thread qui réécrit périodiquement METRICS_FILE
+int  init_metrics(void);
+void shutdown_metrics(void);
+
+// Associe un nom à l'indice d'une commande (table des commandes)
+void metrics_register_command(int index, const char *name);
+
+// Mise à jour depuis n'importe quel thread (sans verrou ni instruction atomique
+// verrouillée : chaque thread écrit dans son propre emplacement)
+void metrics_add(MetricCounter counter, uint64_t value);
+void metrics_record(MetricHistogram histogram, uint64_t value);
+void metrics_record_command(int index, uint64_t duration_ns);
+
+static inline void metrics_inc(MetricCounter counter) {
+    metrics_add(counter, 1);
+}
+
+void    metrics_gauge_add(MetricGauge gauge, int64_t delta);
+int64_t metrics_gauge_get(MetricGauge gauge);
+
+// Verrouille un mutex en comptant les acquisitions et celles qui ont dû attendre
+static inline void metrics_mutex_lock(pthread_mutex_t *mutex, MetricCounter acquired,
+                                      MetricCounter contended) {
+    if (pthread_mutex_trylock(mutex) != 0) {
+        metrics_inc(contended);
+        pthread_mutex_lock(mutex);
+    }
+    metrics_inc(acquired);
+}
+
+// Horloge monotone en nanosecondes
+uint64_t metrics_now_ns(void);
+
+// Agrège les emplacements de tous les threads
+void metrics_snapshot(MetricsSnapshot *snapshot);
+
+// Valeur (borne supérieure de l'intervalle) au quantile q (0.0 - 1.0)
+uint64_t metrics_percentile(const MetricsHistogramData *histogram, double q);
+
+// Histogramme privé à un seul thread (outils de mesure)
+void     metrics_histogram_add(MetricsHistogramData *histogram, uint64_t value);
+uint64_t metrics_bucket_upper_bound(int index);
+
+// Résumé lisible pour la commande d'administration
+int  metrics_format_summary(char *buffer, size_t size);
+
+#endif /* METRICS_H */
@@ -0,0 +1,457 @@
+// microbench.c
+// Microbenchmarks des structures de données du serveur. server.c est lié sans
+// sa fonction main et avec des envois simulés (BENCH_STUB_SEND) : seuls les
+// parcours de tables et la logique de dispatch sont mesurés.
+#define _GNU_SOURCE  // Pour nftw
+#include "microbench.h"
+#include "slab.h"
+#include "presence.h"
+#include <ftw.h>
+#include <getopt.h>
+#include <time.h>
+
+static Server srv;
+static char (*query_names)[50] = NULL;  // Pseudonymes ou salons interrogés
+static int *query_index = NULL;
+static char bench_dir[256];
+static volatile int sink;               // Empêche l'élimination des appels par le compilateur
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Générateur pseudo-aléatoire déterministe : mêmes requêtes d'une exécution à l'autre
+static uint32_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (uint32_t)(*state >> 16);
+}
+
+// Construit un serveur sans sockets : users clients connectés et rooms salons vides
+static int build_server(int users, int rooms) {
+    memset(&srv, 0, sizeof(srv));
+    pthread_mutex_init(&srv.clients_mutex, NULL);
+    pthread_mutex_init(&srv.salons_mutex, NULL);
+    init_listing_caches(&srv);
+
+    srv.client_capacity = users > 10 ? users : 10;
+    srv.clients = calloc((size_t)srv.client_capacity, sizeof(ClientInfo));
+    srv.client_hot = calloc((size_t)srv.client_capacity, sizeof(ClientHot));
+    srv.salon_capacity = rooms > 10 ? rooms : 10;
+    srv.salons = calloc((size_t)srv.salon_capacity, sizeof(Salon));
+    if (!srv.clients || !srv.client_hot || !srv.salons) {
+        perror("Échec calloc serveur de test");
+        return -1;
+    }
+
+    // Remplissage direct, sans passer par add_client et create_room
+    time_t now = time(NULL);
+    char name[INTERN_NAME_SIZE];
+    for (int i = 0; i < users; i++) {
+        ClientInfo *c = &srv.clients[i];
+        ClientHot *hot = &srv.client_hot[i];
+        snprintf(name, sizeof(name), "user%d", i);
+        hot->id = intern_name(name);
+        if (hot->id == INTERN_NONE) return -1;
+        if (hot->id >= srv.client_by_id_capacity) {
+            uint32_t cap = srv.client_by_id_capacity ? srv.client_by_id_capacity : 64;
+            while (cap <= hot->id) cap *= 2;
+            int *map = realloc(srv.client_by_id, sizeof(int) * cap);
+            if (!map) {
+                perror("Échec realloc serveur de test");
+                return -1;
+            }
+            for (uint32_t k = srv.client_by_id_capacity; k < cap; k++) map[k] = -1;
+            srv.client_by_id = map;
+            srv.client_by_id_capacity = cap;
+        }
+        srv.client_by_id[hot->id] = i;
+        snprintf(c->password, sizeof(c->password), "pw");
+        c->role = ROLE_USER;
+        hot->addr.sin_family = AF_INET;
+        hot->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        hot->addr.sin_port = htons((uint16_t)(1024 + i % 60000));
+        hot->last_seen = now;
+        hot->connected = true;
+    }
+    srv.client_count = users;
+
+    for (int i = 0; i < rooms; i++) {
+        Salon *room = &srv.salons[i];
+        snprintf(room->nom, sizeof(room->nom), "room%d", i);
+        room->createur = intern_name("user0");
+        if (init_room_members(room) < 0) return -1;
+    }
+    srv.nb_salons = rooms;
+    return 0;
+}
+
+// Inscrit les utilisateurs [first, first + count) dans un salon
+static void fill_room(int rid, int first, int count) {
+    Salon *room = &srv.salons[rid];
+    if (room->nb_membres + count > room->membres_capacity &&
+        grow_room_members(room, room->nb_membres + count) < 0) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        add_room_member(room, srv.client_hot[first + i].id);
+        snprintf(srv.clients[first + i].salon_courant, MAX_NOM_SALON, "%s", room->nom);
+    }
+}
+
+static void free_server(void) {
+    for (int i = 0; i < srv.nb_salons; i++) free_room_members(&srv.salons[i]);
+    free(srv.salons);
+    free(srv.clients);
+    free(srv.client_hot);
+    free(srv.client_by_id);
+    pthread_mutex_destroy(&srv.clients_mutex);
+    pthread_mutex_destroy(&srv.salons_mutex);
+    free_listing_caches(&srv);
+    free(query_names);
+    free(query_index);
+    query_names = NULL;
+    query_index = NULL;
+}
+
+// Requêtes aléatoires parmi "<prefix><n>" pour n dans [first, first + count)
+static int make_queries(const char *prefix, int first, int count) {
+    query_names = malloc(sizeof(*query_names) * MICROBENCH_QUERIES);
+    query_index = malloc(sizeof(int) * MICROBENCH_QUERIES);
+    if (!query_names || !query_index) return -1;
+
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (int q = 0; q < MICROBENCH_QUERIES; q++) {
+        query_index[q] = first + (int)(next_random(&state) % (uint32_t)count);
+        snprintf(query_names[q], sizeof(query_names[q]), "%s%d", prefix, query_index[q]);
+    }
+    return 0;
+}
+
+/* ---- find_client_by_username ---- */
+
+static int setup_find_client(int scale) {
+    if (build_server(scale, 1) < 0 || make_queries("user", 0, scale) < 0) return -1;
+    return scale;
+}
+
+static void run_find_client(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        sink = find_client_by_username(&srv, query_names[i & (MICROBENCH_QUERIES - 1)]);
+    }
+}
+
+/* ---- find_room ---- */
+
+static int setup_find_room(int scale) {
+    if (build_server(1, scale) < 0 || make_queries("room", 0, scale) < 0) return -1;
+    return scale;
+}
+
+static void run_find_room(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        sink = find_room(&srv, query_names[i & (MICROBENCH_QUERIES - 1)]);
+    }
+}
+
+/* ---- join_room + remove_user ---- */
+
+static int join_members;
+static char join_target[MAX_NOM_SALON];
+
+static int setup_join_leave(int scale) {
+    int users = scale < 2 ? 2 : scale;
+    if (build_server(users, scale) < 0) return -1;
+
+    // La moitié des utilisateurs est déjà dans le salon visé, l'autre moitié y entre et en sort
+    join_members = users / 2 < MICROBENCH_MAX_FANOUT ? users / 2 : MICROBENCH_MAX_FANOUT;
+    int target = scale / 2;
+    fill_room(target, 0, join_members);
+    snprintf(join_target, sizeof(join_target), "room%d", target);
+
+    if (make_queries("user", users / 2, users - users / 2) < 0) return -1;
+    return join_members;
+}
+
+static void run_join_leave(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        const char *user = query_names[i & (MICROBENCH_QUERIES - 1)];
+        join_room(&srv, user, join_target);
+        remove_user(&srv, user, NULL);
+    }
+}
+
+/* ---- broadcast_room ---- */
+
+static Request broadcast_msg;
+
+static int setup_broadcast(int scale) {
+    if (build_server(scale, 1) < 0) return -1;
+    int members = scale < MICROBENCH_MAX_FANOUT ? scale : MICROBENCH_MAX_FANOUT;
+    fill_room(0, 0, members);
+    init_request(&broadcast_msg, REQ_MESSAGE, "user0", "", "Bonjour à tous");
+    return members;
+}
+
+static void run_broadcast(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        broadcast_room(&srv, "room0", &broadcast_msg, "user0");
+    }
+}
+
+/* ---- broadcast_all (annonces à tous les clients) ---- */
+
+static int setup_broadcast_all(int scale) {
+    if (build_server(scale, 1) < 0) return -1;
+    init_request(&broadcast_msg, REQ_MESSAGE, "Server", "", "user0 a rejoint le chat");
+    return scale;
+}
+
+static void run_broadcast_all(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        lock_clients(&srv);
+        broadcast_all(&srv, &broadcast_msg, 0);
+        pthread_mutex_unlock(&srv.clients_mutex);
+    }
+}
+
+/* ---- get_command_name ---- */
+
+static const char *command_samples[] = {
+    "@help", "@msg user42 bonjour, comment ça va ?", "@join salon_general",
+    "@download rapport_final.pdf", "@search general réunion demain", "@nosuchcommand"
+};
+#define NB_COMMAND_SAMPLES ((int)(sizeof(command_samples) / sizeof(command_samples[0])))
+
+static int setup_none(int scale) {
+    (void)scale;
+    return 0;
+}
+
+static void teardown_none(void) {
+}
+
+static void run_command_name(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        sink = (int)get_command_name(command_samples[i % NB_COMMAND_SAMPLES]).len;
+    }
+}
+
+/* ---- process_command (dispatch complet, envoi simulé) ---- */
+
+static struct sockaddr_in command_addr;
+
+static int setup_process_command(int scale) {
+    if (build_server(scale, 1) < 0 || make_queries("user", 0, scale) < 0) return -1;
+    command_addr.sin_family = AF_INET;
+    command_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return scale;
+}
+
+static void run_command(uint64_t n, const char *content) {
+    Request req;
+    init_request(&req, REQ_COMMAND, "", "", content);
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(req.sender, query_names[i & (MICROBENCH_QUERIES - 1)], sizeof(req.sender));
+        sink = process_command(&srv, &req, &command_addr);
+    }
+}
+
+static void run_process_ping(uint64_t n) {
+    run_command(n, "@ping");
+}
+
+static void run_process_unknown(uint64_t n) {
+    run_command(n, "@nosuchcommand");
+}
+
+// Liste paginée : table inchangée, la page en cache est renvoyée
+static void run_process_list(uint64_t n) {
+    run_command(n, "@list");
+}
+
+// Même liste, la table étant modifiée avant chaque appel : rendu complet
+static void run_process_list_render(uint64_t n) {
+    Request req;
+    init_request(&req, REQ_COMMAND, "", "", "@list");
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(req.sender, query_names[i & (MICROBENCH_QUERIES - 1)], sizeof(req.sender));
+        touch_clients(&srv);
+        sink = process_command(&srv, &req, &command_addr);
+    }
+}
+
+/* ---- presence_flush (reconnexion de tous les clients) ---- */
+
+static int setup_presence_storm(int scale) {
+    if (build_server(scale, 1) < 0) return -1;
+    init_presence(&srv);
+    return scale;
+}
+
+// Une opération : scale arrivées enregistrées puis annoncées en un lot
+static void run_presence_storm(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        lock_clients(&srv);
+        for (int c = 0; c < srv.client_count; c++) presence_event(&srv, c, 1, 0);
+        pthread_mutex_unlock(&srv.clients_mutex);
+        presence_flush(&srv);
+    }
+}
+
+static void teardown_presence_storm(void) {
+    free_server();
+    shutdown_presence();
+}
+
+/* ---- slab_alloc + slab_free (arguments d'un transfert) ---- */
+
+static void run_slab_transfer(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        FileTransferArgs *args = slab_alloc(sizeof(FileTransferArgs));
+        sink = args != NULL;
+        slab_free(args, sizeof(FileTransferArgs));
+    }
+}
+
+/* ---- generate_unique_filename ---- */
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+static int setup_unique_filename(int scale) {
+    snprintf(bench_dir, sizeof(bench_dir), "/tmp/microbench.XXXXXX");
+    if (!mkdtemp(bench_dir)) {
+        perror("Erreur mkdtemp");
+        return -1;
+    }
+
+    // Copies existantes (la fonction s'arrête à 100) puis fichiers sans rapport
+    int copies = scale < 99 ? scale : 99;
+    char path[512];
+    for (int i = 0; i < scale; i++) {
+        if (i == 0) snprintf(path, sizeof(path), "%s/rapport.txt", bench_dir);
+        else if (i == 1) snprintf(path, sizeof(path), "%s/rapport_copy.txt", bench_dir);
+        else if (i < copies) snprintf(path, sizeof(path), "%s/rapport_copy%d.txt", bench_dir, i);
+        else snprintf(path, sizeof(path), "%s/autre%d.bin", bench_dir, i);
+        int fd = open(path, O_WRONLY | O_CREAT, 0644);
+        if (fd >= 0) close(fd);
+    }
+    return copies;
+}
+
+static void run_unique_filename(uint64_t n) {
+    char buffer[256];
+    for (uint64_t i = 0; i < n; i++) {
+        generate_unique_filename(bench_dir, "rapport.txt", buffer, sizeof(buffer));
+        sink = buffer[0];
+    }
+}
+
+static void teardown_unique_filename(void) {
+    nftw(bench_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static const MicroBenchmark benchmarks[] = {
+    {"find_client_by_username", setup_find_client, run_find_client, free_server, 1},
+    {"find_room", setup_find_room, run_find_room, free_server, 1},
+    {"join_room_remove_user", setup_join_leave, run_join_leave, free_server, 1},
+    {"broadcast_room", setup_broadcast, run_broadcast, free_server, 1},
+    {"broadcast_all", setup_broadcast_all, run_broadcast_all, free_server, 1},
+    {"get_command_name", setup_none, run_command_name, teardown_none, 0},
+    {"presence_storm", setup_presence_storm, run_presence_storm, teardown_presence_storm, 1},
+    {"slab_transfer_args", setup_none, run_slab_transfer, teardown_none, 0},
+    {"process_command_ping", setup_process_command, run_process_ping, free_server, 1},
+    {"process_command_unknown", setup_process_command, run_process_unknown, free_server, 1},
+    {"process_command_list", setup_process_command, run_process_list, free_server, 1},
+    {"process_command_list_render", setup_process_command, run_process_list_render, free_server, 1},
+    {"generate_unique_filename", setup_unique_filename, run_unique_filename, teardown_unique_filename, 1},
+};
+
+// Double le nombre d'itérations jusqu'à atteindre la durée minimale de mesure
+static void measure(const MicroBenchmark *b, int scale, uint64_t min_ns) {
+    int param = b->setup(scale);
+    if (param < 0) {
+        fprintf(stderr, "%s: échec de la préparation (échelle %d)\n", b->name, scale);
+        b->teardown();
+        return;
+    }
+
+    b->run(1);  // Préchauffage
+
+    uint64_t iterations = 1, elapsed = 0;
+    for (;;) {
+        uint64_t start = now_ns();
+        b->run(iterations);
+        elapsed = now_ns() - start;
+        if (elapsed >= min_ns) break;
+
+        // Viser directement la durée minimale, sans multiplier par plus de 100
+        uint64_t target = elapsed ? iterations * min_ns / elapsed + 1 : iterations * 100;
+        if (target > iterations * 100) target = iterations * 100;
+        if (target <= iterations) target = iterations * 2;
+        iterations = target;
+    }
+
+    printf("%s,%d,%d,%llu,%.1f\n", b->name, b->scaled ? scale : 0, param,
+           (unsigned long long)iterations, (double)elapsed / (double)iterations);
+    fflush(stdout);
+    b->teardown();
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-s échelles] [-t ms] [-b filtre]\n"
+            "  -s 10,100,1000,10000,100000  nombre d'utilisateurs / de salons\n"
+            "  -t 100                       durée minimale de mesure par cas (ms)\n"
+            "  -b find                      ne lancer que les cas dont le nom contient le filtre\n"
+            "Sortie CSV: benchmark,scale,param,iterations,ns_per_op\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int scales[MICROBENCH_MAX_SCALES] = {10, 100, 1000, 10000, 100000};
+    int nb_scales = 5;
+    uint64_t min_ms = MICROBENCH_MIN_TIME_MS;
+    const char *filter = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:b:h")) != -1) {
+        switch (opt) {
+            case 's':
+                nb_scales = 0;
+                for (char *tok = strtok(optarg, ","); tok && nb_scales < MICROBENCH_MAX_SCALES;
+                     tok = strtok(NULL, ",")) {
+                    int scale = atoi(tok);
+                    if (scale > 0) scales[nb_scales++] = scale;
+                }
+                break;
+            case 't': min_ms = (uint64_t)atoi(optarg); break;
+            case 'b': filter = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (nb_scales == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("benchmark,scale,param,iterations,ns_per_op\n");
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        if (filter && !strstr(benchmarks[b].name, filter)) continue;
+        for (int s = 0; s < nb_scales; s++) {
+            measure(&benchmarks[b], scales[s], min_ms * 1000000ULL);
+            if (!benchmarks[b].scaled) break;
+        }
+    }
+    return EXIT_SUCCESS;
+}
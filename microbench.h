@@ -0,0 +1,23 @@
+// microbench.h
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdint.h>
+#include "server.h"
+#include "command.h"
+
+#define MICROBENCH_MAX_SCALES   16
+#define MICROBENCH_MIN_TIME_MS  100     // Durée minimale de mesure par cas
+#define MICROBENCH_MAX_FANOUT   1000    // Membres maximum du salon diffusé
+#define MICROBENCH_QUERIES      4096    // Requêtes précalculées (accès aléatoires)
+
+// Cas mesuré : prépare l'état à une échelle donnée puis exécute n opérations
+typedef struct {
+    const char *name;
+    int  (*setup)(int scale);            // Retourne le paramètre affiché (taille, membres...)
+    void (*run)(uint64_t iterations);
+    void (*teardown)(void);
+    int scaled;                          // 0 : indépendant de l'échelle, mesuré une seule fois
+} MicroBenchmark;
+
+#endif /* MICROBENCH_H */
@@ -0,0 +1,304 @@
+// offline.c
+#include "offline.h"
+#include <dirent.h>
+#include <stdint.h>
+#include <time.h>
+
+// Format d'un enregistrement sur disque (compact, sans remplissage) :
+// [timestamp: 4 octets][longueur expéditeur: 1 octet][longueur contenu: 2 octets]
+// suivis de l'expéditeur puis du contenu, sans '\0'.
+#define OFFLINE_HEADER_SIZE 7
+
+// Boîte non vide connue en mémoire
+typedef struct {
+    char username[50];
+    int count;     // Nombre de messages en attente
+    size_t bytes;  // Taille du fichier de la boîte
+} OfflineBox;
+
+static OfflineBox *boxes = NULL;
+static int nb_boxes = 0;
+static int boxes_capacity = 0;
+static pthread_mutex_t offline_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Construit le chemin de la boîte ; les caractères non sûrs sont encodés en %XX
+static void offline_path(const char *username, char *path, size_t size) {
+    int len = snprintf(path, size, "%s/", OFFLINE_DIR);
+    for (const unsigned char *p = (const unsigned char *)username; *p && len < (int)size - 4; p++) {
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+            (*p >= '0' && *p <= '9') || *p == '_' || *p == '-') {
+            path[len++] = (char)*p;
+        } else {
+            len += snprintf(path + len, size - (size_t)len, "%%%02X", *p);
+        }
+    }
+    snprintf(path + len, size - (size_t)len, ".q");
+}
+
+// Décode un nom de fichier de boîte (inverse de offline_path)
+static int decode_box_name(const char *filename, char *username, size_t size) {
+    size_t len = strlen(filename);
+    if (len < 3 || strcmp(filename + len - 2, ".q") != 0) return -1;
+
+    size_t j = 0;
+    for (size_t i = 0; i < len - 2 && j < size - 1; i++) {
+        unsigned int c;
+        if (filename[i] == '%' && i + 2 < len - 2 && sscanf(filename + i + 1, "%2x", &c) == 1) {
+            username[j++] = (char)c;
+            i += 2;
+        } else {
+            username[j++] = filename[i];
+        }
+    }
+    username[j] = '\0';
+    return 0;
+}
+
+// Recherche une boîte non vide (offline_mutex tenu)
+static int find_box(const char *username) {
+    for (int i = 0; i < nb_boxes; i++) {
+        if (strcmp(boxes[i].username, username) == 0) return i;
+    }
+    return -1;
+}
+
+static OfflineBox *add_box(const char *username) {
+    if (nb_boxes >= boxes_capacity) {
+        int new_capacity = boxes_capacity ? boxes_capacity * 2 : 8;
+        OfflineBox *new_boxes = realloc(boxes, sizeof(OfflineBox) * new_capacity);
+        if (!new_boxes) {
+            perror("Échec realloc boîtes hors ligne");
+            return NULL;
+        }
+        boxes = new_boxes;
+        boxes_capacity = new_capacity;
+    }
+
+    OfflineBox *box = &boxes[nb_boxes++];
+    strncpy(box->username, username, sizeof(box->username) - 1);
+    box->username[sizeof(box->username) - 1] = '\0';
+    box->count = 0;
+    box->bytes = 0;
+    return box;
+}
+
+static void remove_box(int i) {
+    boxes[i] = boxes[--nb_boxes];
+}
+
+// Compte les enregistrements valides d'une boîte existante
+static int count_records(const char *path, size_t *bytes) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    unsigned char header[OFFLINE_HEADER_SIZE];
+    int count = 0;
+    *bytes = 0;
+    while (fread(header, 1, sizeof(header), f) == sizeof(header)) {
+        size_t body = (size_t)header[4] + ((size_t)header[5] | ((size_t)header[6] << 8));
+        if (fseek(f, (long)body, SEEK_CUR) != 0) break;
+        *bytes += sizeof(header) + body;
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+void init_offline_queue(void) {
+    mkdir(OFFLINE_DIR, 0700);
+
+    DIR *dir = opendir(OFFLINE_DIR);
+    if (!dir) {
+        perror("Erreur lors de l'ouverture du dossier des messages hors ligne");
+        return;
+    }
+
+    pthread_mutex_lock(&offline_mutex);
+    struct dirent *entry;
+    int total = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        char username[50];
+        if (decode_box_name(entry->d_name, username, sizeof(username)) < 0) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", OFFLINE_DIR, entry->d_name);
+        size_t bytes;
+        int count = count_records(path, &bytes);
+        if (count <= 0) {
+            unlink(path);
+            continue;
+        }
+
+        OfflineBox *box = add_box(username);
+        if (box) {
+            box->count = count;
+            box->bytes = bytes;
+            total += count;
+        }
+    }
+    pthread_mutex_unlock(&offline_mutex);
+    closedir(dir);
+
+    if (total > 0) {
+        printf("%d message(s) hors ligne en attente pour %d utilisateur(s)\n", total, nb_boxes);
+    }
+}
+
+int offline_enqueue(const char *recipient, const char *sender, const char *content) {
+    size_t sender_len = strnlen(sender, 49);
+    size_t content_len = strnlen(content, MAX_MSG_SIZE - 1);
+    size_t record_len = OFFLINE_HEADER_SIZE + sender_len + content_len;
+
+    unsigned char record[OFFLINE_HEADER_SIZE + 49 + MAX_MSG_SIZE];
+    uint32_t ts = (uint32_t)time(NULL);
+    record[0] = (unsigned char)(ts & 0xFF);
+    record[1] = (unsigned char)((ts >> 8) & 0xFF);
+    record[2] = (unsigned char)((ts >> 16) & 0xFF);
+    record[3] = (unsigned char)((ts >> 24) & 0xFF);
+    record[4] = (unsigned char)sender_len;
+    record[5] = (unsigned char)(content_len & 0xFF);
+    record[6] = (unsigned char)((content_len >> 8) & 0xFF);
+    memcpy(record + OFFLINE_HEADER_SIZE, sender, sender_len);
+    memcpy(record + OFFLINE_HEADER_SIZE + sender_len, content, content_len);
+
+    char path[512];
+    offline_path(recipient, path, sizeof(path));
+
+    pthread_mutex_lock(&offline_mutex);
+
+    int b = find_box(recipient);
+    OfflineBox *box = (b >= 0) ? &boxes[b] : NULL;
+    if (box && (box->count >= OFFLINE_MAX_MESSAGES || box->bytes + record_len > OFFLINE_MAX_BYTES)) {
+        pthread_mutex_unlock(&offline_mutex);
+        return -1; // Boîte pleine
+    }
+
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (fd < 0) {
+        perror("Erreur lors de l'ouverture de la boîte hors ligne");
+        pthread_mutex_unlock(&offline_mutex);
+        return -2;
+    }
+    // Un seul write pour que l'enregistrement soit ajouté d'un bloc
+    ssize_t written = write(fd, record, record_len);
+    close(fd);
+    if (written != (ssize_t)record_len) {
+        perror("Erreur lors de l'écriture du message hors ligne");
+        pthread_mutex_unlock(&offline_mutex);
+        return -2;
+    }
+
+    if (!box) box = add_box(recipient);
+    int count = 0;
+    if (box) {
+        box->count++;
+        box->bytes += record_len;
+        count = box->count;
+    }
+
+    pthread_mutex_unlock(&offline_mutex);
+    return count;
+}
+
+// Réécrit la boîte à partir de l'offset from (messages non délivrés), via un
+// fichier temporaire renommé pour ne jamais laisser de boîte tronquée
+static int keep_from(FILE *f, long from, const char *path) {
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out || fseek(f, from, SEEK_SET) != 0) {
+        perror("Erreur lors de la réécriture de la boîte hors ligne");
+        if (out) fclose(out);
+        return -1;
+    }
+
+    char chunk[4096];
+    size_t n;
+    int failed = 0;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (fwrite(chunk, 1, n, out) != n) failed = 1;
+    }
+    if (fclose(out) != 0) failed = 1;
+    if (failed || rename(tmp_path, path) != 0) {
+        perror("Erreur lors de la réécriture de la boîte hors ligne");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int offline_flush(const char *username, OfflineDeliver deliver, void *ctx) {
+    // Verrou tenu jusqu'à la fin : aucun message ne s'ajoute à la boîte pendant
+    // sa lecture, et le fichier reste en place tant que tout n'est pas délivré
+    pthread_mutex_lock(&offline_mutex);
+
+    // Pas de boîte en mémoire : aucun accès disque
+    int b = find_box(username);
+    if (b < 0) {
+        pthread_mutex_unlock(&offline_mutex);
+        return 0;
+    }
+
+    char path[512];
+    offline_path(username, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        remove_box(b);
+        pthread_mutex_unlock(&offline_mutex);
+        return 0;
+    }
+
+    Request frame;
+    int delivered = 0;
+    long undelivered = -1;  // Offset du premier message refusé par deliver
+
+    unsigned char header[OFFLINE_HEADER_SIZE];
+    char sender[50];
+    char content[MAX_MSG_SIZE];
+
+    for (;;) {
+        long start = ftell(f);
+        if (fread(header, 1, sizeof(header), f) != sizeof(header)) break;
+        size_t sender_len = header[4];
+        size_t content_len = (size_t)header[5] | ((size_t)header[6] << 8);
+        if (sender_len >= sizeof(sender) || content_len >= sizeof(content) ||
+            fread(sender, 1, sender_len, f) != sender_len ||
+            fread(content, 1, content_len, f) != content_len) {
+            break;  // Enregistrement tronqué : illisible, abandonné
+        }
+        sender[sender_len] = '\0';
+        content[content_len] = '\0';
+
+        time_t ts = (time_t)((uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+                             ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24));
+        struct tm tm_info;
+        char when[16];
+        localtime_r(&ts, &tm_info);
+        strftime(when, sizeof(when), "%d/%m %H:%M", &tm_info);
+
+        char private_msg[MAX_MSG_SIZE];
+        snprintf(private_msg, sizeof(private_msg), "[Message privé de %s, %s]: %.*s",
+                 sender, when, MAX_MSG_SIZE - 100, content);
+        init_request(&frame, REQ_MESSAGE, "Server", "", private_msg);
+        if (deliver(&frame, ctx) < 0) {
+            undelivered = start;  // Celui-ci et les suivants restent en attente
+            break;
+        }
+        delivered++;
+    }
+
+    // Tout délivré : la boîte disparaît. Sinon elle ne garde que le reste, ou
+    // reste entière si la réécriture échoue (mieux vaut un doublon qu'une perte).
+    OfflineBox *box = &boxes[b];
+    if (undelivered < 0) {
+        unlink(path);
+        remove_box(b);
+    } else if (keep_from(f, undelivered, path) == 0) {
+        box->count -= delivered;
+        box->bytes -= (size_t)undelivered;
+    }
+    fclose(f);
+
+    pthread_mutex_unlock(&offline_mutex);
+    return delivered;
+}
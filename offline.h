@@ -0,0 +1,27 @@
+// offline.h
+#ifndef OFFLINE_H
+#define OFFLINE_H
+
+#include "common.h"
+
+#define OFFLINE_DIR           "./offline"
+#define OFFLINE_MAX_MESSAGES  100         // Messages en attente par utilisateur
+#define OFFLINE_MAX_BYTES     (32 * 1024) // Taille maximale d'une boîte sur disque
+
+// Charge l'état des boîtes existantes depuis OFFLINE_DIR
+void init_offline_queue(void);
+
+// Met un message privé en attente pour un utilisateur hors ligne.
+// Retourne le nombre de messages en attente, -1 si la boîte est pleine, -2 en cas d'erreur.
+int  offline_enqueue(const char *recipient, const char *sender, const char *content);
+
+// Envoi d'un message délivré ; retourne une valeur négative en cas d'échec
+typedef int (*OfflineDeliver)(Request *frame, void *ctx);
+
+// Passe à deliver les messages en attente d'un utilisateur qui vient de se
+// connecter, dans l'ordre. La boîte n'est supprimée qu'une fois tout délivré ; au
+// premier échec de deliver, ce message et les suivants restent en attente.
+// Retourne le nombre de messages délivrés.
+int  offline_flush(const char *username, OfflineDeliver deliver, void *ctx);
+
+#endif /* OFFLINE_H */
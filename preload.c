@@ -0,0 +1,222 @@
+// preload.c
+// Réponses statiques (@help, @credits) lues une fois puis découpées en trames.
+// Les lecteurs chargent le pointeur courant sans verrou ; un rechargement
+// (modification du fichier ou SIGHUP) publie une nouvelle version et retire
+// l'ancienne, libérée dès qu'aucun envoi n'est en cours.
+#include "preload.h"
+#include <poll.h>
+#include <sched.h>
+#include <sys/inotify.h>
+
+#define PRELOAD_FILE_MAX  ((size_t)PRELOAD_MAX_FRAMES * (MAX_MSG_SIZE - 1))
+
+typedef struct {
+    const char *filename;
+    const char *fallback;
+    PreloadedReply *current;
+} PreloadEntry;
+
+static PreloadEntry entries[PRELOAD_COUNT];
+static pthread_mutex_t preload_mutex = PTHREAD_MUTEX_INITIALIZER;  // Rechargements
+static volatile sig_atomic_t reload_requested = 0;
+static int active_readers = 0;           // Envois en cours (preload_acquire)
+static PreloadedReply *retired = NULL;   // Versions remplacées (preload_mutex)
+static int nb_retired = 0;
+
+static int inotify_fd = -1;
+static pthread_t watch_thread;
+static int watch_started = 0;
+
+static size_t frame_length(const char *text, size_t remaining) {
+    return split_frame(text, remaining, MAX_MSG_SIZE - 1);
+}
+
+static PreloadedReply *build_reply(const char *text, size_t len) {
+    int nb_frames = 0;
+    for (size_t pos = 0; pos < len && nb_frames < PRELOAD_MAX_FRAMES; nb_frames++) {
+        pos += frame_length(text + pos, len - pos);
+    }
+    if (nb_frames == 0) nb_frames = 1;  // Fichier vide : une trame vide
+
+    PreloadedReply *reply = malloc(sizeof(PreloadedReply) + sizeof(Request) * (size_t)nb_frames);
+    if (!reply) {
+        perror("Échec malloc réponse préchargée");
+        return NULL;
+    }
+    reply->retired = NULL;
+    reply->nb_frames = nb_frames;
+
+    size_t pos = 0;
+    for (int f = 0; f < nb_frames; f++) {
+        size_t n = frame_length(text + pos, len - pos);
+        Request *frame = &reply->frames[f];
+        init_request(frame, REQ_MESSAGE, "Server", "", "");
+        memcpy(frame->content, text + pos, n);
+        // Le saut de ligne de coupure est rendu par l'affichage de chaque trame
+        if (n > 0 && frame->content[n - 1] == '\n' && f < nb_frames - 1) n--;
+        frame->content[n] = '\0';
+        pos += frame_length(text + pos, len - pos);
+    }
+    return reply;
+}
+
+// Libère les versions retirées si aucun envoi n'est en cours (preload_mutex tenu).
+// Un lecteur compte avant de charger le pointeur : à zéro, plus aucun ne peut
+// détenir une version déjà retirée. Avec wait, attend ce moment.
+static void free_retired(int wait) {
+    if (!retired) return;
+    while (__atomic_load_n(&active_readers, __ATOMIC_SEQ_CST) != 0) {
+        if (!wait) return;
+        sched_yield();
+    }
+    while (retired) {
+        PreloadedReply *older = retired->retired;
+        free(retired);
+        retired = older;
+    }
+    nb_retired = 0;
+}
+
+// Relit le fichier d'une entrée et publie la nouvelle réponse
+static int reload_entry(PreloadEntry *entry) {
+    char *text = malloc(PRELOAD_FILE_MAX + 1);
+    if (!text) {
+        perror("Échec malloc rechargement");
+        return -1;
+    }
+
+    const char *source = entry->fallback;
+    size_t len = strlen(entry->fallback);
+    FILE *file = fopen(entry->filename, "r");
+    if (file) {
+        len = fread(text, 1, PRELOAD_FILE_MAX, file);
+        text[len] = '\0';
+        fclose(file);
+        source = text;
+    }
+
+    PreloadedReply *reply = build_reply(source, len);
+    free(text);
+    if (!reply) return -1;
+
+    pthread_mutex_lock(&preload_mutex);
+    PreloadedReply *old = entry->current;
+    __atomic_store_n(&entry->current, reply, __ATOMIC_SEQ_CST);
+    if (old) {
+        old->retired = retired;
+        retired = old;
+        // Au-delà de la limite, attendre la fin des envois plutôt que d'accumuler
+        if (++nb_retired > PRELOAD_MAX_RETIRED) free_retired(1);
+    }
+    pthread_mutex_unlock(&preload_mutex);
+
+    printf("Réponse préchargée %s: %d trame(s)%s\n", entry->filename, reply->nb_frames,
+           file ? "" : " (texte par défaut)");
+    return 0;
+}
+
+int preload_register(PreloadId id, const char *filename, const char *fallback) {
+    entries[id].filename = filename;
+    entries[id].fallback = fallback;
+    return reload_entry(&entries[id]);
+}
+
+const PreloadedReply *preload_acquire(PreloadId id) {
+    __atomic_add_fetch(&active_readers, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&entries[id].current, __ATOMIC_SEQ_CST);
+}
+
+void preload_release(void) {
+    __atomic_sub_fetch(&active_readers, 1, __ATOMIC_RELEASE);
+}
+
+void preload_request_reload(void) {
+    reload_requested = 1;
+}
+
+static void reload_file(const char *name) {
+    for (int i = 0; i < PRELOAD_COUNT; i++) {
+        if (entries[i].filename && strcmp(entries[i].filename, name) == 0) {
+            reload_entry(&entries[i]);
+        }
+    }
+}
+
+// Suit les fichiers du dossier courant et les demandes de SIGHUP
+static void *preload_watch_thread(void *arg) {
+    (void)arg;
+    char buffer[4 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (running) {
+        // Sans inotify (fd < 0), poll attend simplement la seconde
+        struct pollfd pfd = { .fd = inotify_fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, 1000);  // Vérifier running et SIGHUP toutes les secondes
+
+        if (reload_requested) {
+            reload_requested = 0;
+            for (int i = 0; i < PRELOAD_COUNT; i++) {
+                if (entries[i].filename) reload_entry(&entries[i]);
+            }
+        }
+
+        // Versions retirées : libérées au premier instant sans envoi en cours
+        pthread_mutex_lock(&preload_mutex);
+        free_retired(0);
+        pthread_mutex_unlock(&preload_mutex);
+        if (ready <= 0) continue;
+
+        ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) continue;
+
+        for (char *p = buffer; p < buffer + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                preload_request_reload();
+                continue;
+            }
+            if (ev->len == 0 || (ev->mask & IN_ISDIR)) continue;
+            reload_file(ev->name);
+        }
+    }
+    return NULL;
+}
+
+int init_preload_watch(void) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0 ||
+        inotify_add_watch(inotify_fd, ".",
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        perror("Erreur inotify (réponses préchargées rechargées sur SIGHUP seulement)");
+        if (inotify_fd >= 0) close(inotify_fd);
+        inotify_fd = -1;
+    }
+
+    if (pthread_create(&watch_thread, NULL, preload_watch_thread, NULL) != 0) {
+        perror("Erreur lors de la création du thread des réponses préchargées");
+        if (inotify_fd >= 0) close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    watch_started = 1;
+    return 0;
+}
+
+void shutdown_preload(void) {
+    if (watch_started) {
+        pthread_join(watch_thread, NULL);
+        watch_started = 0;
+    }
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    pthread_mutex_lock(&preload_mutex);
+    free_retired(1);
+    for (int i = 0; i < PRELOAD_COUNT; i++) {
+        free(entries[i].current);
+        entries[i].current = NULL;
+    }
+    pthread_mutex_unlock(&preload_mutex);
+}
@@ -0,0 +1,41 @@
+// preload.h
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include "common.h"
+
+#define PRELOAD_MAX_FRAMES  16   // Au-delà, le texte est tronqué (environ 16 Ko)
+#define PRELOAD_MAX_RETIRED 4    // Versions remplacées en attente de libération
+
+// Réponses statiques préchargées
+typedef enum {
+    PRELOAD_HELP,
+    PRELOAD_CREDITS,
+    PRELOAD_COUNT
+} PreloadId;
+
+// Réponse prête à l'envoi : le texte découpé en trames REQ_MESSAGE de "Server".
+// Jamais modifiée après publication ; un rechargement en publie une nouvelle.
+typedef struct PreloadedReply {
+    struct PreloadedReply *retired;  // Version remplacée suivante, libérée sans lecteur
+    int nb_frames;
+    Request frames[];
+} PreloadedReply;
+
+// Associe un fichier (relatif au dossier courant) à une réponse et le charge.
+// fallback est envoyé tant que le fichier est illisible.
+int  preload_register(PreloadId id, const char *filename, const char *fallback);
+
+// Version courante de la réponse (jamais NULL après preload_register), sans verrou.
+// Valable jusqu'à preload_release, qui doit suivre chaque appel.
+const PreloadedReply *preload_acquire(PreloadId id);
+void preload_release(void);
+
+// Démarre le suivi des fichiers (inotify) et des demandes de rechargement
+int  init_preload_watch(void);
+void shutdown_preload(void);
+
+// Demande de rechargement de tous les fichiers (gestionnaire de SIGHUP)
+void preload_request_reload(void);
+
+#endif /* PRELOAD_H */
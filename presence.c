@@ -0,0 +1,316 @@
+// presence.c
+// Annonces d'arrivée et de départ regroupées. Les événements s'accumulent
+// pendant PRESENCE_FLUSH_MS, un aller-retour dans l'intervalle s'annule, puis
+// chaque client reçoit un seul message pour tout le lot selon son abonnement
+// (@presence) : une reconnexion massive coûte un envoi par client et non un
+// envoi par client et par événement.
+#include "presence.h"
+#include "timer.h"
+
+typedef struct {
+    NameId id;
+    bool was_online;            // État avant le premier événement du lot
+    bool online;                // État après le dernier
+    bool inactive;
+    int mark;                   // Dernier destinataire l'ayant retenu (union de salons)
+} PresenceEvent;
+
+static pthread_mutex_t presence_mutex = PTHREAD_MUTEX_INITIALIZER;
+static PresenceEvent *pending = NULL;
+static int nb_pending = 0;
+static int pending_capacity = 0;
+static int *pending_by_id = NULL;       // NameId -> indice dans pending, -1 si aucun
+static uint32_t pending_by_id_capacity = 0;
+static Timer flush_timer;
+static int flush_armed = 0;
+
+static void flush_callback(void *arg) {
+    presence_flush(arg);
+}
+
+void init_presence(Server *server) {
+    timer_init(&flush_timer, flush_callback, server);
+}
+
+void shutdown_presence(void) {
+    pthread_mutex_lock(&presence_mutex);
+    free(pending);
+    free(pending_by_id);
+    pending = NULL;
+    pending_by_id = NULL;
+    nb_pending = pending_capacity = 0;
+    pending_by_id_capacity = 0;
+    pthread_mutex_unlock(&presence_mutex);
+}
+
+// Emplacement de l'événement de id, *created si le lot n'en avait pas encore.
+// Appelé avec presence_mutex verrouillé.
+static int reserve_event(NameId id, int *created) {
+    *created = 0;
+    if (id >= pending_by_id_capacity) {
+        uint32_t capacity = pending_by_id_capacity ? pending_by_id_capacity : 64;
+        while (capacity <= id) capacity *= 2;
+        int *map = realloc(pending_by_id, sizeof(int) * capacity);
+        if (!map) {
+            perror("Échec realloc index de présence");
+            return -1;
+        }
+        for (uint32_t i = pending_by_id_capacity; i < capacity; i++) map[i] = -1;
+        pending_by_id = map;
+        pending_by_id_capacity = capacity;
+    }
+    if (pending_by_id[id] >= 0) return pending_by_id[id];
+
+    if (nb_pending == pending_capacity) {
+        int capacity = pending_capacity ? pending_capacity * 2 : 64;
+        PresenceEvent *events = realloc(pending, sizeof(PresenceEvent) * (size_t)capacity);
+        if (!events) {
+            perror("Échec realloc événements de présence");
+            return -1;
+        }
+        pending = events;
+        pending_capacity = capacity;
+    }
+    pending_by_id[id] = nb_pending;
+    *created = 1;
+    return nb_pending++;
+}
+
+void presence_event(Server *server, int client_idx, int online, int inactive) {
+    NameId id = server->client_hot[client_idx].id;
+    if (id == INTERN_NONE) return;
+    metrics_inc(M_PRESENCE_EVENTS);
+
+    pthread_mutex_lock(&presence_mutex);
+    int created;
+    int slot = reserve_event(id, &created);
+    if (slot >= 0) {
+        PresenceEvent *ev = &pending[slot];
+        if (created) {
+            ev->id = id;
+            ev->was_online = !online;
+        }
+        ev->online = online;
+        ev->inactive = inactive;
+        if (!flush_armed) {
+            flush_armed = 1;
+            timer_schedule(&flush_timer, PRESENCE_FLUSH_MS);
+        }
+    }
+    pthread_mutex_unlock(&presence_mutex);
+}
+
+// Une ligne "a, b et N autre(s) ont rejoint le chat" pour les événements de ce sens
+static size_t format_line(char *out, size_t size, PresenceEvent **events, int count, bool online) {
+    int total = 0, named = 0;
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        if (events[i]->online != online) continue;
+        total++;
+        const char *name = intern_str(events[i]->id);
+        if (len + strlen(name) + 16 > PRESENCE_NAMES_BYTES) continue;
+        len += snprintf(out + len, size - len, "%s%s%s", named ? ", " : "", name,
+                        events[i]->inactive ? " (inactif)" : "");
+        named++;
+    }
+    if (total == 0) return 0;
+    if (named < total) {
+        len += snprintf(out + len, size - len, " et %d autre(s)", total - named);
+    }
+    len += snprintf(out + len, size - len, "%s %s le chat", total > 1 ? " ont" : " a",
+                    online ? "rejoint" : "quitté");
+    return len;
+}
+
+// Message du lot restreint à events : arrivées puis départs
+static void format_delta(Request *msg, PresenceEvent **events, int count) {
+    char text[MAX_MSG_SIZE];
+    size_t len = format_line(text, sizeof(text), events, count, true);
+    if (len > 0 && len < sizeof(text) - 1) text[len++] = '\n';
+    size_t leaves = format_line(text + len, sizeof(text) - len, events, count, false);
+    if (leaves == 0 && len > 0) len--;  // Pas de départ : retirer le saut de ligne
+    else len += leaves;
+    text[len] = '\0';
+    init_request(msg, REQ_MESSAGE, "Server", "", text);
+}
+
+static int compare_id(const void *a, const void *b) {
+    NameId x = (*(PresenceEvent * const *)a)->id, y = (*(PresenceEvent * const *)b)->id;
+    return (x > y) - (x < y);
+}
+
+// Événements (triés par pseudonyme) des membres du salon, par fusion des deux
+// listes triées. Retourne le nombre d'événements écrits dans out.
+static int room_events(const Salon *salon, PresenceEvent **by_id, int count, PresenceEvent **out) {
+    int n = 0;
+    for (int m = 0, e = 0; m < salon->nb_membres && e < count; ) {
+        if (salon->membres[m] < by_id[e]->id) m++;
+        else if (salon->membres[m] > by_id[e]->id) e++;
+        else {
+            out[n++] = by_id[e];
+            m++;
+            e++;
+        }
+    }
+    return n;
+}
+
+static PresenceEvent *find_event(PresenceEvent **by_id, int count, NameId id) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (by_id[mid]->id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < count && by_id[lo]->id == id ? by_id[lo] : NULL;
+}
+
+void presence_flush(Server *server) {
+    pthread_mutex_lock(&presence_mutex);
+    PresenceEvent *events = pending;
+    int count = nb_pending;
+    for (int i = 0; i < count; i++) pending_by_id[events[i].id] = -1;
+    pending = NULL;
+    nb_pending = pending_capacity = 0;
+    flush_armed = 0;
+    pthread_mutex_unlock(&presence_mutex);
+    if (count == 0) return;
+
+    // Changements effectifs triés par pseudonyme, puis ceux de chaque salon suivi
+    // par un client concerné, avec le message du salon construit à la demande
+    PresenceEvent **by_id = malloc(sizeof(PresenceEvent *) * (size_t)count * 2);
+    if (!by_id) {
+        perror("Échec allocation annonce de présence");
+        free(events);
+        return;
+    }
+    PresenceEvent **subset = by_id + count;
+    PresenceEvent **grouped = NULL;    // Événements regroupés par salon
+    int *group_first = NULL, *group_count = NULL;
+    Request **room_msgs = NULL;
+    Request all_msg, subset_msg;
+
+    lock_clients(server);
+    int changed = 0;
+    for (int i = 0; i < count; i++) {
+        PresenceEvent *ev = &events[i];
+        if (ev->was_online == ev->online) continue;  // Aller-retour dans l'intervalle
+        ev->mark = -1;
+        by_id[changed++] = ev;
+    }
+    metrics_add(M_PRESENCE_COALESCED, (uint64_t)(count - changed));
+
+    if (changed > 0) {
+        qsort(by_id, (size_t)changed, sizeof(*by_id), compare_id);
+        format_delta(&all_msg, by_id, changed);
+
+        // Les salons restent suivis après une déconnexion : l'appartenance lue
+        // maintenant vaut pour les arrivées comme pour les départs
+        lock_salons(server);
+        int nb_salons = server->nb_salons;
+        size_t grouped_len = 0, grouped_capacity = (size_t)changed;
+        grouped = malloc(sizeof(PresenceEvent *) * grouped_capacity);
+        group_first = malloc(sizeof(int) * (size_t)(nb_salons + 1));
+        group_count = calloc((size_t)nb_salons + 1, sizeof(int));
+        room_msgs = calloc((size_t)nb_salons + 1, sizeof(Request *));
+        if (!grouped || !group_first || !group_count || !room_msgs) {
+            perror("Échec allocation annonce de présence");
+            nb_salons = 0;  // Mode salon sans annonce, les autres modes restent servis
+        }
+        for (int s = 0; s < nb_salons; s++) {
+            if (grouped_capacity - grouped_len < (size_t)changed) {
+                size_t capacity = grouped_capacity * 2;
+                while (capacity - grouped_len < (size_t)changed) capacity *= 2;
+                PresenceEvent **larger = realloc(grouped, sizeof(PresenceEvent *) * capacity);
+                if (!larger) {
+                    perror("Échec realloc annonce de présence");
+                    nb_salons = s;
+                    break;
+                }
+                grouped = larger;
+                grouped_capacity = capacity;
+            }
+            group_first[s] = (int)grouped_len;
+            group_count[s] = room_events(&server->salons[s], by_id, changed, grouped + grouped_len);
+            grouped_len += (size_t)group_count[s];
+        }
+
+        uint64_t notices = 0;
+        time_t now = time(NULL);
+
+        for (int i = 0; i < server->client_count; i++) {
+            if (!is_client_reachable(server, i, now)) continue;
+            ClientInfo *client = &server->clients[i];
+            NameId self = server->client_hot[i].id;
+            Request *out = NULL;
+
+            switch (client->presence_mode) {
+                case PRESENCE_ALL:
+                    // Annonce de sa seule arrivée : inutile pour l'intéressé
+                    if (changed > 1 || by_id[0]->id != self) out = &all_msg;
+                    break;
+                case PRESENCE_ROOM: {
+                    // Union des événements de tous les salons suivis, chacun une fois
+                    int n = 0, rooms = 0, last = -1;
+                    for (int s = 0; s < nb_salons; s++) {
+                        if (group_count[s] == 0 || !room_has_member(&server->salons[s], self)) continue;
+                        rooms++;
+                        last = s;
+                        for (int e = 0; e < group_count[s]; e++) {
+                            PresenceEvent *ev = grouped[group_first[s] + e];
+                            if (ev->mark == i) continue;
+                            ev->mark = i;
+                            subset[n++] = ev;
+                        }
+                    }
+                    if (n == 0 || (n == 1 && subset[0]->id == self)) break;
+                    if (rooms == 1) {
+                        // Un seul salon concerné : message partagé par ses membres
+                        if (!room_msgs[last]) {
+                            room_msgs[last] = malloc(sizeof(Request));
+                            if (!room_msgs[last]) break;
+                            format_delta(room_msgs[last], grouped + group_first[last], group_count[last]);
+                        }
+                        out = room_msgs[last];
+                    } else {
+                        qsort(subset, (size_t)n, sizeof(*subset), compare_id);
+                        format_delta(&subset_msg, subset, n);
+                        out = &subset_msg;
+                    }
+                    break;
+                }
+                case PRESENCE_CONTACTS: {
+                    int n = 0;
+                    for (int c = 0; c < client->nb_contacts; c++) {
+                        PresenceEvent *ev = find_event(by_id, changed, client->contacts[c]);
+                        if (ev) subset[n++] = ev;
+                    }
+                    if (n == 0) break;
+                    format_delta(&subset_msg, subset, n);
+                    out = &subset_msg;
+                    break;
+                }
+                case PRESENCE_NONE:
+                    break;
+            }
+            if (out) {
+                send_broadcast(server, out, &server->client_hot[i].addr);
+                notices++;
+            }
+        }
+        metrics_add(M_PRESENCE_NOTICES, notices);
+
+        if (room_msgs) {
+            for (int s = 0; s < nb_salons; s++) free(room_msgs[s]);
+        }
+        pthread_mutex_unlock(&server->salons_mutex);
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    free(room_msgs);
+    free(group_count);
+    free(group_first);
+    free(grouped);
+    free(by_id);
+    free(events);
+}
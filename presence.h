@@ -0,0 +1,24 @@
+// presence.h
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include "server.h"
+
+#define PRESENCE_FLUSH_MS     1000  // Arrivées et départs regroupés avant d'être annoncés
+#define PRESENCE_NAMES_BYTES  400   // Noms cités par ligne d'annonce, les suivants sont comptés
+
+// Prépare le minuteur d'annonce (le serveur est passé aux rappels)
+void init_presence(Server *server);
+void shutdown_presence(void);
+
+// Enregistre l'arrivée (online = 1) ou le départ d'un client, inactive pour une
+// déconnexion prononcée par le balayage. L'annonce part au plus tard
+// PRESENCE_FLUSH_MS après le premier événement du lot. Appelé avec
+// clients_mutex verrouillé.
+void presence_event(Server *server, int client_idx, int online, int inactive);
+
+// Annonce le lot en attente : au plus un message par client abonné, quel que
+// soit le nombre d'événements. Appelé par le minuteur ; ne pas tenir clients_mutex.
+void presence_flush(Server *server);
+
+#endif /* PRESENCE_H */
@@ -0,0 +1,262 @@
+// ratelimit.c
+// Limitation de débit à l'entrée du serveur : seaux à jetons par adresse source et
+// par utilisateur, un budget par classe de requête. Les tables sont à adressage
+// ouvert et mises à jour sans verrou, le refus d'une requête ne coûte donc ni
+// attente ni contention au thread de réception.
+#include "ratelimit.h"
+#include "metrics.h"
+
+#define RATELIMIT_MASK  (RATELIMIT_TABLE_SIZE - 1)
+
+typedef struct {
+    uint32_t rate;    // Jetons par seconde (0 : illimité)
+    uint32_t burst;   // Capacité du seau
+} RateLimit;
+
+typedef struct {
+    uint64_t key;                      // Empreinte de la clé, 0 : libre
+    uint64_t state[RL_CLASS_COUNT];    // Jetons en millièmes << 32 | dernier remplissage (ms), 0 : plein
+    uint32_t last_seen_ms;
+    uint32_t strikes;                  // Refus dans la fenêtre courante
+    uint32_t strike_start_ms;
+    uint32_t last_notice_ms;
+    int role;                          // UserRole, seaux utilisateur uniquement
+    uint64_t addr;                     // Seaux utilisateur : addr_key de la connexion, 0 : aucune
+} RateBucket;
+
+// Limites par adresse, quel que soit l'utilisateur annoncé : elles bornent aussi
+// un client qui change de pseudonyme à chaque requête
+static const RateLimit addr_limits[RL_CLASS_COUNT] = {
+    [RL_MESSAGE] = {100, 200},
+    [RL_COMMAND] = {40, 80},
+    [RL_HEAVY]   = {5, 20},
+    [RL_CONNECT] = {2, 5}
+};
+
+// Limites par utilisateur selon son rôle
+static const RateLimit role_limits[ROLE_ADMIN + 1][RL_CLASS_COUNT] = {
+    [ROLE_USER] = {
+        [RL_MESSAGE] = {50, 100},
+        [RL_COMMAND] = {20, 40},
+        [RL_HEAVY]   = {2, 10},
+        [RL_CONNECT] = {1, 5}
+    },
+    [ROLE_MODERATOR] = {
+        [RL_MESSAGE] = {100, 200},
+        [RL_COMMAND] = {40, 80},
+        [RL_HEAVY]   = {5, 20},
+        [RL_CONNECT] = {1, 5}
+    },
+    [ROLE_ADMIN] = {
+        [RL_MESSAGE] = {0, 0},
+        [RL_COMMAND] = {0, 0},
+        [RL_HEAVY]   = {0, 0},
+        [RL_CONNECT] = {1, 5}
+    }
+};
+
+// Commandes dont le coût dépend de la taille des tables ou du disque
+static const char *heavy_commands[] = {
+    "help", "credits", "list", "rooms", "files", "search", "download", "metrics", "stats"
+};
+
+static RateBucket addr_table[RATELIMIT_TABLE_SIZE];
+static RateBucket user_table[RATELIMIT_TABLE_SIZE];
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(metrics_now_ns() / 1000000ULL);
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x ? x : 1;
+}
+
+static uint64_t addr_key(const struct sockaddr_in *addr) {
+    return mix64(((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port);
+}
+
+static uint64_t user_key(const char *username) {
+    uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)username; *p; p++) {
+        h = (h ^ *p) * 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+// Commande dont le nom (sans '@') est exactement name
+static int command_is(const char *content, const char *name) {
+    size_t len = strlen(name);
+    return strncmp(content + 1, name, len) == 0 &&
+           (content[len + 1] == '\0' || content[len + 1] == ' ');
+}
+
+// Classe d'une requête, -1 pour celles qui ne sont jamais limitées
+static int classify(const Request *req) {
+    switch (req->type) {
+        case REQ_MESSAGE:
+            return RL_MESSAGE;
+        case REQ_CONNECT:
+            return RL_CONNECT;
+        case REQ_DISCONNECT:
+        case REQ_ACK:
+        case REQ_HEARTBEAT:
+            return -1;
+        case REQ_COMMAND:
+            break;
+        default:
+            return RL_COMMAND;
+    }
+
+    if (req->content[0] != '@') return RL_COMMAND;
+    if (command_is(req->content, "disconnect")) return -1;
+    if (command_is(req->content, "msg")) return RL_MESSAGE;
+    for (size_t i = 0; i < sizeof(heavy_commands) / sizeof(heavy_commands[0]); i++) {
+        if (command_is(req->content, heavy_commands[i])) return RL_HEAVY;
+    }
+    return RL_COMMAND;
+}
+
+// Seau existant associé à key, NULL si absent (aucune place n'est prise)
+static RateBucket *find(RateBucket *table, uint64_t key, uint32_t now) {
+    for (int i = 0; i < RATELIMIT_PROBES; i++) {
+        RateBucket *b = &table[(key + (uint64_t)i) & RATELIMIT_MASK];
+        if (__atomic_load_n(&b->key, __ATOMIC_ACQUIRE) == key) {
+            __atomic_store_n(&b->last_seen_ms, now, __ATOMIC_RELAXED);
+            return b;
+        }
+    }
+    return NULL;
+}
+
+// Seau associé à key. Une clé absente prend une place libre ou, si le voisinage
+// est plein, le seau le moins récemment utilisé (remis à zéro). Une course entre
+// deux réutilisations ne fait que rendre un budget trop tôt.
+static RateBucket *lookup(RateBucket *table, uint64_t key, uint32_t now) {
+    RateBucket *victim = NULL;
+    for (int i = 0; i < RATELIMIT_PROBES; i++) {
+        RateBucket *b = &table[(key + (uint64_t)i) & RATELIMIT_MASK];
+        uint64_t current = __atomic_load_n(&b->key, __ATOMIC_ACQUIRE);
+        if (current == 0 &&
+            __atomic_compare_exchange_n(&b->key, &current, key, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&b->last_seen_ms, now, __ATOMIC_RELAXED);
+            return b;
+        }
+        if (current == key) {
+            __atomic_store_n(&b->last_seen_ms, now, __ATOMIC_RELAXED);
+            return b;
+        }
+        if (!victim || (int32_t)(b->last_seen_ms - victim->last_seen_ms) < 0) victim = b;
+    }
+
+    for (int c = 0; c < RL_CLASS_COUNT; c++) {
+        __atomic_store_n(&victim->state[c], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&victim->strikes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->role, ROLE_USER, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->addr, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->last_seen_ms, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->key, key, __ATOMIC_RELEASE);
+    return victim;
+}
+
+// Retire un jeton du seau s'il en reste. Retourne 1 si la requête est admise.
+static int take(uint64_t *state, const RateLimit *limit, uint32_t now) {
+    if (limit->rate == 0) return 1;
+
+    uint64_t capacity = (uint64_t)limit->burst * 1000;
+    uint64_t old = __atomic_load_n(state, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t tokens = capacity;
+        uint32_t stamp = now;
+        if (old != 0) {
+            uint32_t last = (uint32_t)old;
+            int32_t elapsed = (int32_t)(now - last);
+            if (elapsed < 0) {  // Un autre thread a déjà rempli plus tard
+                elapsed = 0;
+                stamp = last;
+            }
+            // rate jetons par seconde = rate millièmes par milliseconde
+            tokens = (old >> 32) + (uint64_t)elapsed * limit->rate;
+            if (tokens > capacity) tokens = capacity;
+        }
+
+        int admitted = tokens >= 1000;
+        if (admitted) tokens -= 1000;
+        uint64_t next = (tokens << 32) | stamp;
+        if (next == 0) next = 1;
+        if (__atomic_compare_exchange_n(state, &old, next, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return admitted;
+        }
+    }
+}
+
+// Compte un refus et choisit la réaction : mute automatique au-delà de
+// RATELIMIT_STRIKES refus dans la fenêtre, sinon un avertissement par intervalle
+static RateVerdict strike(RateBucket *b, uint32_t now) {
+    uint32_t start = __atomic_load_n(&b->strike_start_ms, __ATOMIC_RELAXED);
+    if (now - start >= RATELIMIT_STRIKE_WINDOW_MS) {
+        __atomic_store_n(&b->strike_start_ms, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->strikes, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&b->strikes, 1, __ATOMIC_RELAXED) == RATELIMIT_STRIKES) {
+        return RL_MUTE;
+    }
+
+    uint32_t last = __atomic_load_n(&b->last_notice_ms, __ATOMIC_RELAXED);
+    if (now - last >= RATELIMIT_NOTICE_MS &&
+        __atomic_compare_exchange_n(&b->last_notice_ms, &last, now, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return RL_WARN;
+    }
+    return RL_DROP;
+}
+
+RateVerdict ratelimit_check(const Request *req, const struct sockaddr_in *addr) {
+    int cls = classify(req);
+    if (cls < 0) return RL_ALLOW;
+
+    uint32_t now = now_ms();
+    uint64_t akey = addr_key(addr);
+    RateBucket *ab = lookup(addr_table, akey, now);
+    RateBucket *ub = NULL;
+    int admitted = take(&ab->state[cls], &addr_limits[cls], now);
+
+    // Le budget d'un utilisateur n'est consommé que par son adresse de connexion :
+    // un pseudonyme usurpé ne vide pas le budget de sa victime. Les autres
+    // requêtes ne sont limitées que par leur adresse source.
+    if (req->sender[0] != '\0') {
+        ub = find(user_table, user_key(req->sender), now);
+        if (ub && __atomic_load_n(&ub->addr, __ATOMIC_RELAXED) != akey) ub = NULL;
+    }
+    if (ub && admitted) {
+        // Le budget de l'utilisateur n'est consommé que si l'adresse est admise
+        int role = __atomic_load_n(&ub->role, __ATOMIC_RELAXED);
+        admitted = take(&ub->state[cls], &role_limits[role][cls], now);
+    }
+    if (admitted) return RL_ALLOW;
+
+    metrics_inc((MetricCounter)(M_RATELIMIT_MESSAGE + cls));
+    return strike(ub ? ub : ab, now);
+}
+
+void ratelimit_set_role(const char *username, UserRole role) {
+    RateBucket *b = lookup(user_table, user_key(username), now_ms());
+    __atomic_store_n(&b->role, (int)role, __ATOMIC_RELAXED);
+}
+
+void ratelimit_bind(const char *username, const struct sockaddr_in *addr) {
+    if (addr) {
+        RateBucket *b = lookup(user_table, user_key(username), now_ms());
+        __atomic_store_n(&b->addr, addr_key(addr), __ATOMIC_RELAXED);
+    } else {
+        RateBucket *b = find(user_table, user_key(username), now_ms());
+        if (b) __atomic_store_n(&b->addr, 0, __ATOMIC_RELAXED);
+    }
+}
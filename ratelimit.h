@@ -0,0 +1,45 @@
+// ratelimit.h
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+#include "common.h"
+#include "server.h"
+
+#define RATELIMIT_TABLE_SIZE      4096   // Seaux par table (puissance de 2)
+#define RATELIMIT_PROBES          8      // Sondage avant réutilisation du seau le plus ancien
+#define RATELIMIT_NOTICE_MS       1000   // Au plus un avertissement par seau sur cet intervalle
+#define RATELIMIT_STRIKES         50     // Refus tolérés dans la fenêtre avant mute automatique
+#define RATELIMIT_STRIKE_WINDOW_MS 10000
+#define RATELIMIT_MUTE_MINUTES    5
+
+// Classes de requêtes, chacune avec son propre budget. L'ordre est celui des
+// compteurs M_RATELIMIT_* de metrics.h.
+typedef enum {
+    RL_MESSAGE,    // Messages de salon et privés
+    RL_COMMAND,    // Commandes courantes
+    RL_HEAVY,      // Commandes coûteuses : listes, recherche, fichiers, métriques
+    RL_CONNECT,    // Tentatives de connexion
+    RL_CLASS_COUNT
+} RateClass;
+
+typedef enum {
+    RL_ALLOW,
+    RL_DROP,       // Refus silencieux
+    RL_WARN,       // Refus, prévenir l'expéditeur
+    RL_MUTE        // Refus répétés : rendre l'expéditeur muet
+} RateVerdict;
+
+// Décide si une requête reçue peut être traitée. Ne prend aucun verrou : les seaux
+// par adresse et par utilisateur sont mis à jour par opérations atomiques. Le seau
+// d'un utilisateur n'est utilisé que pour les requêtes venant de son adresse de
+// connexion (voir ratelimit_bind).
+RateVerdict ratelimit_check(const Request *req, const struct sockaddr_in *addr);
+
+// Rôle utilisé pour choisir les limites d'un utilisateur (ROLE_USER par défaut)
+void ratelimit_set_role(const char *username, UserRole role);
+
+// Adresse depuis laquelle un utilisateur est connecté, NULL à la déconnexion
+void ratelimit_bind(const char *username, const struct sockaddr_in *addr);
+
+#endif /* RATELIMIT_H */
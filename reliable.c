@@ -0,0 +1,387 @@
+// reliable.c
+// Couche de fiabilité optionnelle serveur -> client : numéros de séquence par
+// session, acquittements cumulatifs et sélectifs, retransmission pilotée par la
+// roue de temporisation du serveur. Le réordonnancement est fait par le client.
+#include "reliable.h"
+#include "egress.h"
+#include "metrics.h"
+#include "timer.h"
+#include <time.h>
+
+#define RELIABLE_WINDOW_MASK  (RELIABLE_WINDOW - 1)
+
+typedef enum {
+    PKT_FREE,
+    PKT_INFLIGHT,     // Envoyé, en attente d'acquittement
+    PKT_SETTLED       // Acquitté ou abandonné
+} PacketState;
+
+typedef struct {
+    Request req;              // Copie envoyée (champs de fiabilité renseignés)
+    uint64_t sent_ns;         // Dernier envoi
+    uint64_t deadline_ns;     // Prochaine retransmission
+    int retries;
+    PacketState state;
+    int session;              // Indice de la session propriétaire
+    Timer timer;              // Échéance de retransmission
+} ReliablePacket;
+
+typedef struct {
+    int used;
+    uint32_t id;              // Identifiant de session transmis au client (champ sack)
+    struct sockaddr_in addr;
+    int hash_next;            // Chaînage dans l'index (indice + 1, 0 : fin)
+    uint32_t next_seq;        // Prochain numéro attribué
+    uint32_t base;            // Plus petit numéro non réglé
+    ReliablePacket *window;   // Indice : seq % RELIABLE_WINDOW, conservée d'une session à l'autre
+    uint64_t srtt_ns;
+    uint64_t rttvar_ns;
+    uint64_t rto_ns;
+    uint64_t last_ack_ns;
+    int lost;                 // Un datagramme a été abandonné depuis le dernier acquittement
+    int dropped;              // Diffusions refusées faute de crédit, pas encore signalées
+} ReliableSession;
+
+static pthread_mutex_t reliable_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ReliableSession sessions[RELIABLE_MAX_SESSIONS];
+static int hash_heads[RELIABLE_HASH_SIZE];   // Indice + 1, 0 : vide
+static int nb_sessions = 0;
+static uint32_t id_counter = 0;
+
+static Timer session_timer;    // Expiration des sessions muettes
+
+static void packet_expired(void *arg);
+
+static unsigned int addr_hash(const struct sockaddr_in *addr) {
+    uint32_t h = addr->sin_addr.s_addr ^ ((uint32_t)addr->sin_port * 2654435761u);
+    return (h ^ (h >> 16)) & (RELIABLE_HASH_SIZE - 1);
+}
+
+static int same_addr(const struct sockaddr_in *a, const struct sockaddr_in *b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+// Appelé avec reliable_mutex verrouillé
+static ReliableSession *find_session(const struct sockaddr_in *addr) {
+    for (int i = hash_heads[addr_hash(addr)]; i != 0; i = sessions[i - 1].hash_next) {
+        if (same_addr(&sessions[i - 1].addr, addr)) return &sessions[i - 1];
+    }
+    return NULL;
+}
+
+static void arm(ReliablePacket *p, uint64_t delay_ns) {
+    timer_schedule(&p->timer, (delay_ns + 999999) / 1000000);
+}
+
+// Libère les emplacements réglés en tête de fenêtre
+static void advance_base(ReliableSession *s) {
+    while (s->base != s->next_seq && s->window[s->base & RELIABLE_WINDOW_MASK].state != PKT_INFLIGHT) {
+        s->window[s->base & RELIABLE_WINDOW_MASK].state = PKT_FREE;
+        s->base++;
+    }
+}
+
+static void abandon(ReliableSession *s, ReliablePacket *p) {
+    timer_cancel(&p->timer);
+    p->state = PKT_SETTLED;
+    s->lost = 1;
+    metrics_inc(M_RELIABLE_ABANDONED);
+}
+
+// Estimation du délai de retransmission (RFC 6298), hors datagrammes retransmis
+static void rtt_sample(ReliableSession *s, uint64_t sample_ns) {
+    if (s->srtt_ns == 0) {
+        s->srtt_ns = sample_ns;
+        s->rttvar_ns = sample_ns / 2;
+    } else {
+        uint64_t delta = s->srtt_ns > sample_ns ? s->srtt_ns - sample_ns : sample_ns - s->srtt_ns;
+        s->rttvar_ns = (3 * s->rttvar_ns + delta) / 4;
+        s->srtt_ns = (7 * s->srtt_ns + sample_ns) / 8;
+    }
+    s->rto_ns = s->srtt_ns + 4 * s->rttvar_ns;
+    if (s->rto_ns < RELIABLE_RTO_MIN_MS * 1000000ULL) s->rto_ns = RELIABLE_RTO_MIN_MS * 1000000ULL;
+    if (s->rto_ns > RELIABLE_RTO_MAX_MS * 1000000ULL) s->rto_ns = RELIABLE_RTO_MAX_MS * 1000000ULL;
+    metrics_record(H_RELIABLE_RTT, sample_ns);
+}
+
+static void settle(ReliableSession *s, uint32_t seq, uint64_t now_ns) {
+    ReliablePacket *p = &s->window[seq & RELIABLE_WINDOW_MASK];
+    if (p->state != PKT_INFLIGHT || p->req.seq != seq) return;
+    if (p->retries == 0) rtt_sample(s, now_ns - p->sent_ns);
+    timer_cancel(&p->timer);
+    p->state = PKT_SETTLED;
+}
+
+// Appelé avec reliable_mutex verrouillé
+static void close_session(ReliableSession *s) {
+    int idx = (int)(s - sessions) + 1;
+    int *link = &hash_heads[addr_hash(&s->addr)];
+    while (*link != 0 && *link != idx) link = &sessions[*link - 1].hash_next;
+    if (*link == idx) *link = s->hash_next;
+
+    // La fenêtre reste allouée : un rappel de retransmission déjà parti la lit encore
+    for (int i = 0; i < RELIABLE_WINDOW; i++) {
+        timer_cancel(&s->window[i].timer);
+        s->window[i].state = PKT_FREE;
+    }
+    s->used = 0;
+    __atomic_store_n(&nb_sessions, nb_sessions - 1, __ATOMIC_RELAXED);
+}
+
+int reliable_open(const struct sockaddr_in *addr) {
+    pthread_mutex_lock(&reliable_mutex);
+    ReliableSession *s = find_session(addr);
+    if (!s) {
+        for (int i = 0; i < RELIABLE_MAX_SESSIONS; i++) {
+            if (!sessions[i].used) {
+                s = &sessions[i];
+                break;
+            }
+        }
+        if (!s) {
+            pthread_mutex_unlock(&reliable_mutex);
+            return -1;
+        }
+        if (!s->window) {
+            s->window = calloc(RELIABLE_WINDOW, sizeof(ReliablePacket));
+            if (!s->window) {
+                perror("Erreur d'allocation de la fenêtre de retransmission");
+                pthread_mutex_unlock(&reliable_mutex);
+                return -1;
+            }
+            for (int i = 0; i < RELIABLE_WINDOW; i++) {
+                s->window[i].session = (int)(s - sessions);
+                timer_init(&s->window[i].timer, packet_expired, &s->window[i]);
+            }
+        }
+        s->used = 1;
+        s->addr = *addr;
+        unsigned int h = addr_hash(addr);
+        s->hash_next = hash_heads[h];
+        hash_heads[h] = (int)(s - sessions) + 1;
+        __atomic_store_n(&nb_sessions, nb_sessions + 1, __ATOMIC_RELAXED);
+    } else {
+        // Reconnexion depuis la même adresse : la session repart de zéro
+        for (int i = 0; i < RELIABLE_WINDOW; i++) {
+            timer_cancel(&s->window[i].timer);
+            s->window[i].state = PKT_FREE;
+        }
+    }
+
+    do {
+        s->id = (uint32_t)time(NULL) ^ (++id_counter * 2654435761u);
+    } while (s->id == 0);
+    s->next_seq = 1;
+    s->base = 1;
+    s->srtt_ns = 0;
+    s->rttvar_ns = 0;
+    s->rto_ns = RELIABLE_RTO_INITIAL_MS * 1000000ULL;
+    s->last_ack_ns = metrics_now_ns();
+    s->lost = 0;
+    s->dropped = 0;
+    pthread_mutex_unlock(&reliable_mutex);
+    return 0;
+}
+
+void reliable_close(const struct sockaddr_in *addr) {
+    pthread_mutex_lock(&reliable_mutex);
+    ReliableSession *s = find_session(addr);
+    if (s) close_session(s);
+    pthread_mutex_unlock(&reliable_mutex);
+}
+
+int reliable_prepare(Request *res, const struct sockaddr_in *addr, int bulk) {
+    res->seq = 0;
+    res->ack = 0;
+    res->sack = 0;
+    res->flags = 0;
+    if (__atomic_load_n(&nb_sessions, __ATOMIC_RELAXED) == 0) return 0;
+
+    pthread_mutex_lock(&reliable_mutex);
+    ReliableSession *s = find_session(addr);
+    if (!s) {
+        pthread_mutex_unlock(&reliable_mutex);
+        return 0;
+    }
+
+    // Crédits : un client qui n'acquitte plus assez vite ne reçoit plus les
+    // diffusions, ce qui borne ses retransmissions et la mémoire qu'il occupe
+    if (bulk && s->next_seq - s->base >= RELIABLE_CREDITS) {
+        s->dropped++;
+        pthread_mutex_unlock(&reliable_mutex);
+        metrics_inc(M_FLOW_DROPPED_CREDITS);
+        return -2;
+    }
+
+    // Fenêtre pleine : le plus ancien datagramme non acquitté est abandonné
+    if (s->next_seq - s->base >= RELIABLE_WINDOW) {
+        abandon(s, &s->window[s->base & RELIABLE_WINDOW_MASK]);
+        advance_base(s);
+    }
+
+    uint64_t now = metrics_now_ns();
+    uint32_t seq = s->next_seq++;
+    res->seq = seq;
+    res->ack = s->base - 1;
+    res->sack = s->id;
+    res->flags = REQ_FLAG_RELIABLE | (seq == 1 ? REQ_FLAG_RESYNC : 0);
+
+    ReliablePacket *p = &s->window[seq & RELIABLE_WINDOW_MASK];
+    memcpy(&p->req, res, sizeof(Request));
+    p->sent_ns = now;
+    p->deadline_ns = now + s->rto_ns;
+    p->retries = 0;
+    p->state = PKT_INFLIGHT;
+    arm(p, s->rto_ns);
+    pthread_mutex_unlock(&reliable_mutex);
+
+    metrics_inc(M_RELIABLE_SENT);
+    return 0;
+}
+
+void reliable_on_ack(const struct sockaddr_in *addr, uint32_t ack, uint32_t sack) {
+    if (__atomic_load_n(&nb_sessions, __ATOMIC_RELAXED) == 0) return;
+
+    Request retransmit;
+    int fast_retransmit = 0;
+    int dropped = 0;
+
+    pthread_mutex_lock(&reliable_mutex);
+    ReliableSession *s = find_session(addr);
+    if (!s || ack >= s->next_seq) {  // Session inconnue ou acquittement incohérent
+        pthread_mutex_unlock(&reliable_mutex);
+        return;
+    }
+
+    uint64_t now = metrics_now_ns();
+    s->last_ack_ns = now;
+    s->lost = 0;
+    metrics_inc(M_RELIABLE_ACKS);
+
+    for (uint32_t seq = s->base; seq <= ack; seq++) {
+        settle(s, seq, now);
+    }
+    for (int i = 0; i < RELIABLE_SACK_BITS; i++) {
+        if (!(sack & (1u << i))) continue;
+        uint32_t seq = ack + 2 + (uint32_t)i;
+        if (seq - s->base < s->next_seq - s->base) settle(s, seq, now);
+    }
+    advance_base(s);
+
+    // Trou signalé par l'acquittement sélectif : retransmettre sans attendre l'échéance,
+    // au plus une fois par aller-retour
+    uint32_t missing = ack + 1;
+    if (sack != 0 && missing - s->base < s->next_seq - s->base) {
+        ReliablePacket *p = &s->window[missing & RELIABLE_WINDOW_MASK];
+        uint64_t guard = s->srtt_ns ? s->srtt_ns : s->rto_ns;
+        if (p->state == PKT_INFLIGHT && now - p->sent_ns >= guard) {
+            p->retries++;
+            p->sent_ns = now;
+            p->deadline_ns = now + s->rto_ns;
+            p->req.ack = s->base - 1;
+            arm(p, s->rto_ns);
+            memcpy(&retransmit, &p->req, sizeof(Request));
+            fast_retransmit = 1;
+        }
+    }
+
+    // Crédits revenus à la moitié : signaler en un seul avis les diffusions perdues
+    if (s->dropped > 0 && s->next_seq - s->base <= RELIABLE_CREDITS / 2) {
+        dropped = s->dropped;
+        s->dropped = 0;
+    }
+    pthread_mutex_unlock(&reliable_mutex);
+
+    if (fast_retransmit) {
+        metrics_inc(M_RELIABLE_RETRANSMITS);
+        egress_send(&retransmit, addr);
+    }
+    if (dropped > 0) {
+        Request notice;
+        char content[128];
+        snprintf(content, sizeof(content),
+                 "%d message(s) non délivré(s) : réception trop lente", dropped);
+        init_request(&notice, REQ_MESSAGE, "Server", "", content);
+        reliable_prepare(&notice, addr, 0);
+        egress_send(&notice, addr);
+        metrics_inc(M_FLOW_NOTICES);
+    }
+}
+
+// Échéance de retransmission d'un datagramme, sur le thread des minuteurs
+static void packet_expired(void *arg) {
+    ReliablePacket *p = arg;
+    Request retransmit;
+    struct sockaddr_in addr;
+    int resend = 0;
+
+    pthread_mutex_lock(&reliable_mutex);
+    ReliableSession *s = &sessions[p->session];
+    uint64_t now = metrics_now_ns();
+
+    // Réglé entre-temps, ou réarmé plus tard par une retransmission rapide
+    if (!s->used || p->state != PKT_INFLIGHT || p->deadline_ns > now) {
+        pthread_mutex_unlock(&reliable_mutex);
+        return;
+    }
+
+    if (p->retries >= RELIABLE_MAX_RETRIES) {
+        abandon(s, p);
+        advance_base(s);
+    } else {
+        // Attente doublée à chaque tentative
+        uint64_t backoff = s->rto_ns << (p->retries + 1);
+        if (backoff > RELIABLE_RTO_MAX_MS * 1000000ULL) backoff = RELIABLE_RTO_MAX_MS * 1000000ULL;
+        p->retries++;
+        p->sent_ns = now;
+        p->deadline_ns = now + backoff;
+        p->req.ack = s->base - 1;
+        arm(p, backoff);
+        memcpy(&retransmit, &p->req, sizeof(Request));
+        addr = s->addr;
+        resend = 1;
+    }
+    pthread_mutex_unlock(&reliable_mutex);
+
+    // Envoi hors verrou
+    if (resend) {
+        metrics_inc(M_RELIABLE_RETRANSMITS);
+        egress_send(&retransmit, &addr);
+    }
+}
+
+// Ferme les sessions dont le client ne répond plus
+static void expire_sessions(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&reliable_mutex);
+    uint64_t now = metrics_now_ns();
+    for (int i = 0; i < RELIABLE_MAX_SESSIONS; i++) {
+        ReliableSession *s = &sessions[i];
+        if (!s->used) continue;
+        if ((s->base != s->next_seq || s->lost) &&
+            now - s->last_ack_ns > (uint64_t)RELIABLE_SESSION_TIMEOUT * 1000000000ULL) {
+            printf("Session fiable expirée: %s:%d\n", inet_ntoa(s->addr.sin_addr), ntohs(s->addr.sin_port));
+            close_session(s);
+        }
+    }
+    pthread_mutex_unlock(&reliable_mutex);
+    timer_schedule(&session_timer, 1000);
+}
+
+int init_reliable(void) {
+    timer_init(&session_timer, expire_sessions, NULL);
+    timer_schedule(&session_timer, 1000);
+    return 0;
+}
+
+void shutdown_reliable(void) {
+    timer_cancel_sync(&session_timer);
+
+    pthread_mutex_lock(&reliable_mutex);
+    for (int i = 0; i < RELIABLE_MAX_SESSIONS; i++) {
+        if (sessions[i].used) close_session(&sessions[i]);
+        free(sessions[i].window);
+        sessions[i].window = NULL;
+    }
+    pthread_mutex_unlock(&reliable_mutex);
+}
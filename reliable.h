@@ -0,0 +1,38 @@
+// reliable.h
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stdint.h>
+#include "common.h"
+#include "server.h"
+
+#define RELIABLE_MAX_SESSIONS    MAX_CLIENTS
+#define RELIABLE_WINDOW          256    // Datagrammes non acquittés par session (puissance de 2)
+#define RELIABLE_HASH_SIZE       1024   // Index des sessions par adresse (puissance de 2)
+#define RELIABLE_RTO_INITIAL_MS  300
+#define RELIABLE_RTO_MIN_MS      100
+#define RELIABLE_RTO_MAX_MS      2000
+#define RELIABLE_MAX_RETRIES     8      // Au-delà, le datagramme est abandonné
+#define RELIABLE_SESSION_TIMEOUT 30     // Session fermée sans acquittement pendant ce délai (s)
+#define RELIABLE_CREDITS         128    // Diffusions non acquittées admises par session
+
+// Arme l'expiration des sessions ; les retransmissions passent par les minuteurs
+// du serveur (timer.h). shutdown_reliable est appelé après shutdown_timers.
+int  init_reliable(void);
+void shutdown_reliable(void);
+
+// Ouvre (ou réinitialise) la session fiable d'une adresse. Retourne -1 si la table
+// est pleine : les réponses partent alors sans garantie.
+int  reliable_open(const struct sockaddr_in *addr);
+void reliable_close(const struct sockaddr_in *addr);
+
+// Traite l'acquittement cumulatif et sélectif porté par une requête du client
+void reliable_on_ack(const struct sockaddr_in *addr, uint32_t ack, uint32_t sack);
+
+// Renseigne les champs de fiabilité de res avant envoi : numéro de séquence et
+// copie pour retransmission si la destination a une session fiable, 0 sinon.
+// Une diffusion (bulk) vers une session sans crédit est refusée (-2) : le client
+// reçoit plus tard un seul avis résumant les messages perdus.
+int  reliable_prepare(Request *res, const struct sockaddr_in *addr, int bulk);
+
+#endif /* RELIABLE_H */
@@ -0,0 +1,149 @@
+// reply.c
+// Réponses texte de longueur quelconque (@list, @rooms, @files). Les ajouts
+// sont en temps linéaire : le tampon double quand il est plein, au lieu de
+// strcat répétés sur un message de taille fixe.
+#include "reply.h"
+#include "metrics.h"
+#include <stdarg.h>
+
+void reply_init(ReplyBuilder *rb) {
+    rb->data = rb->inline_data;
+    rb->len = 0;
+    rb->capacity = sizeof(rb->inline_data);
+    rb->failed = 0;
+    rb->data[0] = '\0';
+}
+
+// Garantit la place pour extra octets plus le terminateur
+static int reply_reserve(ReplyBuilder *rb, size_t extra) {
+    if (rb->failed) return -1;
+    if (rb->len + extra < rb->capacity) return 0;
+
+    size_t capacity = rb->capacity * 2;
+    while (rb->len + extra >= capacity) capacity *= 2;
+
+    char *data;
+    if (rb->data == rb->inline_data) {
+        data = malloc(capacity);
+        if (data) memcpy(data, rb->inline_data, rb->len + 1);
+    } else {
+        data = realloc(rb->data, capacity);
+    }
+    if (!data) {
+        perror("Échec allocation réponse");
+        rb->failed = 1;
+        return -1;
+    }
+    rb->data = data;
+    rb->capacity = capacity;
+    return 0;
+}
+
+void reply_append(ReplyBuilder *rb, const char *text, size_t len) {
+    if (reply_reserve(rb, len) < 0) return;
+    memcpy(rb->data + rb->len, text, len);
+    rb->len += len;
+    rb->data[rb->len] = '\0';
+}
+
+void reply_printf(ReplyBuilder *rb, const char *format, ...) {
+    if (rb->failed) return;
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(rb->data + rb->len, rb->capacity - rb->len, format, args);
+    va_end(args);
+    if (n < 0) return;
+
+    if ((size_t)n >= rb->capacity - rb->len) {
+        // Trop long pour la place restante : agrandir puis reformater
+        rb->data[rb->len] = '\0';
+        if (reply_reserve(rb, (size_t)n) < 0) return;
+        va_start(args, format);
+        vsnprintf(rb->data + rb->len, rb->capacity - rb->len, format, args);
+        va_end(args);
+    }
+    rb->len += (size_t)n;
+}
+
+// Découpe et envoie text (terminé par '\0'), retourne le nombre de trames
+static int send_text(Server *server, const char *text, size_t len, struct sockaddr_in *client_addr) {
+    int nb_frames = 0;
+    for (size_t pos = 0; pos < len; nb_frames++) {
+        pos += split_frame(text + pos, len - pos, REPLY_FRAME_TEXT);
+    }
+
+    Request frame;
+    if (nb_frames <= 1) {
+        init_request(&frame, REQ_MESSAGE, "Server", "", text);
+        send_response(server, &frame, client_addr);
+        return 1;
+    }
+
+    // Trames envoyées à la suite : la file de sortie du client les regroupe
+    size_t pos = 0;
+    for (int f = 0; f < nb_frames; f++) {
+        size_t n = split_frame(text + pos, len - pos, REPLY_FRAME_TEXT);
+        init_request(&frame, REQ_MESSAGE, "Server", "", "");
+        int header = snprintf(frame.content, REPLY_HEADER_MAX, "[%d/%d] ", f + 1, nb_frames);
+        size_t text_len = n;
+        // Le saut de ligne de coupure est rendu par l'affichage de chaque trame
+        if (text_len > 0 && text[pos + text_len - 1] == '\n') text_len--;
+        memcpy(frame.content + header, text + pos, text_len);
+        frame.content[header + (int)text_len] = '\0';
+        send_response(server, &frame, client_addr);
+        pos += n;
+    }
+    return nb_frames;
+}
+
+int reply_send(Server *server, ReplyBuilder *rb, struct sockaddr_in *client_addr) {
+    int nb_frames = send_text(server, rb->data, rb->len, client_addr);
+    reply_free(rb);
+    return nb_frames;
+}
+
+int reply_send_cached(Server *server, ListingCache *caches, const unsigned long *version,
+                      int cursor, ReplyRender render, struct sockaddr_in *client_addr) {
+    ListingCache *cache = &caches[(unsigned)cursor % LISTING_CACHE_SLOTS];
+
+    pthread_mutex_lock(&cache->mutex);
+    if (cache->text && cache->cursor == cursor &&
+        cache->version == __atomic_load_n(version, __ATOMIC_ACQUIRE)) {
+        metrics_inc(M_LISTING_HITS);
+        int nb_frames = send_text(server, cache->text, cache->len, client_addr);
+        pthread_mutex_unlock(&cache->mutex);
+        return nb_frames;
+    }
+
+    ReplyBuilder rb;
+    reply_init(&rb);
+    unsigned long rendered = render(server, cursor, &rb);
+    metrics_inc(M_LISTING_RENDERS);
+
+    // Garder le texte : le tampon alloué est repris tel quel, le tampon initial copié
+    char *text = rb.data;
+    if (!rb.failed && text == rb.inline_data) {
+        text = malloc(rb.len + 1);
+        if (text) memcpy(text, rb.data, rb.len + 1);
+    }
+    if (rb.failed || !text) {
+        // Page incomplète ou mémoire insuffisante : envoyée sans être gardée
+        pthread_mutex_unlock(&cache->mutex);
+        return reply_send(server, &rb, client_addr);
+    }
+
+    free(cache->text);
+    cache->text = text;
+    cache->len = rb.len;
+    cache->cursor = cursor;
+    cache->version = rendered;
+    int nb_frames = send_text(server, cache->text, cache->len, client_addr);
+    pthread_mutex_unlock(&cache->mutex);
+    return nb_frames;
+}
+
+void reply_free(ReplyBuilder *rb) {
+    if (rb->data != rb->inline_data) free(rb->data);
+    reply_init(rb);
+}
@@ -0,0 +1,46 @@
+// reply.h
+#ifndef REPLY_H
+#define REPLY_H
+
+#include "common.h"
+#include "server.h"
+
+#define REPLY_HEADER_MAX   16   // Place réservée à l'en-tête "[i/n] " de chaque trame
+#define REPLY_FRAME_TEXT   (MAX_MSG_SIZE - 1 - REPLY_HEADER_MAX)
+#define REPLY_PAGE_BYTES   (8 * REPLY_FRAME_TEXT)  // Au-delà, une liste s'arrête sur un curseur
+
+// Réponse construite par ajouts successifs dans un tampon extensible (le texte
+// reste terminé par '\0'), puis découpée en trames numérotées à l'envoi
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int failed;                        // Allocation impossible : les ajouts suivants sont ignorés
+    char inline_data[MAX_MSG_SIZE];    // Tampon initial, sans allocation pour une seule trame
+} ReplyBuilder;
+
+void reply_init(ReplyBuilder *rb);
+void reply_append(ReplyBuilder *rb, const char *text, size_t len);
+void reply_printf(ReplyBuilder *rb, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Vrai quand une liste a rempli sa page et doit proposer un curseur pour la suite
+static inline int reply_page_full(const ReplyBuilder *rb) {
+    return rb->len >= REPLY_PAGE_BYTES;
+}
+
+// Envoie le texte en une ou plusieurs trames REQ_MESSAGE de "Server", coupées
+// aux fins de ligne et préfixées de "[i/n] " s'il y en a plusieurs. Libère le
+// tampon ; retourne le nombre de trames envoyées.
+int  reply_send(Server *server, ReplyBuilder *rb, struct sockaddr_in *client_addr);
+void reply_free(ReplyBuilder *rb);
+
+// Rend la page d'une liste à partir de cursor, sous le verrou de sa table, et
+// retourne la version de la table lue sous ce même verrou
+typedef unsigned long (*ReplyRender)(Server *server, int cursor, ReplyBuilder *rb);
+
+// Envoie la page en cache de caches (LISTING_CACHE_SLOTS emplacements) si elle a
+// été rendue à la version *version, sinon la rend avec render puis la garde
+int  reply_send_cached(Server *server, ListingCache *caches, const unsigned long *version,
+                       int cursor, ReplyRender render, struct sockaddr_in *client_addr);
+
+#endif /* REPLY_H */
@@ -0,0 +1,616 @@
+// search.c
+#include "search.h"
+#include <ctype.h>
+
+// Entrée de saut : permet de reprendre le décodage au début d'un bloc
+typedef struct {
+    uint32_t base_id;  // Dernier identifiant avant le bloc
+    uint32_t offset;   // Position du bloc dans les données compressées
+} SkipEntry;
+
+// Liste de postings d'un couple (salon, terme).
+// Les identifiants de messages sont croissants et stockés en deltas varint.
+typedef struct {
+    char *key;             // "salon\x1fterme", NULL si l'emplacement est libre
+    uint32_t hash;
+    uint8_t *data;
+    uint32_t len;
+    uint32_t cap;
+    uint32_t count;        // Nombre d'identifiants
+    uint32_t last_id;      // Dernier identifiant ajouté
+    SkipEntry *skips;
+    uint32_t nb_skips;
+    uint32_t skips_cap;
+} PostingList;
+
+// Curseur de lecture sur une liste de postings
+typedef struct {
+    const PostingList *pl;
+    uint32_t pos;      // Position dans data
+    uint32_t idx;      // Nombre d'identifiants déjà décodés
+    uint32_t cur;      // Identifiant courant
+} PostingCursor;
+
+// Message en attente d'écriture dans le journal et d'indexation
+typedef struct {
+    time_t timestamp;
+    char room[50];
+    char sender[50];
+    char content[MAX_MSG_SIZE];
+} PendingMessage;
+
+#define SEARCH_BATCH_SIZE 64
+
+static struct {
+    // Index inversé (protégé par index_lock)
+    pthread_rwlock_t index_lock;
+    PostingList *table;
+    uint32_t table_capacity;   // Puissance de 2
+    uint32_t table_count;
+    uint64_t *msg_offsets;     // Position de chaque message dans le journal (id - 1)
+    uint32_t nb_messages;
+    uint32_t msg_capacity;
+
+    // Journal de l'historique
+    int log_fd;
+    off_t log_size;
+
+    // File d'attente d'indexation (protégée par queue_mutex)
+    pthread_mutex_t queue_mutex;
+    pthread_cond_t queue_cond;
+    PendingMessage *queue;
+    int queue_head;
+    int queue_count;
+    unsigned long dropped;
+    int stop;
+
+    pthread_t thread;
+    int started;
+} idx = { .log_fd = -1 };
+
+static uint32_t hash_key(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Extrait le prochain terme du texte (minuscules ASCII, UTF-8 conservé).
+// Retourne la longueur du terme, 0 quand le texte est épuisé.
+static int next_term(const char **text, char *term) {
+    const unsigned char *p = (const unsigned char *)*text;
+
+    for (;;) {
+        // Ignorer les séparateurs
+        while (*p && !(isalnum(*p) || *p >= 0x80)) p++;
+        if (!*p) {
+            *text = (const char *)p;
+            return 0;
+        }
+
+        int len = 0;
+        while (*p && (isalnum(*p) || *p >= 0x80)) {
+            if (len < SEARCH_TERM_MAX - 1) {
+                term[len++] = (char)tolower(*p);
+            }
+            p++;
+        }
+        term[len] = '\0';
+
+        // Les termes d'un seul caractère ne sont pas indexés
+        if (len >= 2) {
+            *text = (const char *)p;
+            return len;
+        }
+    }
+}
+
+static void build_key(char *key, size_t size, const char *room, const char *term) {
+    snprintf(key, size, "%s\x1f%s", room, term);
+}
+
+static PostingList *find_posting(const char *key, uint32_t hash) {
+    if (idx.table_capacity == 0) return NULL;
+
+    uint32_t mask = idx.table_capacity - 1;
+    for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+        PostingList *pl = &idx.table[i];
+        if (!pl->key) return NULL;
+        if (pl->hash == hash && strcmp(pl->key, key) == 0) return pl;
+    }
+}
+
+// Double la taille de la table de hachage
+static int grow_table(void) {
+    uint32_t new_capacity = idx.table_capacity ? idx.table_capacity * 2 : 1024;
+    PostingList *new_table = calloc(new_capacity, sizeof(PostingList));
+    if (!new_table) {
+        perror("Échec calloc index de recherche");
+        return -1;
+    }
+
+    uint32_t mask = new_capacity - 1;
+    for (uint32_t i = 0; i < idx.table_capacity; i++) {
+        PostingList *pl = &idx.table[i];
+        if (!pl->key) continue;
+        uint32_t j = pl->hash & mask;
+        while (new_table[j].key) j = (j + 1) & mask;
+        new_table[j] = *pl;
+    }
+
+    free(idx.table);
+    idx.table = new_table;
+    idx.table_capacity = new_capacity;
+    return 0;
+}
+
+static PostingList *get_or_create_posting(const char *key) {
+    uint32_t hash = hash_key(key);
+    PostingList *pl = find_posting(key, hash);
+    if (pl) return pl;
+
+    // Maintenir un taux de remplissage inférieur à 70%
+    if ((idx.table_count + 1) * 10 >= idx.table_capacity * 7) {
+        if (grow_table() < 0) return NULL;
+    }
+
+    uint32_t mask = idx.table_capacity - 1;
+    uint32_t i = hash & mask;
+    while (idx.table[i].key) i = (i + 1) & mask;
+
+    pl = &idx.table[i];
+    pl->key = strdup(key);
+    if (!pl->key) return NULL;
+    pl->hash = hash;
+    idx.table_count++;
+    return pl;
+}
+
+// Ajoute un identifiant (croissant) à une liste de postings
+static int posting_append(PostingList *pl, uint32_t id) {
+    // Un terme répété dans le même message n'est indexé qu'une fois
+    if (pl->count > 0 && pl->last_id == id) return 0;
+
+    // Point de saut au début de chaque bloc
+    if (pl->count % SEARCH_SKIP_INTERVAL == 0) {
+        if (pl->nb_skips >= pl->skips_cap) {
+            uint32_t new_cap = pl->skips_cap ? pl->skips_cap * 2 : 4;
+            SkipEntry *new_skips = realloc(pl->skips, sizeof(SkipEntry) * new_cap);
+            if (!new_skips) return -1;
+            pl->skips = new_skips;
+            pl->skips_cap = new_cap;
+        }
+        pl->skips[pl->nb_skips].base_id = pl->last_id;
+        pl->skips[pl->nb_skips].offset = pl->len;
+        pl->nb_skips++;
+    }
+
+    // Un varint 32 bits occupe au plus 5 octets
+    if (pl->len + 5 > pl->cap) {
+        uint32_t new_cap = pl->cap ? pl->cap * 2 : 16;
+        uint8_t *new_data = realloc(pl->data, new_cap);
+        if (!new_data) return -1;
+        pl->data = new_data;
+        pl->cap = new_cap;
+    }
+
+    uint32_t delta = id - pl->last_id;
+    while (delta >= 0x80) {
+        pl->data[pl->len++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    pl->data[pl->len++] = (uint8_t)delta;
+
+    pl->last_id = id;
+    pl->count++;
+    return 0;
+}
+
+// Décode l'identifiant suivant. Retourne 0 en fin de liste.
+static int cursor_next(PostingCursor *c) {
+    if (c->idx >= c->pl->count) return 0;
+
+    uint32_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = c->pl->data[c->pos++];
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    c->cur += delta;
+    c->idx++;
+    return 1;
+}
+
+// Avance jusqu'au premier identifiant >= target. Retourne 0 en fin de liste.
+static int cursor_advance(PostingCursor *c, uint32_t target) {
+    if (c->idx > 0 && c->cur >= target) return 1;
+
+    // Recherche dichotomique du dernier bloc dont la base est < target
+    const PostingList *pl = c->pl;
+    uint32_t lo = 0, hi = pl->nb_skips;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (pl->skips[mid].base_id < target) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0) {
+        uint32_t block = lo - 1;
+        uint32_t block_idx = block * SEARCH_SKIP_INTERVAL;
+        // Ne sauter que vers l'avant
+        if (block_idx > c->idx || c->idx == 0) {
+            c->pos = pl->skips[block].offset;
+            c->cur = pl->skips[block].base_id;
+            c->idx = block_idx;
+        }
+    }
+
+    while (cursor_next(c)) {
+        if (c->cur >= target) return 1;
+    }
+    return 0;
+}
+
+// Remplace les retours à la ligne et tabulations pour garder une ligne par message
+static void sanitize_field(char *dst, const char *src, size_t size) {
+    size_t i;
+    for (i = 0; src[i] && i < size - 1; i++) {
+        dst[i] = (src[i] == '\n' || src[i] == '\r' || src[i] == '\t') ? ' ' : src[i];
+    }
+    dst[i] = '\0';
+}
+
+// Indexe un message déjà présent dans le journal (verrou d'écriture tenu)
+static void index_message(const char *room, const char *content, uint64_t offset) {
+    if (idx.nb_messages >= idx.msg_capacity) {
+        uint32_t new_cap = idx.msg_capacity ? idx.msg_capacity * 2 : 4096;
+        uint64_t *new_offsets = realloc(idx.msg_offsets, sizeof(uint64_t) * new_cap);
+        if (!new_offsets) {
+            perror("Échec realloc historique");
+            return;
+        }
+        idx.msg_offsets = new_offsets;
+        idx.msg_capacity = new_cap;
+    }
+
+    idx.msg_offsets[idx.nb_messages++] = offset;
+    uint32_t id = idx.nb_messages;
+
+    char term[SEARCH_TERM_MAX];
+    char key[50 + 1 + SEARCH_TERM_MAX];
+    const char *p = content;
+    while (next_term(&p, term)) {
+        build_key(key, sizeof(key), room, term);
+        PostingList *pl = get_or_create_posting(key);
+        if (!pl || posting_append(pl, id) < 0) {
+            perror("Échec de l'indexation d'un terme");
+            return;
+        }
+    }
+}
+
+// Découpe une ligne du journal : "<timestamp>\t<salon>\t<expéditeur>\t<contenu>"
+static int parse_log_line(char *line, time_t *ts, char **room, char **sender, char **content) {
+    char *fields[4];
+    char *p = line;
+    for (int i = 0; i < 3; i++) {
+        fields[i] = p;
+        p = strchr(p, '\t');
+        if (!p) return -1;
+        *p++ = '\0';
+    }
+    fields[3] = p;
+    p[strcspn(p, "\n")] = '\0';
+
+    *ts = (time_t)strtoll(fields[0], NULL, 10);
+    *room = fields[1];
+    *sender = fields[2];
+    *content = fields[3];
+    return 0;
+}
+
+// Relit l'historique existant pour reconstruire l'index au démarrage
+static void reindex_history(void) {
+    FILE *f = fdopen(dup(idx.log_fd), "r");
+    if (!f) return;
+    fseeko(f, 0, SEEK_SET);
+
+    char line[MAX_MSG_SIZE + 256];
+    off_t offset = 0;
+    unsigned long count = 0;
+
+    pthread_rwlock_wrlock(&idx.index_lock);
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        time_t ts;
+        char *room, *sender, *content;
+        if (parse_log_line(line, &ts, &room, &sender, &content) == 0) {
+            index_message(room, content, (uint64_t)offset);
+            count++;
+        }
+        offset += (off_t)len;
+    }
+    pthread_rwlock_unlock(&idx.index_lock);
+
+    fclose(f);
+    if (count > 0) {
+        printf("Historique réindexé: %lu message(s)\n", count);
+    }
+}
+
+static void *search_index_thread(void *arg) {
+    (void)arg;
+
+    reindex_history();
+
+    PendingMessage *batch = malloc(sizeof(PendingMessage) * SEARCH_BATCH_SIZE);
+    char *buffer = malloc((size_t)SEARCH_BATCH_SIZE * (MAX_MSG_SIZE + 256));
+    uint64_t offsets[SEARCH_BATCH_SIZE];
+    if (!batch || !buffer) {
+        perror("Échec malloc thread d'indexation");
+        free(batch);
+        free(buffer);
+        return NULL;
+    }
+
+    for (;;) {
+        // Récupérer un lot de messages en attente
+        pthread_mutex_lock(&idx.queue_mutex);
+        while (idx.queue_count == 0 && !idx.stop) {
+            pthread_cond_wait(&idx.queue_cond, &idx.queue_mutex);
+        }
+        if (idx.queue_count == 0 && idx.stop) {
+            pthread_mutex_unlock(&idx.queue_mutex);
+            break;
+        }
+        int n = 0;
+        while (idx.queue_count > 0 && n < SEARCH_BATCH_SIZE) {
+            batch[n++] = idx.queue[idx.queue_head];
+            idx.queue_head = (idx.queue_head + 1) % SEARCH_QUEUE_SIZE;
+            idx.queue_count--;
+        }
+        pthread_mutex_unlock(&idx.queue_mutex);
+
+        // Écrire le lot dans le journal en un seul appel
+        size_t used = 0;
+        for (int i = 0; i < n; i++) {
+            char content[MAX_MSG_SIZE];
+            sanitize_field(content, batch[i].content, sizeof(content));
+            offsets[i] = (uint64_t)idx.log_size + used;
+            int written = snprintf(buffer + used, MAX_MSG_SIZE + 256, "%lld\t%s\t%s\t%s\n",
+                                   (long long)batch[i].timestamp, batch[i].room,
+                                   batch[i].sender, content);
+            used += (size_t)written;
+        }
+        if (write(idx.log_fd, buffer, used) != (ssize_t)used) {
+            perror("Erreur lors de l'écriture de l'historique");
+            continue;
+        }
+        idx.log_size += (off_t)used;
+
+        // Mettre à jour l'index
+        pthread_rwlock_wrlock(&idx.index_lock);
+        for (int i = 0; i < n; i++) {
+            index_message(batch[i].room, batch[i].content, offsets[i]);
+        }
+        pthread_rwlock_unlock(&idx.index_lock);
+    }
+
+    free(batch);
+    free(buffer);
+    return NULL;
+}
+
+int init_search_index(const char *history_file) {
+    idx.log_fd = open(history_file, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (idx.log_fd < 0) {
+        perror("Erreur lors de l'ouverture de l'historique");
+        return -1;
+    }
+
+    struct stat st;
+    idx.log_size = (fstat(idx.log_fd, &st) == 0) ? st.st_size : 0;
+
+    idx.queue = malloc(sizeof(PendingMessage) * SEARCH_QUEUE_SIZE);
+    if (!idx.queue) {
+        perror("Erreur malloc file d'indexation");
+        close(idx.log_fd);
+        idx.log_fd = -1;
+        return -1;
+    }
+
+    pthread_rwlock_init(&idx.index_lock, NULL);
+    pthread_mutex_init(&idx.queue_mutex, NULL);
+    pthread_cond_init(&idx.queue_cond, NULL);
+
+    if (pthread_create(&idx.thread, NULL, search_index_thread, NULL) != 0) {
+        perror("Erreur lors de la création du thread d'indexation");
+        free(idx.queue);
+        idx.queue = NULL;
+        close(idx.log_fd);
+        idx.log_fd = -1;
+        return -1;
+    }
+    idx.started = 1;
+    return 0;
+}
+
+void shutdown_search_index(void) {
+    if (!idx.started) return;
+
+    pthread_mutex_lock(&idx.queue_mutex);
+    idx.stop = 1;
+    pthread_cond_signal(&idx.queue_cond);
+    pthread_mutex_unlock(&idx.queue_mutex);
+    pthread_join(idx.thread, NULL);
+    idx.started = 0;
+
+    if (idx.dropped > 0) {
+        printf("Historique: %lu message(s) non indexé(s) (file pleine)\n", idx.dropped);
+    }
+
+    for (uint32_t i = 0; i < idx.table_capacity; i++) {
+        PostingList *pl = &idx.table[i];
+        if (!pl->key) continue;
+        free(pl->key);
+        free(pl->data);
+        free(pl->skips);
+    }
+    free(idx.table);
+    free(idx.msg_offsets);
+    free(idx.queue);
+    idx.table = NULL;
+    idx.msg_offsets = NULL;
+    idx.queue = NULL;
+
+    close(idx.log_fd);
+    idx.log_fd = -1;
+    pthread_rwlock_destroy(&idx.index_lock);
+    pthread_mutex_destroy(&idx.queue_mutex);
+    pthread_cond_destroy(&idx.queue_cond);
+}
+
+void search_index_message(const char *room, const char *sender, const char *content) {
+    if (!idx.started) return;
+
+    pthread_mutex_lock(&idx.queue_mutex);
+    if (idx.queue_count >= SEARCH_QUEUE_SIZE) {
+        // Ne jamais bloquer le thread de réception : le message n'est pas historisé
+        idx.dropped++;
+        pthread_mutex_unlock(&idx.queue_mutex);
+        return;
+    }
+
+    int tail = (idx.queue_head + idx.queue_count) % SEARCH_QUEUE_SIZE;
+    PendingMessage *m = &idx.queue[tail];
+    m->timestamp = time(NULL);
+    sanitize_field(m->room, room, sizeof(m->room));
+    sanitize_field(m->sender, sender, sizeof(m->sender));
+    strncpy(m->content, content, sizeof(m->content) - 1);
+    m->content[sizeof(m->content) - 1] = '\0';
+    idx.queue_count++;
+
+    pthread_cond_signal(&idx.queue_cond);
+    pthread_mutex_unlock(&idx.queue_mutex);
+}
+
+// Relit un message du journal à partir de sa position
+static int read_hit(uint64_t offset, SearchHit *hit) {
+    char line[MAX_MSG_SIZE + 256];
+    ssize_t n = pread(idx.log_fd, line, sizeof(line) - 1, (off_t)offset);
+    if (n <= 0) return -1;
+    line[n] = '\0';
+
+    time_t ts;
+    char *room, *sender, *content;
+    if (parse_log_line(line, &ts, &room, &sender, &content) < 0) return -1;
+
+    hit->timestamp = ts;
+    strncpy(hit->sender, sender, sizeof(hit->sender) - 1);
+    hit->sender[sizeof(hit->sender) - 1] = '\0';
+    strncpy(hit->content, content, sizeof(hit->content) - 1);
+    hit->content[sizeof(hit->content) - 1] = '\0';
+    return 0;
+}
+
+int search_room(const char *room, const char *terms, SearchHit *hits, int max_hits,
+                int *total_matches) {
+    if (total_matches) *total_matches = 0;
+    if (!idx.started || max_hits <= 0) return -1;
+
+    // Extraire les termes (sans doublons)
+    char query[SEARCH_MAX_TERMS][SEARCH_TERM_MAX];
+    int nb_terms = 0;
+    char term[SEARCH_TERM_MAX];
+    const char *p = terms;
+    while (nb_terms < SEARCH_MAX_TERMS && next_term(&p, term)) {
+        int duplicate = 0;
+        for (int i = 0; i < nb_terms; i++) {
+            if (strcmp(query[i], term) == 0) duplicate = 1;
+        }
+        if (!duplicate) strcpy(query[nb_terms++], term);
+    }
+    if (nb_terms == 0) return -1;
+
+    uint64_t hit_offsets[SEARCH_MAX_RESULTS];
+    uint32_t ring[SEARCH_MAX_RESULTS];
+    if (max_hits > SEARCH_MAX_RESULTS) max_hits = SEARCH_MAX_RESULTS;
+    int matches = 0;
+
+    pthread_rwlock_rdlock(&idx.index_lock);
+
+    PostingCursor cursors[SEARCH_MAX_TERMS];
+    char key[50 + 1 + SEARCH_TERM_MAX];
+    for (int i = 0; i < nb_terms; i++) {
+        build_key(key, sizeof(key), room, query[i]);
+        const PostingList *pl = find_posting(key, hash_key(key));
+        if (!pl) {
+            pthread_rwlock_unlock(&idx.index_lock);
+            return 0;
+        }
+        cursors[i].pl = pl;
+        cursors[i].pos = 0;
+        cursors[i].idx = 0;
+        cursors[i].cur = 0;
+    }
+
+    // La liste la plus courte pilote l'intersection
+    for (int i = 1; i < nb_terms; i++) {
+        if (cursors[i].pl->count < cursors[0].pl->count) {
+            PostingCursor tmp = cursors[0];
+            cursors[0] = cursors[i];
+            cursors[i] = tmp;
+        }
+    }
+
+    int more = cursor_next(&cursors[0]);
+    while (more) {
+        uint32_t candidate = cursors[0].cur;
+        uint32_t next_target = 0;
+        int exhausted = 0;
+        for (int i = 1; i < nb_terms; i++) {
+            if (!cursor_advance(&cursors[i], candidate)) {
+                exhausted = 1;
+                break;
+            }
+            if (cursors[i].cur != candidate) {
+                next_target = cursors[i].cur;
+                break;
+            }
+        }
+        if (exhausted) break;
+
+        if (next_target) {
+            // Sauter directement au prochain candidat possible
+            more = cursor_advance(&cursors[0], next_target);
+            continue;
+        }
+
+        // Garder les max_hits derniers résultats
+        ring[matches % max_hits] = candidate;
+        matches++;
+        more = cursor_next(&cursors[0]);
+    }
+
+    int nb_hits = matches < max_hits ? matches : max_hits;
+    for (int i = 0; i < nb_hits; i++) {
+        // Du plus récent au plus ancien
+        uint32_t id = ring[(matches - 1 - i) % max_hits];
+        hit_offsets[i] = idx.msg_offsets[id - 1];
+    }
+
+    pthread_rwlock_unlock(&idx.index_lock);
+
+    // Relire les messages sans tenir le verrou de l'index
+    int found = 0;
+    for (int i = 0; i < nb_hits; i++) {
+        if (read_hit(hit_offsets[i], &hits[found]) == 0) found++;
+    }
+
+    if (total_matches) *total_matches = matches;
+    return found;
+}
@@ -0,0 +1,39 @@
+// search.h
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+#include <time.h>
+#include "common.h"
+
+#define HISTORY_FILE          "history.log"
+#define SEARCH_QUEUE_SIZE     4096  // Messages en attente d'indexation
+#define SEARCH_MAX_RESULTS    10    // Nombre maximum de résultats renvoyés
+#define SEARCH_MAX_TERMS      8     // Nombre maximum de termes par requête
+#define SEARCH_TERM_MAX       32    // Longueur maximale d'un terme indexé
+#define SEARCH_SKIP_INTERVAL  64    // Un point de saut toutes les 64 entrées
+
+// Résultat d'une recherche (relu depuis le journal de l'historique)
+typedef struct {
+    time_t timestamp;
+    char sender[50];
+    char content[MAX_MSG_SIZE];
+} SearchHit;
+
+// Démarre l'index : ouvre le journal, relance l'indexation de l'historique
+// existant puis indexe en arrière-plan les nouveaux messages
+int  init_search_index(const char *history_file);
+
+// Arrête le thread d'indexation après avoir vidé la file d'attente
+void shutdown_search_index(void);
+
+// Ajoute un message diffusé dans un salon à l'historique (non bloquant)
+void search_index_message(const char *room, const char *sender, const char *content);
+
+// Recherche les messages d'un salon contenant tous les termes donnés.
+// Les résultats les plus récents sont placés en premier.
+// Retourne le nombre de résultats (<= max_hits), -1 en cas d'erreur.
+int  search_room(const char *room, const char *terms, SearchHit *hits, int max_hits,
+                 int *total_matches);
+
+#endif /* SEARCH_H */
@@ -1,6 +1,19 @@
 #include "server.h"
 #include "command.h"
 #include "common.h"
+#include "search.h"
+#include "offline.h"
+#include "catalog.h"
+#include "metrics.h"
+#include "stats.h"
+#include "egress.h"
+#include "reliable.h"
+#include "ratelimit.h"
+#include "timer.h"
+#include "slab.h"
+#include "preload.h"
+#include "presence.h"
+#include <dirent.h>
 
 // External variables defined in common.c
 extern volatile sig_atomic_t running;
@@ -20,23 +33,70 @@ void server_sigint_handler(int sig) {
     // This will allow for client notification and proper cleanup
 }
 
+// SIGHUP : relire help.txt et credits.txt (fait par le thread des réponses préchargées)
+static void server_sighup_handler(int sig) {
+    (void)sig;
+    preload_request_reload();
+}
+
+// Envoi commun aux réponses (bulk = 0) et aux diffusions (bulk = 1)
+static int send_datagram(Server *server, Request *res, struct sockaddr_in *client_addr, int bulk) {
+#ifdef BENCH_STUB_SEND
+    // Microbenchmarks : aucun envoi réel, seul le chemin côté serveur est mesuré
+    (void)server;
+    (void)res;
+    (void)client_addr;
+    (void)bulk;
+    ssize_t sent = sizeof(Request);
+    metrics_inc(M_RESPONSES_SENT);
+    metrics_add(M_BYTES_SENT, (uint64_t)sent);
+    return 0;
+#else
+    // Numérotation pour les sessions fiables, puis mise en file : l'envoi est fait
+    // par les threads d'egress, hors des verrous
+    (void)server;
+    if (!bulk) {
+        reliable_prepare(res, client_addr, 0);
+        return egress_send(res, client_addr);
+    }
+    // Un destinataire sans crédit ou une file saturée coûte un message à ce
+    // destinataire seulement, jamais du retard aux autres membres du salon
+    if (reliable_prepare(res, client_addr, 1) < 0) return -2;
+    return egress_send_bulk(res, client_addr);
+#endif
+}
+
 // Fonction pour envoyer une réponse à un client
 int send_response(Server *server, Request *res, struct sockaddr_in *client_addr) {
-    ssize_t sent = sendto(server->socket_fd, res, sizeof(Request), 0,
-                         (struct sockaddr*)client_addr, sizeof(struct sockaddr_in));
-    if (sent < 0) {
-        perror("Erreur lors de l'envoi de la réponse");
-        return -1;
-    }
-    return 0;
+    return send_datagram(server, res, client_addr, 0);
+}
+
+// Fonction pour diffuser un message à un membre d'un salon
+int send_broadcast(Server *server, Request *res, struct sockaddr_in *client_addr) {
+    return send_datagram(server, res, client_addr, 1);
+}
+
+// Contexte de offline_flush : les messages suivent la confirmation de connexion
+// dans la même file d'egress et sont numérotés pour les sessions fiables
+typedef struct {
+    Server *server;
+    struct sockaddr_in *addr;
+} OfflineTarget;
+
+static int deliver_offline(Request *frame, void *ctx) {
+    OfflineTarget *target = ctx;
+    return send_response(target->server, frame, target->addr);
 }
 
 // Fonction pour marquer un client comme déconnecté
 void remove_client(Server *server, const char *username) {
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
+    NameId id = intern_find(username);
     for (int i = 0; i < server->client_count; i++) {
-        if (strcmp(server->clients[i].username, username) == 0) {
-            server->clients[i].connected = false;
+        if (id != INTERN_NONE && server->client_hot[i].id == id) {
+            server->client_hot[i].connected = false;
+            touch_clients(server);
+            ratelimit_bind(username, NULL);
             
             // Quitter tous les salons
             remove_user(server, username, NULL);
@@ -46,6 +106,30 @@ void remove_client(Server *server, const char *username) {
     pthread_mutex_unlock(&server->clients_mutex);
 }
 
+void init_listing_caches(Server *server) {
+    server->clients_version = 0;
+    server->salons_version = 0;
+    for (int i = 0; i < LISTING_CACHE_SLOTS; i++) {
+        ListingCache *caches[2] = { &server->client_listings[i], &server->salon_listings[i] };
+        for (int k = 0; k < 2; k++) {
+            pthread_mutex_init(&caches[k]->mutex, NULL);
+            caches[k]->text = NULL;
+            caches[k]->len = 0;
+        }
+    }
+}
+
+void free_listing_caches(Server *server) {
+    for (int i = 0; i < LISTING_CACHE_SLOTS; i++) {
+        ListingCache *caches[2] = { &server->client_listings[i], &server->salon_listings[i] };
+        for (int k = 0; k < 2; k++) {
+            free(caches[k]->text);
+            caches[k]->text = NULL;
+            pthread_mutex_destroy(&caches[k]->mutex);
+        }
+    }
+}
+
 int init_server(Server *server) {
     // Créer la socket UDP
     server->socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -82,14 +166,17 @@ int init_server(Server *server) {
       // Initialiser le tableau des clients
     server->client_capacity = 10;
     server->client_count = 0;
-    server->clients = malloc(sizeof(ClientInfo) * server->client_capacity);
-    if (!server->clients) {
+    server->client_by_id = NULL;
+    server->client_by_id_capacity = 0;
+    server->clients = calloc(server->client_capacity, sizeof(ClientInfo));
+    server->client_hot = calloc(server->client_capacity, sizeof(ClientHot));
+    if (!server->clients || !server->client_hot) {
         perror("Erreur malloc clients");
+        free(server->clients);
+        free(server->client_hot);
         close(server->socket_fd);
         return -1;
     }
-
-    memset(server->clients, 0, sizeof(ClientInfo) * server->client_capacity);
     
     // Initialiser le tableau des salons
     server->salon_capacity = 10;
@@ -116,9 +203,12 @@ int init_server(Server *server) {
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, NULL);
+    sa.sa_handler = server_sighup_handler;
+    sigaction(SIGHUP, &sa, NULL);
     
     // Initialiser le mutex pour les salons
     pthread_mutex_init(&server->salons_mutex, NULL);
+    init_listing_caches(server);
 
     // Charger les salons existants depuis un fichier
     load_rooms(server, "rooms.txt");
@@ -126,33 +216,211 @@ int init_server(Server *server) {
     return 0;
 }
 
+// Minuteurs par client, au même indice que server->clients : ce tableau peut
+// être réalloué, les minuteurs ne peuvent donc pas y être rangés
+typedef struct {
+    Timer mute;        // Fin du mode muet
+    Server *server;
+    int index;
+} ClientTimers;
+
+static ClientTimers client_timers[MAX_CLIENTS];
+
+static void mute_expired(void *arg);
+
+// Appelé avec clients_mutex verrouillé
+static ClientTimers *timers_for(Server *server, int client_idx) {
+    ClientTimers *ct = &client_timers[client_idx];
+    if (!ct->server) {
+        ct->server = server;
+        ct->index = client_idx;
+        timer_init(&ct->mute, mute_expired, ct);
+    }
+    return ct;
+}
+
+void schedule_mute_expiry(Server *server, int client_idx) {
+    time_t now = time(NULL);
+    time_t until = server->clients[client_idx].mute_until;
+    uint64_t delay_ms = until > now ? (uint64_t)(until - now) * 1000 : 0;
+    timer_schedule(&timers_for(server, client_idx)->mute, delay_ms);
+}
+
+void cancel_mute_expiry(int client_idx) {
+    if (client_timers[client_idx].server) timer_cancel(&client_timers[client_idx].mute);
+}
+
+// Fin du mode muet : l'utilisateur est prévenu s'il est connecté
+static void mute_expired(void *arg) {
+    ClientTimers *ct = arg;
+    Server *server = ct->server;
+    struct sockaddr_in addr;
+    int notify = 0;
+    
+    lock_clients(server);
+    ClientInfo *client = &server->clients[ct->index];
+    if (client->is_muted) {
+        if (time(NULL) >= client->mute_until) {
+            client->is_muted = false;
+            client->mute_until = 0;
+            touch_clients(server);
+            notify = server->client_hot[ct->index].connected;
+            addr = server->client_hot[ct->index].addr;
+            printf("Le mode muet de l'utilisateur %s a expiré\n", client_name(server, ct->index));
+        } else {
+            // Durée prolongée entre-temps
+            schedule_mute_expiry(server, ct->index);
+        }
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+    
+    if (notify) {
+        Request response;
+        init_request(&response, REQ_MESSAGE, "Server", "", 
+                     "Votre mode muet est terminé. Vous pouvez à nouveau parler.");
+        send_response(server, &response, &addr);
+    }
+}
+
+// Appelé avec clients_mutex verrouillé
+int is_client_still_connected(Server *server, int client_idx) {
+    ClientHot *client = &server->client_hot[client_idx];
+    return client->connected && time(NULL) - client->last_seen < CLIENT_IDLE_TIMEOUT;
+}
+
+// Appelé avec clients_mutex verrouillé. Un client suspect (plusieurs signaux de
+// présence manqués) ne reçoit plus les diffusions jusqu'à sa prochaine requête.
+int is_client_reachable(Server *server, int client_idx, time_t now) {
+    ClientHot *client = &server->client_hot[client_idx];
+    return client->connected && now - client->last_seen < CLIENT_SUSPECT_TIMEOUT;
+}
+
+// Balayage de présence : un seul minuteur pour tous les clients
+static Timer presence_timer;
+
+// Appelé avec clients_mutex verrouillé, à chaque connexion
+static void start_presence(Server *server, int client_idx) {
+    server->client_hot[client_idx].last_seen = time(NULL);
+}
+
+// Sonde les clients silencieux et déconnecte d'un coup ceux qui n'ont répondu ni
+// aux sondes ni par REQ_HEARTBEAT. Les sessions fiables sont fermées hors verrou,
+// les départs annoncés avec les autres (presence.c).
+static void presence_sweep(void *arg) {
+    Server *server = arg;
+    struct sockaddr_in *addrs = NULL;
+    int evicted = 0;
+    Request probe;
+    
+    lock_clients(server);
+    time_t now = time(NULL);
+    for (int i = 0; i < server->client_count; i++) {
+        ClientHot *client = &server->client_hot[i];
+        if (!client->connected) continue;
+        
+        time_t idle = now - client->last_seen;
+        if (idle >= CLIENT_IDLE_TIMEOUT) {
+            if (!addrs) {
+                addrs = malloc(sizeof(*addrs) * server->client_count);
+                if (!addrs) {
+                    perror("Erreur d'allocation pour le balayage de présence");
+                    break;
+                }
+            }
+            client->connected = false;
+            touch_clients(server);
+            ratelimit_bind(client_name(server, i), NULL);
+            presence_event(server, i, 0, 1);
+            addrs[evicted] = client->addr;
+            evicted++;
+        } else if (idle >= CLIENT_PING_INTERVAL) {
+            init_request(&probe, REQ_COMMAND, "Server", client_name(server, i), "@keepalive");
+            send_response(server, &probe, &client->addr);
+        }
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+    
+    if (evicted > 0) {
+        printf("%d client(s) inactif(s) déconnecté(s)\n", evicted);
+        metrics_add(M_CLIENTS_EVICTED, evicted);
+        for (int i = 0; i < evicted; i++) reliable_close(&addrs[i]);
+    }
+    free(addrs);
+    
+    timer_schedule(&presence_timer, CLIENT_SWEEP_INTERVAL * 1000);
+}
+
+void start_presence_sweep(Server *server) {
+    timer_init(&presence_timer, presence_sweep, server);
+    timer_schedule(&presence_timer, CLIENT_SWEEP_INTERVAL * 1000);
+}
+
+// Activité d'un client qui ne passe pas par le contrôle du mode muet
+static void touch_client(Server *server, const char *username, const struct sockaddr_in *addr) {
+    lock_clients(server);
+    int idx = find_client_by_username(server, username);
+    if (idx >= 0 && server->client_hot[idx].connected &&
+        server->client_hot[idx].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+        server->client_hot[idx].addr.sin_port == addr->sin_port) {
+        server->client_hot[idx].last_seen = time(NULL);
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+}
+
+int find_registered_client(Server *server, NameId id) {
+    if (id == INTERN_NONE || id >= server->client_by_id_capacity) return -1;
+    return server->client_by_id[id];
+}
+
+// Associe id à l'indice idx. Appelé avec clients_mutex verrouillé.
+static int bind_client_id(Server *server, NameId id, int idx) {
+    if (id == INTERN_NONE) return -1;
+    if (id >= server->client_by_id_capacity) {
+        uint32_t capacity = server->client_by_id_capacity ? server->client_by_id_capacity : 64;
+        while (capacity <= id) capacity *= 2;
+        int *map = realloc(server->client_by_id, sizeof(int) * capacity);
+        if (!map) {
+            perror("Échec realloc index des clients");
+            return -1;
+        }
+        for (uint32_t i = server->client_by_id_capacity; i < capacity; i++) map[i] = -1;
+        server->client_by_id = map;
+        server->client_by_id_capacity = capacity;
+    }
+    server->client_by_id[id] = idx;
+    server->client_hot[idx].id = id;
+    return 0;
+}
+
+int find_client_by_id(Server *server, NameId id) {
+    int idx = find_registered_client(server, id);
+    return idx >= 0 && server->client_hot[idx].connected ? idx : -1;
+}
+
+// Le pseudonyme n'est converti qu'une fois, le reste se fait par identifiant
 int find_client_by_username(Server *server, const char *username) {
-    int i;
-    for (i = 0; i < server->client_count; i++) {
-        if (strcmp(server->clients[i].username, username) == 0 && 
-            server->clients[i].connected) {
-            return i;
+    return find_client_by_id(server, intern_find(username));
+}
+
+void broadcast_all(Server *server, Request *msg, int except_idx) {
+    time_t now = time(NULL);
+    for (int i = 0; i < server->client_count; i++) {
+        if (i != except_idx && is_client_reachable(server, i, now)) {
+            send_broadcast(server, msg, &server->client_hot[i].addr);
         }
     }
-    return -1;
 }
 
 int add_client(Server *server, const char *username, const char *password, 
     struct sockaddr_in *addr) {
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
 
     // Vérifier si le client existe déjà
-    int idx = -1;
-    for (int i = 0; i < server->client_count; i++) {
-        if (strcmp(server->clients[i].username, username) == 0) {
-            idx = i;
-            break;
-        }
-    }
+    int idx = find_registered_client(server, intern_find(username));
     
     if (idx >= 0) {
         // Utilisateur trouvé - vérifier s'il est déjà connecté
-        if (server->clients[idx].connected) {
+        if (server->client_hot[idx].connected) {
             pthread_mutex_unlock(&server->clients_mutex);
             return -2; // Code d'erreur : utilisateur déjà connecté
         }
@@ -164,19 +432,12 @@ int add_client(Server *server, const char *username, const char *password,
         }
         
         // Reconnexion autorisée - mettre à jour l'adresse
-        memcpy(&server->clients[idx].addr, addr, sizeof(struct sockaddr_in));
-        server->clients[idx].connected = true;
-        
-        // Vérifier si la période de mute est terminée
-        if (server->clients[idx].is_muted) {
-            time_t now = time(NULL);
-            if (now >= server->clients[idx].mute_until) {
-                // Le mute a expiré
-                server->clients[idx].is_muted = false;
-                server->clients[idx].mute_until = 0;
-                printf("Le mode muet de l'utilisateur %s a expiré pendant son absence\n", username);
-            }
-        }
+        memcpy(&server->client_hot[idx].addr, addr, sizeof(struct sockaddr_in));
+        server->client_hot[idx].connected = true;
+        touch_clients(server);
+        ratelimit_set_role(username, server->clients[idx].role);
+        ratelimit_bind(username, addr);
+        start_presence(server, idx);
         
         pthread_mutex_unlock(&server->clients_mutex);
         return idx;
@@ -187,12 +448,14 @@ int add_client(Server *server, const char *username, const char *password,
     if (server->client_count >= server->client_capacity) {
         int new_capacity = server->client_capacity * 2;
         ClientInfo *new_clients = realloc(server->clients, sizeof(ClientInfo) * new_capacity);
-        if (!new_clients) {
+        if (new_clients) server->clients = new_clients;
+        ClientHot *new_hot = realloc(server->client_hot, sizeof(ClientHot) * new_capacity);
+        if (new_hot) server->client_hot = new_hot;
+        if (!new_clients || !new_hot) {
             perror("Échec realloc clients");
             pthread_mutex_unlock(&server->clients_mutex);
             return -1;
         }
-        server->clients = new_clients;
         server->client_capacity = new_capacity;
     }
 
@@ -202,18 +465,23 @@ int add_client(Server *server, const char *username, const char *password,
         return -4; // Serveur plein
     }
     
-    // Ajouter le nouveau client
-    idx = server->client_count++;
-    
-    strncpy(server->clients[idx].username, username, sizeof(server->clients[idx].username) - 1);
-    server->clients[idx].username[sizeof(server->clients[idx].username) - 1] = '\0';
+    // Ajouter le nouveau client : le pseudonyme reçoit son identifiant
+    idx = server->client_count;
+    NameId id = intern_name(username);
+    if (id == INTERN_NONE || bind_client_id(server, id, idx) < 0) {
+        pthread_mutex_unlock(&server->clients_mutex);
+        return -1;
+    }
+    server->client_count++;
     
     strncpy(server->clients[idx].password, password, sizeof(server->clients[idx].password) - 1);
     server->clients[idx].password[sizeof(server->clients[idx].password) - 1] = '\0';
     
-    memcpy(&server->clients[idx].addr, addr, sizeof(struct sockaddr_in));
-    server->clients[idx].connected = true;
+    memcpy(&server->client_hot[idx].addr, addr, sizeof(struct sockaddr_in));
+    server->client_hot[idx].connected = true;
     server->clients[idx].salon_courant[0] = '\0';
+    server->clients[idx].presence_mode = PRESENCE_ALL;
+    server->clients[idx].nb_contacts = 0;
     
     // Initialiser les champs relatifs au mute
     server->clients[idx].is_muted = false;
@@ -226,6 +494,10 @@ int add_client(Server *server, const char *username, const char *password,
     } else {
         server->clients[idx].role = ROLE_USER;
     }
+    touch_clients(server);
+    ratelimit_set_role(username, server->clients[idx].role);
+    ratelimit_bind(username, addr);
+    start_presence(server, idx);
     
     pthread_mutex_unlock(&server->clients_mutex);
     return idx;
@@ -240,14 +512,16 @@ void save_users_to_file(Server *server) {
     }
     
     // Verrouiller la mutex pour accéder à la liste des clients
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
     
     // Écrire le nombre de clients
     fwrite(&server->client_count, sizeof(int), 1, file);
     
     // Écrire les informations de chaque client
     for (int i = 0; i < server->client_count; i++) {
-        fwrite(&server->clients[i].username, sizeof(server->clients[i].username), 1, file);
+        char username[INTERN_NAME_SIZE] = {0};
+        strncpy(username, client_name(server, i), sizeof(username) - 1);
+        fwrite(username, sizeof(username), 1, file);
         fwrite(&server->clients[i].password, sizeof(server->clients[i].password), 1, file);
         fwrite(&server->clients[i].role, sizeof(UserRole), 1, file);
         fwrite(&server->clients[i].is_muted, sizeof(bool), 1, file);
@@ -275,14 +549,29 @@ void load_users_from_file(Server *server) {
     }
     
     // Verrouiller la mutex
-    pthread_mutex_lock(&server->clients_mutex);
+    lock_clients(server);
+    
+    // Agrandir les tableaux si le fichier contient plus d'utilisateurs
+    if (count > MAX_CLIENTS) count = MAX_CLIENTS;
+    if (count > server->client_capacity) {
+        ClientInfo *new_clients = realloc(server->clients, sizeof(ClientInfo) * count);
+        if (new_clients) server->clients = new_clients;
+        ClientHot *new_hot = realloc(server->client_hot, sizeof(ClientHot) * count);
+        if (new_hot) server->client_hot = new_hot;
+        if (new_clients && new_hot) {
+            server->client_capacity = count;
+        } else {
+            perror("Échec realloc clients");
+            count = server->client_capacity;
+        }
+    }
     
     // Lire les informations de chaque client
-    for (int i = 0; i < count && i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < count; i++) {
         ClientInfo client;
-        client.connected = false;  // Par défaut non connectés au démarrage
+        char username[INTERN_NAME_SIZE];
         
-        if (fread(&client.username, sizeof(client.username), 1, file) != 1 ||
+        if (fread(username, sizeof(username), 1, file) != 1 ||
             fread(&client.password, sizeof(client.password), 1, file) != 1 ||
             fread(&client.role, sizeof(UserRole), 1, file) != 1) {
             perror("Erreur lors de la lecture des informations d'un utilisateur");
@@ -292,26 +581,29 @@ void load_users_from_file(Server *server) {
         // Tentative de lecture des nouveaux champs (compatibilité avec anciennes versions)
         client.is_muted = false;
         client.mute_until = 0;
+        client.presence_mode = PRESENCE_ALL;
+        client.nb_contacts = 0;
         
         fread(&client.is_muted, sizeof(bool), 1, file);
         fread(&client.mute_until, sizeof(time_t), 1, file);
         
-        // Vérifier si un utilisateur encore "muet" devrait toujours l'être
-        if (client.is_muted) {
-            time_t now = time(NULL);
-            if (now >= client.mute_until) {
-                client.is_muted = false;
-                printf("Le mode muet de l'utilisateur %s a expiré\n", client.username);
-            } else {
-                int minutes_left = (int)((client.mute_until - now) / 60) + 1;
-                printf("L'utilisateur %s est muet pour encore %d minute(s)\n", 
-                       client.username, minutes_left);
-            }
-        }
+        username[sizeof(username) - 1] = '\0';
         
         // Copier les informations dans le tableau des clients
         memcpy(&server->clients[i], &client, sizeof(ClientInfo));
+        memset(&server->client_hot[i], 0, sizeof(ClientHot));  // Non connecté au démarrage
+        if (bind_client_id(server, intern_name(username), i) < 0) break;
         server->client_count = i + 1;
+        
+        // La fin du mode muet est programmée, même si elle est déjà passée
+        if (client.is_muted) {
+            int minutes_left = (int)((client.mute_until - time(NULL)) / 60) + 1;
+            if (minutes_left > 0) {
+                printf("L'utilisateur %s est muet pour encore %d minute(s)\n", 
+                       username, minutes_left);
+            }
+            schedule_mute_expiry(server, i);
+        }
     }
     
     pthread_mutex_unlock(&server->clients_mutex);
@@ -319,6 +611,148 @@ void load_users_from_file(Server *server) {
     printf("%d utilisateurs chargés depuis le fichier\n", server->client_count);
 }
 
+// Supprime les uploads partiels laissés par un arrêt brutal du serveur
+void sweep_partial_uploads(void) {
+    DIR *dir = opendir(UPLOAD_PARTIAL_DIR);
+    if (!dir) return;
+    
+    struct dirent *entry;
+    int removed = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", UPLOAD_PARTIAL_DIR, entry->d_name);
+        if (unlink(path) == 0) {
+            removed++;
+        }
+    }
+    closedir(dir);
+    
+    if (removed > 0) {
+        printf("%d upload(s) partiel(s) supprimé(s)\n", removed);
+    }
+}
+
+// Rend un upload visible : fsync des données, renommage atomique, fsync du dossier,
+// puis enregistrement dans le catalogue. Le fichier est fermé dans tous les cas.
+int commit_upload(FILE *file, const char *partial_path, const char *filename,
+                  uint64_t digest, char *final_name, size_t final_size) {
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        perror("Erreur lors de la synchronisation du fichier");
+        fclose(file);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        perror("Erreur lors de la lecture des informations du fichier");
+        fclose(file);
+        return -1;
+    }
+    if (fclose(file) != 0) {
+        perror("Erreur lors de la fermeture du fichier");
+        return -1;
+    }
+    
+    // Choisir le nom définitif au dernier moment
+    generate_unique_filename(UPLOAD_DIR, filename, final_name, final_size);
+    
+    char final_path[512];
+    snprintf(final_path, sizeof(final_path), "%s/%s", UPLOAD_DIR, final_name);
+    if (rename(partial_path, final_path) != 0) {
+        perror("Erreur lors de la publication du fichier");
+        return -1;
+    }
+    
+    // Rendre le renommage durable
+    int dir_fd = open(UPLOAD_DIR, O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    
+    // Le catalogue est à jour sans attendre l'événement inotify
+    catalog_upsert(final_name, st.st_size, st.st_mtime, digest);
+    return 0;
+}
+
+// Échéance d'un transfert TCP. À expiration, la socket est fermée dans les deux
+// sens, ce qui débloque l'appel en cours (accept, recv ou send).
+typedef struct TransferDeadline {
+    Timer timer;
+    int fd;
+    uint64_t timeout_ms;
+    uint64_t armed_ns;                // Dernier réarmement
+    int expired;
+    struct TransferDeadline *next;    // Registre des transferts en cours
+} TransferDeadline;
+
+static pthread_mutex_t transfers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TransferDeadline *transfers = NULL;
+
+static void transfer_expired(void *arg) {
+    TransferDeadline *deadline = arg;
+    pthread_mutex_lock(&transfers_mutex);
+    // Ignoré si le transfert s'est terminé pendant que le rappel attendait
+    for (TransferDeadline *d = transfers; d; d = d->next) {
+        if (d == deadline) {
+            __atomic_store_n(&d->expired, 1, __ATOMIC_RELEASE);
+            shutdown(d->fd, SHUT_RDWR);
+            metrics_inc(M_TRANSFER_TIMEOUTS);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&transfers_mutex);
+}
+
+static void transfer_begin(TransferDeadline *deadline, int fd, uint64_t timeout_ms) {
+    deadline->fd = fd;
+    deadline->timeout_ms = timeout_ms;
+    deadline->armed_ns = metrics_now_ns();
+    deadline->expired = 0;
+    timer_init(&deadline->timer, transfer_expired, deadline);
+    
+    pthread_mutex_lock(&transfers_mutex);
+    deadline->next = transfers;
+    transfers = deadline;
+    pthread_mutex_unlock(&transfers_mutex);
+    
+    timer_schedule(&deadline->timer, timeout_ms);
+}
+
+// Le transfert avance : repousser l'échéance (au plus une fois par seconde)
+static void transfer_progress(TransferDeadline *deadline) {
+    uint64_t now = metrics_now_ns();
+    if (now - deadline->armed_ns < 1000000000ULL) return;
+    deadline->armed_ns = now;
+    timer_schedule(&deadline->timer, deadline->timeout_ms);
+}
+
+static int transfer_timed_out(TransferDeadline *deadline) {
+    return __atomic_load_n(&deadline->expired, __ATOMIC_ACQUIRE);
+}
+
+// À appeler avant de fermer la socket
+static void transfer_end(TransferDeadline *deadline) {
+    pthread_mutex_lock(&transfers_mutex);
+    TransferDeadline **link = &transfers;
+    while (*link && *link != deadline) link = &(*link)->next;
+    if (*link) *link = deadline->next;
+    pthread_mutex_unlock(&transfers_mutex);
+    
+    // La structure est sur la pile de l'appelant : attendre un rappel en cours
+    timer_cancel_sync(&deadline->timer);
+}
+
+void abort_transfers(void) {
+    pthread_mutex_lock(&transfers_mutex);
+    for (TransferDeadline *d = transfers; d; d = d->next) {
+        shutdown(d->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&transfers_mutex);
+}
+
 // Fonction pour gérer le transfert de fichiers via TCP
 void *file_transfer_thread(void *arg) {
     (void)arg; // Pour éviter l'avertissement de paramètre non utilisé
@@ -374,6 +808,9 @@ void *file_transfer_thread(void *arg) {
     
     printf("Serveur de fichiers TCP démarré sur le port %d\n", FILE_TRANSFER_PORT);
     
+    // Nettoyer les uploads interrompus lors d'une exécution précédente
+    sweep_partial_uploads();
+    
     // Configuration du mode non-bloquant
     fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) | O_NONBLOCK);
     
@@ -424,113 +861,129 @@ void *file_transfer_thread(void *arg) {
             
             printf("Nouvelle connexion de fichier depuis %s:%d\n", 
                    inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+            uint64_t upload_start = metrics_now_ns();
             
-            // Configurer un timeout pour cette socket client aussi
-            if (setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-                perror("Erreur lors de la configuration du timeout client");
-                // Non fatal, continuer
-            }
+            // Le client doit envoyer quelque chose avant chaque échéance
+            TransferDeadline deadline;
+            transfer_begin(&deadline, client_socket, TRANSFER_IDLE_TIMEOUT_MS);
             
             // Recevoir le nom du fichier
             char filename[256];
             ssize_t bytes_received = recv(client_socket, filename, sizeof(filename), 0);
             
             if (bytes_received <= 0) {
-                perror("Erreur lors de la réception du nom de fichier");
+                if (transfer_timed_out(&deadline)) {
+                    printf("Timeout lors de la réception du nom de fichier\n");
+                } else {
+                    perror("Erreur lors de la réception du nom de fichier");
+                }
+                transfer_end(&deadline);
                 close(client_socket);
                 continue;
             }
             
-            // Créer le répertoire de stockage s'il n'existe pas
-            char upload_dir[256] = "./uploads";
-            mkdir(upload_dir, 0755);
+            filename[sizeof(filename) - 1] = '\0';
             
-            // Générer un nom unique si le fichier existe déjà
-            char unique_filename[256];
-            generate_unique_filename(upload_dir, filename, unique_filename, sizeof(unique_filename));
+            // Ne garder que le nom de base (pas de chemin ni de fichier caché)
+            char *base_name = basename(filename);
+            if (base_name[0] == '.' || base_name[0] == '\0') {
+                fprintf(stderr, "Nom de fichier refusé: %s\n", filename);
+                transfer_end(&deadline);
+                close(client_socket);
+                continue;
+            }
             
-            // Construire le chemin complet du fichier
-            char filepath[512];
-            snprintf(filepath, sizeof(filepath), "%s/%s", upload_dir, unique_filename);
+            // Créer la zone de transit dans le même système de fichiers que les uploads
+            mkdir(UPLOAD_DIR, 0755);
+            mkdir(UPLOAD_PARTIAL_DIR, 0700);
             
-            // Si le nom a été modifié, informer l'utilisateur
-            if (strcmp(filename, unique_filename) != 0) {
-                printf("Le fichier existe déjà. Renommé en %s\n", unique_filename);
+            // Le fichier est écrit dans la zone de transit puis publié d'un bloc
+            char partial_path[512];
+            snprintf(partial_path, sizeof(partial_path), "%s/%.200s.XXXXXX", UPLOAD_PARTIAL_DIR, base_name);
+            int partial_fd = mkstemp(partial_path);
+            if (partial_fd < 0) {
+                perror("Erreur lors de la création du fichier temporaire");
+                transfer_end(&deadline);
+                close(client_socket);
+                continue;
             }
+            // mkstemp crée le fichier en 0600 : garder les droits habituels des uploads
+            fchmod(partial_fd, 0644);
             
             // Envoyer un ACK au client
-            if (send(client_socket, "OK", 3, 0) < 0) {
+            if (send(client_socket, "OK", 3, MSG_NOSIGNAL) < 0) {
                 perror("Erreur lors de l'envoi de l'ACK");
+                close(partial_fd);
+                unlink(partial_path);
+                transfer_end(&deadline);
                 close(client_socket);
                 continue;
             }
             
-            // Ouvrir le fichier pour écriture
-            FILE *file = fopen(filepath, "wb");
+            FILE *file = fdopen(partial_fd, "wb");
             if (file == NULL) {
                 perror("Erreur lors de la création du fichier");
+                close(partial_fd);
+                unlink(partial_path);
+                transfer_end(&deadline);
                 close(client_socket);
                 continue;
             }
             
-            // Recevoir et enregistrer le contenu du fichier avec vérification régulière de running
+            // Recevoir et enregistrer le contenu du fichier. Un client muet est
+            // coupé par l'échéance, l'arrêt du serveur par abort_transfers.
             ssize_t bytes_read;
-            fd_set recv_fds;
-            struct timeval recv_timeout;
+            int complete = 0; // 1 quand le client a fermé proprement la connexion
+            uint64_t digest = CATALOG_DIGEST_INIT;
+            uint64_t upload_bytes = 0;
+            metrics_gauge_add(G_ACTIVE_UPLOADS, 1);
             
             while (running) {
-                // Configurer select pour cette socket
-                FD_ZERO(&recv_fds);
-                FD_SET(client_socket, &recv_fds);
-                recv_timeout.tv_sec = 1; // Vérifier running toutes les secondes
-                recv_timeout.tv_usec = 0;
+                bytes_read = recv(client_socket, buffer, sizeof(buffer), 0);
                 
-                int recv_ready = select(client_socket + 1, &recv_fds, NULL, NULL, &recv_timeout);
-                
-                if (recv_ready < 0) {
-                    if (errno == EINTR) {
-                        // Interruption par un signal
-                        if (!running) break;
-                        continue;
+                if (bytes_read < 0 && errno == EINTR) continue;
+                if (bytes_read <= 0) {
+                    // Une socket fermée par l'échéance ou l'arrêt lit aussi 0 octet
+                    if (transfer_timed_out(&deadline)) {
+                        fprintf(stderr, "Upload abandonné: aucune donnée depuis %d s\n",
+                                TRANSFER_IDLE_TIMEOUT_MS / 1000);
+                    } else if (bytes_read < 0) {
+                        perror("Erreur lors de la réception du fichier");
+                    } else if (running) {
+                        complete = 1;
                     }
-                    perror("Erreur select sur le client");
                     break;
                 }
                 
-                // Timeout - vérifier si on doit continuer
-                if (recv_ready == 0) {
-                    if (!running) break;
-                    continue;
-                }
-                
-                // Données disponibles à lire
-                if (FD_ISSET(client_socket, &recv_fds)) {
-                    bytes_read = recv(client_socket, buffer, sizeof(buffer), 0);
-                    
-                    if (bytes_read <= 0) {
-                        // Fin de fichier ou erreur
-                        if (bytes_read < 0) {
-                            perror("Erreur lors de la réception du fichier");
-                        }
-                        break;
-                    }
-                    
-                    // Écrire les données dans le fichier
-                    if (fwrite(buffer, 1, (size_t)bytes_read, file) != (size_t)bytes_read) {
-                        perror("Erreur lors de l'écriture dans le fichier");
-                        break;
-                    }
+                // Écrire les données dans le fichier
+                if (fwrite(buffer, 1, (size_t)bytes_read, file) != (size_t)bytes_read) {
+                    perror("Erreur lors de l'écriture dans le fichier");
+                    break;
                 }
+                digest = catalog_digest_update(digest, buffer, (size_t)bytes_read);
+                upload_bytes += (uint64_t)bytes_read;
+                transfer_progress(&deadline);
             }
+            transfer_end(&deadline);
             
-            // Fermer le fichier
-            fclose(file);
-            
-            if (running) {
-                printf("Fichier reçu et enregistré: %s\n", filepath);
+            // Publier le fichier seulement s'il est complet
+            char final_name[256];
+            if (complete && commit_upload(file, partial_path, base_name, digest,
+                                          final_name, sizeof(final_name)) == 0) {
+                if (strcmp(base_name, final_name) != 0) {
+                    printf("Le fichier existe déjà. Renommé en %s\n", final_name);
+                }
+                printf("Fichier reçu et enregistré: %s/%s\n", UPLOAD_DIR, final_name);
+                metrics_inc(M_UPLOADS_COMPLETED);
+                metrics_add(M_UPLOAD_BYTES, upload_bytes);
+                metrics_record(H_UPLOAD, metrics_now_ns() - upload_start);
             } else {
-                printf("Réception du fichier interrompue: %s\n", filepath);
+                fclose(file);
+                unlink(partial_path);
+                metrics_inc(M_UPLOADS_FAILED);
+                printf("Réception du fichier interrompue: %s\n", base_name);
             }
+            metrics_gauge_add(G_ACTIVE_UPLOADS, -1);
             
             // Fermer la socket client
             close(client_socket);
@@ -558,7 +1011,7 @@ int send_file_to_client(const char *filename, struct sockaddr_in *client_addr) {
     
     // Correct the path to point to bin/uploads
     char filepath[512];
-    snprintf(filepath, sizeof(filepath), "./uploads/%s", filename);
+    snprintf(filepath, sizeof(filepath), "%s/%s", UPLOAD_DIR, filename);
     
     // Log the file path we're trying to open
     printf("send_file_to_client: trying to open file: %s\n", filepath);
@@ -588,15 +1041,6 @@ int send_file_to_client(const char *filename, struct sockaddr_in *client_addr) {
         return -1;
     }
     
-    // Configurer un timeout sur la socket
-    struct timeval tv;
-    tv.tv_sec = 5;  // 5 secondes timeout
-    tv.tv_usec = 0;
-    if (setsockopt(tcp_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-        perror("Erreur lors de la configuration du timeout");
-        // Non fatal, continuer
-    }
-    
     // Configurer l'adresse du serveur avec un port éphémère (0)
     // au lieu d'essayer de réutiliser FILE_TRANSFER_PORT
     memset(&server_addr, 0, sizeof(server_addr));
@@ -640,115 +1084,65 @@ int send_file_to_client(const char *filename, struct sockaddr_in *client_addr) {
              filename, actual_port);
     init_request(&notification, REQ_COMMAND, "Server", "", notification_content);
     
-    if (sendto(global_socket_fd, &notification, sizeof(Request), 0,
-               (struct sockaddr*)client_addr, sizeof(struct sockaddr_in)) < 0) {
+    if (egress_send(&notification, client_addr) < 0) {
         perror("Erreur lors de l'envoi de la notification");
         close(tcp_socket);
         fclose(file);
         return -1;
     }
     
-    // Configurer le mode non-bloquant pour la socket
-    fcntl(tcp_socket, F_SETFL, fcntl(tcp_socket, F_GETFL, 0) | O_NONBLOCK);
-    
-    // Attendre la connexion du client avec un délai limité
-    int client_socket = -1;
-    time_t start_time = time(NULL);
-    const int max_wait_time = 30; // 30 secondes max pour que le client se connecte
-    
-    while ((time(NULL) - start_time < max_wait_time) && running) {
-        // Vérifier si une connexion est disponible
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        FD_SET(tcp_socket, &read_fds);
-        
-        struct timeval select_timeout;
-        select_timeout.tv_sec = 1;  // Vérifier périodiquement si le serveur doit s'arrêter
-        select_timeout.tv_usec = 0;
-        
-        int ready = select(tcp_socket + 1, &read_fds, NULL, NULL, &select_timeout);
-        
-        if (ready < 0) {
-            if (errno == EINTR) {
-                // Interruption par un signal
-                if (!running) break;
-                continue;
-            }
-            perror("Erreur lors de select");
-            close(tcp_socket);
-            fclose(file);
-            return -1;
-        }
-        
-        // Aucune connexion disponible, continuer d'attendre
-        if (ready == 0) {
-            if (!running) break;
-            continue;
-        }
-        
-        // Une connexion est disponible
+    // Attendre la connexion du client : l'échéance ferme la socket d'écoute
+    TransferDeadline deadline;
+    transfer_begin(&deadline, tcp_socket, TRANSFER_ACCEPT_TIMEOUT_MS);
+    int client_socket;
+    do {
         client_socket = accept(tcp_socket, (struct sockaddr*)client_addr, &server_len);
-        if (client_socket < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Aucune connexion disponible, continuer d'attendre
-                continue;
-            }
-            perror("Erreur lors de l'acceptation de la connexion");
-            close(tcp_socket);
-            fclose(file);
-            return -1;
-        }
-        
-        // Connexion établie, sortir de la boucle
-        break;
-    }
+    } while (client_socket < 0 && errno == EINTR && running);
+    transfer_end(&deadline);
     
     // Vérifier si la connexion a été établie
     if (client_socket < 0 || !running) {
+        if (client_socket >= 0) close(client_socket);
         close(tcp_socket);
         fclose(file);
         if (!running) {
             printf("Envoi du fichier annulé: arrêt du serveur\n");
-        } else {
+        } else if (transfer_timed_out(&deadline)) {
             printf("Timeout lors de l'attente de la connexion du client\n");
+        } else {
+            perror("Erreur lors de l'acceptation de la connexion");
         }
         return -1;
     }
     
+    // Le client doit accepter le transfert avant l'échéance
+    transfer_begin(&deadline, client_socket, TRANSFER_ACK_TIMEOUT_MS);
+    
     // Envoyer le nom du fichier
-    if (send(client_socket, filename, strlen(filename) + 1, 0) < 0) {
+    if (send(client_socket, filename, strlen(filename) + 1, MSG_NOSIGNAL) < 0) {
         perror("Erreur lors de l'envoi du nom de fichier");
+        transfer_end(&deadline);
         close(client_socket);
         close(tcp_socket);
         fclose(file);
         return -1;
     }
     
-    // Attendre l'ACK du client avec un timeout
+    // Attendre l'ACK du client
     char ack_buffer[10] = {0};
-    fd_set ack_fds;
-    FD_ZERO(&ack_fds);
-    FD_SET(client_socket, &ack_fds);
-    
-    struct timeval ack_timeout;
-    ack_timeout.tv_sec = 5;  // 5 secondes pour recevoir l'ACK
-    ack_timeout.tv_usec = 0;
-    
-    if (select(client_socket + 1, &ack_fds, NULL, NULL, &ack_timeout) <= 0 || !running) {
-        perror("Timeout lors de l'attente de l'ACK");
-        close(client_socket);
-        close(tcp_socket);
-        fclose(file);
-        return -1;
-    }
-    
-    if (recv(client_socket, ack_buffer, sizeof(ack_buffer), 0) <= 0) {
-        perror("Erreur lors de la réception de l'ACK");
+    if (recv(client_socket, ack_buffer, sizeof(ack_buffer), 0) <= 0 || !running) {
+        if (transfer_timed_out(&deadline)) {
+            fprintf(stderr, "Timeout lors de l'attente de l'ACK\n");
+        } else {
+            perror("Erreur lors de la réception de l'ACK");
+        }
+        transfer_end(&deadline);
         close(client_socket);
         close(tcp_socket);
         fclose(file);
         return -1;
     }
+    transfer_end(&deadline);
     
     if (strcmp(ack_buffer, "OK") != 0) {
         fprintf(stderr, "Le client a refusé le transfert de fichier\n");
@@ -758,44 +1152,26 @@ int send_file_to_client(const char *filename, struct sockaddr_in *client_addr) {
         return -1;
     }
     
-    // Envoyer le contenu du fichier avec vérification périodique de running
+    // Envoyer le contenu du fichier ; un client qui ne lit plus est coupé par l'échéance
+    transfer_begin(&deadline, client_socket, TRANSFER_IDLE_TIMEOUT_MS);
     while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0 && running) {
-        fd_set write_fds;
-        FD_ZERO(&write_fds);
-        FD_SET(client_socket, &write_fds);
-        
-        struct timeval write_timeout;
-        write_timeout.tv_sec = 1;  // Vérifier running toutes les secondes
-        write_timeout.tv_usec = 0;
-        
-        // Attendre que la socket soit prête pour écrire
-        int write_ready = select(client_socket + 1, NULL, &write_fds, NULL, &write_timeout);
-        
-        if (write_ready < 0) {
-            if (errno == EINTR) {
-                // Interruption par un signal
-                if (!running) break;
-                continue;
+        if (send(client_socket, buffer, bytes_read, MSG_NOSIGNAL) < 0) {
+            if (transfer_timed_out(&deadline)) {
+                fprintf(stderr, "Download abandonné: le client ne lit plus depuis %d s\n",
+                        TRANSFER_IDLE_TIMEOUT_MS / 1000);
+            } else {
+                perror("Erreur lors de l'envoi du fichier");
             }
-            perror("Erreur select lors de l'envoi");
-            break;
-        }
-        
-        // Timeout - vérifier si on doit continuer
-        if (write_ready == 0) {
-            if (!running) break;
-            continue;
-        }
-        
-        // Socket prête pour écrire
-        if (send(client_socket, buffer, bytes_read, 0) < 0) {
-            perror("Erreur lors de l'envoi du fichier");
+            transfer_end(&deadline);
             close(client_socket);
             close(tcp_socket);
             fclose(file);
             return -1;
         }
+        metrics_add(M_DOWNLOAD_BYTES, bytes_read);
+        transfer_progress(&deadline);
     }
+    transfer_end(&deadline);
     
     if (running) {
         printf("Fichier envoyé avec succès à %s.\n", inet_ntoa(client_addr->sin_addr));
@@ -818,10 +1194,19 @@ void *file_send_thread_func(void *arg) {
     printf("Démarrage du thread d'envoi de fichier pour %s\n", args->filename);
     
     // Envoyer le fichier
+    uint64_t start = metrics_now_ns();
+    metrics_gauge_add(G_ACTIVE_DOWNLOADS, 1);
     int result = send_file_to_client(args->filename, &args->client_addr);
+    metrics_gauge_add(G_ACTIVE_DOWNLOADS, -1);
     
     // Stocker le résultat
     args->success = (result == 0);
+    if (args->success) {
+        metrics_inc(M_DOWNLOADS_COMPLETED);
+        metrics_record(H_DOWNLOAD, metrics_now_ns() - start);
+    } else {
+        metrics_inc(M_DOWNLOADS_FAILED);
+    }
     if (!args->success) {
         strncpy(args->message, "Échec de l'envoi du fichier", sizeof(args->message) - 1);
         args->message[sizeof(args->message) - 1] = '\0';
@@ -849,11 +1234,11 @@ void *file_send_thread_func(void *arg) {
         send_response(server, &notification, &args->client_addr);
     } else {
         // Fallback si le serveur n'est pas accessible via pthread_getspecific
-        sendto(global_socket_fd, &notification, sizeof(Request), 0,
-               (struct sockaddr*)&args->client_addr, sizeof(struct sockaddr_in));
+        egress_send(&notification, &args->client_addr);
     }
     
-    return args;
+    slab_free(args, sizeof(FileTransferArgs));
+    return NULL;
 }
 
 // Clé pour stocker le pointeur serveur dans les threads
@@ -866,48 +1251,55 @@ void process_request(Server *server, Request *req, struct sockaddr_in *client_ad
     
     Request response;
     
+    // Couche de fiabilité : toute requête d'un client fiable porte son acquittement
+    if (req->flags & REQ_FLAG_RELIABLE) {
+        if (req->type == REQ_CONNECT) {
+            reliable_open(client_addr);
+        } else {
+            reliable_on_ack(client_addr, req->ack, req->sack);
+        }
+    }
+    if (req->type == REQ_HEARTBEAT) {
+        touch_client(server, req->sender, client_addr);
+        return;
+    }
+    if (req->type == REQ_ACK) {
+        // Réponse à une sonde de présence
+        if (strcmp(req->content, "keepalive") == 0) {
+            touch_client(server, req->sender, client_addr);
+        }
+        return;
+    }
+    
     // Pour les messages normaux ou les commandes, vérifier si l'utilisateur est muet
+    // (la fin du mode muet est traitée par son minuteur)
     if (req->type == REQ_MESSAGE || req->type == REQ_COMMAND) {
-        pthread_mutex_lock(&server->clients_mutex);
+        lock_clients(server);
         int client_idx = find_client_by_username(server, req->sender);
+        if (client_idx >= 0) {
+            server->client_hot[client_idx].last_seen = time(NULL);
+        }
         
         if (client_idx >= 0 && server->clients[client_idx].is_muted) {
-            // Vérifier si la période de mute est terminée
-            time_t now = time(NULL);
-            if (now < server->clients[client_idx].mute_until) {
-                // Calculer le temps restant
-                int minutes_left = (int)((server->clients[client_idx].mute_until - now) / 60) + 1;
-                
-                pthread_mutex_unlock(&server->clients_mutex);
-                
-                // Si ce n'est pas une commande @help ou @credits (qu'on autorise même en mode muet)
-                if (req->type != REQ_COMMAND || 
-                    (strncmp(req->content, "@help", 5) != 0 && 
-                     strncmp(req->content, "@credits", 8) != 0 &&
-                     strncmp(req->content, "@disconnect", 11) != 0)) {
-                    // Informer l'utilisateur qu'il est muet
-                    char mute_msg[128];
-                    snprintf(mute_msg, sizeof(mute_msg), 
-                             "Vous êtes actuellement en mode muet. Vous pourrez parler à nouveau dans %d minute(s).", 
-                             minutes_left);
-                    init_request(&response, REQ_MESSAGE, "Server", "", mute_msg);
-                    send_response(server, &response, client_addr);
-                    return;
-                }
-            } else {
-                // La période de mute est terminée, réactiver l'utilisateur
-                server->clients[client_idx].is_muted = false;
-                server->clients[client_idx].mute_until = 0;
-                
-                // Notifier l'utilisateur
-                pthread_mutex_unlock(&server->clients_mutex);
-                
-                char notify[128];
-                snprintf(notify, sizeof(notify), "Votre mode muet est terminé. Vous pouvez à nouveau parler.");
-                init_request(&response, REQ_MESSAGE, "Server", "", notify);
+            // Calculer le temps restant
+            int minutes_left = (int)((server->clients[client_idx].mute_until - time(NULL)) / 60) + 1;
+            if (minutes_left < 1) minutes_left = 1;
+            
+            pthread_mutex_unlock(&server->clients_mutex);
+            
+            // Si ce n'est pas une commande @help ou @credits (qu'on autorise même en mode muet)
+            if (req->type != REQ_COMMAND || 
+                (strncmp(req->content, "@help", 5) != 0 && 
+                 strncmp(req->content, "@credits", 8) != 0 &&
+                 strncmp(req->content, "@disconnect", 11) != 0)) {
+                // Informer l'utilisateur qu'il est muet
+                char mute_msg[128];
+                snprintf(mute_msg, sizeof(mute_msg), 
+                         "Vous êtes actuellement en mode muet. Vous pourrez parler à nouveau dans %d minute(s).", 
+                         minutes_left);
+                init_request(&response, REQ_MESSAGE, "Server", "", mute_msg);
                 send_response(server, &response, client_addr);
-                
-                // Continuer le traitement normal du message
+                return;
             }
         } else {
             pthread_mutex_unlock(&server->clients_mutex);
@@ -962,17 +1354,17 @@ void process_request(Server *server, Request *req, struct sockaddr_in *client_ad
                                      "Connexion réussie");
                         send_response(server, &response, client_addr);
                         
-                        // Annoncer la connexion aux autres clients
-                        char announce[100];
-                        sprintf(announce, "%s a rejoint le chat", username);
-                        init_request(&response, REQ_MESSAGE, "Server", "", announce);
-                        
-                        pthread_mutex_lock(&server->clients_mutex);
-                        for (int i = 0; i < server->client_count; i++) {
-                            if (i != result && server->clients[i].connected) {
-                                send_response(server, &response, &server->clients[i].addr);
-                            }
+                        // Délivrer les messages privés reçus hors ligne (après la
+                        // confirmation, que le client attend en premier)
+                        OfflineTarget target = { server, client_addr };
+                        int delivered = offline_flush(username, deliver_offline, &target);
+                        if (delivered > 0) {
+                            printf("%d message(s) hors ligne délivré(s) à %s\n", delivered, username);
                         }
+                        
+                        // Annoncer la connexion, regroupée avec les autres arrivées
+                        lock_clients(server);
+                        presence_event(server, result, 1, 0);
                         pthread_mutex_unlock(&server->clients_mutex);
                     }
                     break;
@@ -984,8 +1376,11 @@ void process_request(Server *server, Request *req, struct sockaddr_in *client_ad
             // Marquer le client comme déconnecté
             int client_idx = find_client_by_username(server, req->sender);
             if (client_idx >= 0) {
-                pthread_mutex_lock(&server->clients_mutex);
-                server->clients[client_idx].connected = false;
+                lock_clients(server);
+                server->client_hot[client_idx].connected = false;
+                touch_clients(server);
+                ratelimit_bind(req->sender, NULL);
+                presence_event(server, client_idx, 0, 0);  // Annonce regroupée
                 pthread_mutex_unlock(&server->clients_mutex);
             }
             
@@ -994,32 +1389,37 @@ void process_request(Server *server, Request *req, struct sockaddr_in *client_ad
             // Envoyer un ACK de déconnexion au client
             init_request(&response, REQ_MESSAGE, "Server", req->sender, "Déconnexion confirmée");
             send_response(server, &response, client_addr);
-            
-            // Annoncer la déconnexion aux autres clients
-            char announce[100];
-            sprintf(announce, "%s a quitté le chat", req->sender);
-            init_request(&response, REQ_MESSAGE, "Server", "", announce);
-            
-            pthread_mutex_lock(&server->clients_mutex);
-            for (int i = 0; i < server->client_count; i++) {
-                if (server->clients[i].connected && 
-                    strcmp(server->clients[i].username, req->sender) != 0) {
-                    send_response(server, &response, &server->clients[i].addr);
-                }
-            }
-            pthread_mutex_unlock(&server->clients_mutex);
+            reliable_close(client_addr);
             break;
         }
         
         case REQ_MESSAGE: {
+            // Message étiqueté : le salon indiqué, refusé s'il n'est pas suivi par
+            // l'expéditeur. Sans étiquette : son salon courant.
             int idx = find_client_by_username(server, req->sender);
-            if (idx >= 0 && strlen(server->clients[idx].salon_courant) > 0) {
-                const char *salon = server->clients[idx].salon_courant;
+            char salon[MAX_NOM_SALON] = "";
+            if (idx >= 0 && req->recipient[0]) {
+                lock_salons(server);
+                int rid = find_room(server, req->recipient);
+                if (rid >= 0 && room_has_member(&server->salons[rid], server->client_hot[idx].id)) {
+                    snprintf(salon, sizeof(salon), "%s", server->salons[rid].nom);
+                }
+                pthread_mutex_unlock(&server->salons_mutex);
+            } else if (idx >= 0) {
+                lock_clients(server);
+                snprintf(salon, sizeof(salon), "%s", server->clients[idx].salon_courant);
+                pthread_mutex_unlock(&server->clients_mutex);
+            }
+            
+            if (salon[0]) {
                 printf("[%s] %s: %s\n", salon, req->sender, req->content);
                 broadcast_room(server, salon, req, req->sender);
+                search_index_message(salon, req->sender, req->content);
             } else {
                 init_request(&response, REQ_MESSAGE, "Server", req->sender,
-                            "Vous devez rejoindre un salon avant d'envoyer un message.");
+                            req->recipient[0] && idx >= 0
+                                ? "Vous ne suivez pas ce salon : rejoignez-le avec @join."
+                                : "Vous devez rejoindre un salon avant d'envoyer un message.");
                 send_response(server, &response, client_addr);
             }
             break;
@@ -1045,6 +1445,38 @@ void process_request(Server *server, Request *req, struct sockaddr_in *client_ad
     }
 }
 
+// Applique le verdict de la limitation de débit. Retourne 0 si la requête est ignorée.
+static int admit_request(Server *server, Request *req, struct sockaddr_in *client_addr) {
+    Request response;
+    
+    switch (ratelimit_check(req, client_addr)) {
+        case RL_ALLOW:
+            return 1;
+        case RL_DROP:
+            return 0;
+        case RL_WARN:
+            init_request(&response, REQ_MESSAGE, "Server", "", 
+                         "Trop de requêtes : ralentissez, les suivantes sont ignorées");
+            send_response(server, &response, client_addr);
+            return 0;
+        case RL_MUTE:
+            // Refus répétés : mute si le pseudonyme correspond bien à cette adresse
+            if (apply_mute(server, req->sender, RATELIMIT_MUTE_MINUTES, client_addr, NULL) == 0) {
+                metrics_inc(M_RATELIMIT_MUTES);
+                printf("Utilisateur %s rendu muet automatiquement (débit excessif)\n", req->sender);
+                
+                char notify[128];
+                snprintf(notify, sizeof(notify), 
+                         "Vous avez été rendu muet pendant %d minutes (trop de requêtes)", 
+                         RATELIMIT_MUTE_MINUTES);
+                init_request(&response, REQ_MESSAGE, "Server", "", notify);
+                send_response(server, &response, client_addr);
+            }
+            return 0;
+    }
+    return 1;
+}
+
 void *receive_messages_thread(void *arg) {
     Server *server = (Server *)arg;
     Request req;
@@ -1069,12 +1501,28 @@ void *receive_messages_thread(void *arg) {
             }
             
             // Sinon, c'est une vraie erreur
+            metrics_inc(M_RECV_ERRORS);
             perror("Erreur lors de la réception de la requête");
             continue;
         }
         
+        metrics_inc(M_REQUESTS_RECEIVED);
+        metrics_add(M_BYTES_RECEIVED, (uint64_t)received);
+        
+        // Champs terminés : la suite lit req.content sur place (get_command_args)
+        req.sender[sizeof(req.sender) - 1] = '\0';
+        req.recipient[sizeof(req.recipient) - 1] = '\0';
+        req.content[sizeof(req.content) - 1] = '\0';
+        
+        // Limitation de débit avant tout verrou
+        if (!admit_request(server, &req, &client_addr)) {
+            continue;
+        }
+        
         // Traiter la requête
+        uint64_t start = metrics_now_ns();
         process_request(server, &req, &client_addr);
+        metrics_record(H_PROCESS_REQUEST, metrics_now_ns() - start);
     }
     
     printf("Thread de réception du serveur terminé.\n");
@@ -1091,8 +1539,45 @@ int find_room(Server *server, const char *name) {
     return -1;
 }
 
+int init_room_members(Salon *room) {
+    room->nb_membres = 0;
+    room->membres_capacity = (int)(slab_usable_size(sizeof(NameId) * 16) / sizeof(NameId));
+    room->membres = slab_alloc(sizeof(NameId) * (size_t)room->membres_capacity);
+    if (!room->membres) {
+        perror("Échec allocation membres du salon");
+        return -1;
+    }
+    return 0;
+}
+
+// Passe à la classe de taille suivante (au moins le double au-delà des classes)
+int grow_room_members(Salon *room, int min_capacity) {
+    int capacity = room->membres_capacity;
+    while (capacity < min_capacity) {
+        int next = (int)(slab_usable_size(sizeof(NameId) * (size_t)(capacity + 1)) / sizeof(NameId));
+        capacity = next > capacity + 1 ? next : capacity * 2;
+    }
+    NameId *membres = slab_alloc(sizeof(NameId) * (size_t)capacity);
+    if (!membres) {
+        perror("Échec allocation membres du salon");
+        return -1;
+    }
+    memcpy(membres, room->membres, sizeof(NameId) * (size_t)room->nb_membres);
+    slab_free(room->membres, sizeof(NameId) * (size_t)room->membres_capacity);
+    room->membres = membres;
+    room->membres_capacity = capacity;
+    return 0;
+}
+
+void free_room_members(Salon *room) {
+    slab_free(room->membres, sizeof(NameId) * (size_t)room->membres_capacity);
+    room->membres = NULL;
+    room->membres_capacity = 0;
+    room->nb_membres = 0;
+}
+
 int create_room(Server *server, const char *name, const char *creator) {
-    pthread_mutex_lock(&server->salons_mutex);
+    lock_salons(server);
     if (find_room(server, name) >= 0) {
         pthread_mutex_unlock(&server->salons_mutex);
         return -1; // Salon déjà existant
@@ -1111,138 +1596,108 @@ int create_room(Server *server, const char *name, const char *creator) {
         server->salon_capacity = new_capacity;
     }    Salon *room = &server->salons[server->nb_salons++];
     strncpy(room->nom, name, MAX_NOM_SALON - 1);
-    strncpy(room->createur, creator, 49);
-    room->createur[49] = '\0'; // Assurer que le nom du créateur est terminé par un null
+    room->createur = intern_name(creator);
     room->nb_membres = 0;
     
-    // Initialisation du tableau de membres dynamique
-    room->membres_capacity = 10; // Capacité initiale
-    room->membres = malloc(sizeof(char*) * room->membres_capacity);
-    if (!room->membres) {
-        perror("Échec malloc membres du salon");
+    if (init_room_members(room) < 0) {
         server->nb_salons--; // Annuler la création du salon
         pthread_mutex_unlock(&server->salons_mutex);
         return -1;
     }
-    
-    // Initialisation de chaque pointeur de membre
-    for (int i = 0; i < room->membres_capacity; i++) {
-        room->membres[i] = NULL;
-    }
+    touch_salons(server);
     
     pthread_mutex_unlock(&server->salons_mutex);
     return 0;
 }
 
+// Position de id dans les membres triés, ou celle où l'insérer
+static int member_position(const Salon *room, NameId id) {
+    int lo = 0, hi = room->nb_membres;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (room->membres[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool room_has_member(const Salon *room, NameId id) {
+    int pos = member_position(room, id);
+    return pos < room->nb_membres && room->membres[pos] == id;
+}
+
+int add_room_member(Salon *room, NameId id) {
+    int pos = member_position(room, id);
+    if (pos < room->nb_membres && room->membres[pos] == id) return 0;
+
+    if (room->nb_membres >= room->membres_capacity &&
+        grow_room_members(room, room->nb_membres + 1) < 0) {
+        return -1;
+    }
+    memmove(&room->membres[pos + 1], &room->membres[pos],
+            sizeof(NameId) * (size_t)(room->nb_membres - pos));
+    room->membres[pos] = id;
+    room->nb_membres++;
+    return 1;
+}
+
+int remove_room_member(Salon *room, NameId id) {
+    int pos = member_position(room, id);
+    if (pos >= room->nb_membres || room->membres[pos] != id) return 0;
+
+    memmove(&room->membres[pos], &room->membres[pos + 1],
+            sizeof(NameId) * (size_t)(room->nb_membres - pos - 1));
+    room->nb_membres--;
+    return 1;
+}
+
 int join_room(Server *server, const char *username, const char *room_name) {
     int idx = find_client_by_username(server, username);
     if (idx < 0) return -1;
+    NameId id = server->client_hot[idx].id;
 
-    // Vérifier si l'utilisateur est déjà dans ce salon
-    pthread_mutex_lock(&server->clients_mutex);
-    if (strcmp(server->clients[idx].salon_courant, room_name) == 0) {
-        // L'utilisateur est déjà dans ce salon, pas besoin de l'ajouter à nouveau
-        pthread_mutex_unlock(&server->clients_mutex);
-        return 0;
-    }
-    pthread_mutex_unlock(&server->clients_mutex);
-
-    // Retirer l'utilisateur de son salon actuel
-    remove_user(server, username, NULL);
-    
-    pthread_mutex_lock(&server->salons_mutex);
+    lock_salons(server);
     int rid = find_room(server, room_name);
     if (rid < 0) {
         pthread_mutex_unlock(&server->salons_mutex);
         return -1;
     }
-
-    Salon *room = &server->salons[rid];
-    
-    // Vérifier si l'utilisateur est déjà membre de ce salon
-    for (int i = 0; i < room->nb_membres; i++) {
-        if (strcmp(room->membres[i], username) == 0) {
-            // L'utilisateur est déjà membre, mettre à jour salon_courant et retourner
-            pthread_mutex_unlock(&server->salons_mutex);
-            
-            pthread_mutex_lock(&server->clients_mutex);
-            strncpy(server->clients[idx].salon_courant, room_name, MAX_NOM_SALON);
-            pthread_mutex_unlock(&server->clients_mutex);
-            
-            return 0;
-        }
-    }
-    
-    // Vérifier si le tableau des membres doit être redimensionné
-    if (room->nb_membres >= room->membres_capacity) {
-        int new_capacity = room->membres_capacity * 2;
-        char **new_membres = realloc(room->membres, sizeof(char*) * new_capacity);
-        if (!new_membres) {
-            perror("Échec realloc membres du salon");
-            pthread_mutex_unlock(&server->salons_mutex);
-            return -1;
-        }
-        room->membres = new_membres;
-        
-        // Initialiser les nouveaux emplacements
-        for (int i = room->membres_capacity; i < new_capacity; i++) {
-            room->membres[i] = NULL;
-        }
-        room->membres_capacity = new_capacity;
-    }
-    
-    // Allouer de la mémoire pour le nouveau membre
-    room->membres[room->nb_membres] = malloc(50 * sizeof(char)); // 50 caractères max pour un pseudo
-    if (!room->membres[room->nb_membres]) {
-        perror("Échec malloc membre");
-        pthread_mutex_unlock(&server->salons_mutex);
-        return -1;
-    }
     
-    // Copier le pseudo
-    strncpy(room->membres[room->nb_membres++], username, 49);
-    room->membres[room->nb_membres - 1][49] = '\0'; // S'assurer que c'est null-terminé
+    // Les autres salons suivis sont conservés
+    int added = add_room_member(&server->salons[rid], id);
+    if (added > 0) touch_salons(server);
     pthread_mutex_unlock(&server->salons_mutex);
+    if (added < 0) return -1;
 
-    pthread_mutex_lock(&server->clients_mutex);
-    strncpy(server->clients[idx].salon_courant, room_name, MAX_NOM_SALON);
+    lock_clients(server);
+    strncpy(server->clients[idx].salon_courant, room_name, MAX_NOM_SALON - 1);
+    server->clients[idx].salon_courant[MAX_NOM_SALON - 1] = '\0';
     pthread_mutex_unlock(&server->clients_mutex);
 
-    return 0;
+    return added ? 0 : 1;
 }
 
 int remove_user(Server *server, const char *username, const char *room_name) {
     int cid = find_client_by_username(server, username);
     if (cid < 0) return -1;
 
-    const char *room = room_name ? room_name : server->clients[cid].salon_courant;
-    if (!room || strlen(room) == 0) return -1;
+    char room[MAX_NOM_SALON];
+    lock_clients(server);
+    snprintf(room, sizeof(room), "%s", room_name ? room_name : server->clients[cid].salon_courant);
+    pthread_mutex_unlock(&server->clients_mutex);
+    if (room[0] == '\0') return -1;
 
-    pthread_mutex_lock(&server->salons_mutex);
+    lock_salons(server);
     int rid = find_room(server, room);
-    if (rid < 0) {
-        pthread_mutex_unlock(&server->salons_mutex);
-        return -1;
-    }    Salon *s = &server->salons[rid];
-    for (int i = 0; i < s->nb_membres; i++) {
-        if (strcmp(s->membres[i], username) == 0) {
-            // Libérer la mémoire du membre à retirer
-            free(s->membres[i]);
-            
-            // Décalage des pointeurs
-            for (int j = i; j < s->nb_membres - 1; j++)
-                s->membres[j] = s->membres[j + 1];
-            
-            // Initialiser le dernier pointeur à NULL
-            s->membres[s->nb_membres - 1] = NULL;
-            s->nb_membres--;
-            break;
-        }
-    }
+    int removed = rid >= 0 && remove_room_member(&server->salons[rid], server->client_hot[cid].id);
+    if (removed) touch_salons(server);
     pthread_mutex_unlock(&server->salons_mutex);
+    if (!removed) return -1;
 
-    pthread_mutex_lock(&server->clients_mutex);
-    server->clients[cid].salon_courant[0] = '\0';
+    lock_clients(server);
+    if (strcmp(server->clients[cid].salon_courant, room) == 0) {
+        server->clients[cid].salon_courant[0] = '\0';
+    }
     pthread_mutex_unlock(&server->clients_mutex);
 
     return 0;
@@ -1252,17 +1707,34 @@ void broadcast_room(Server *server, const char *room, Request *msg, const char *
     int rid = find_room(server, room);
     if (rid < 0) return;
 
+    uint64_t start = metrics_now_ns();
+    uint64_t fanout = 0, suspect = 0;
+
     Salon *r = &server->salons[rid];
-    pthread_mutex_lock(&server->clients_mutex);
+    NameId sender_id = intern_find(sender);
+    strncpy(msg->recipient, r->nom, sizeof(msg->recipient) - 1);  // Étiquette du salon
+    msg->recipient[sizeof(msg->recipient) - 1] = '\0';
+    lock_clients(server);
+    time_t now = time(NULL);
     for (int i = 0; i < r->nb_membres; i++) {
-        if (strcmp(r->membres[i], sender) != 0) {
-            int cid = find_client_by_username(server, r->membres[i]);
-            if (cid >= 0 && server->clients[cid].connected) {
-                send_response(server, msg, &server->clients[cid].addr);
+        if (r->membres[i] != sender_id) {
+            int cid = find_client_by_id(server, r->membres[i]);
+            if (cid < 0) continue;
+            if (is_client_reachable(server, cid, now)) {
+                send_broadcast(server, msg, &server->client_hot[cid].addr);
+                fanout++;
+            } else {
+                suspect++;
             }
         }
     }
     pthread_mutex_unlock(&server->clients_mutex);
+
+    metrics_inc(M_MESSAGES_BROADCAST);
+    metrics_add(M_FANOUT_SENDS, fanout);
+    if (suspect) metrics_add(M_FANOUT_SKIPPED, suspect);
+    metrics_record(H_FANOUT_SIZE, fanout);
+    metrics_record(H_BROADCAST, metrics_now_ns() - start);
 }
 
 void save_rooms(Server *server, const char *filename) {
@@ -1270,15 +1742,15 @@ void save_rooms(Server *server, const char *filename) {
     if (!f) {
         perror("Erreur ouverture fichier rooms.txt");
         return;
-    }    pthread_mutex_lock(&server->salons_mutex);
+    }    lock_salons(server);
     for (int i = 0; i < server->nb_salons; i++) {
         Salon *s = &server->salons[i];
         if (s->nb_membres == 0) continue; // Ne sauvegarde que les salons avec au moins 1 membre
 
         fprintf(f, "salon: %s\n", s->nom);
-        fprintf(f, "createur: %s\n", s->createur);
+        fprintf(f, "createur: %s\n", intern_str(s->createur));
         for (int j = 0; j < s->nb_membres; j++) {
-            fprintf(f, "membre: %s\n", s->membres[j]);
+            fprintf(f, "membre: %s\n", intern_str(s->membres[j]));
         }
     }
     pthread_mutex_unlock(&server->salons_mutex);
@@ -1293,7 +1765,7 @@ void load_rooms(Server *server, const char *filename) {
     char member_name[50];
     Salon *current = NULL;
 
-    pthread_mutex_lock(&server->salons_mutex);
+    lock_salons(server);
     server->nb_salons = 0;
 
     while (fgets(line, sizeof(line), f)) {        if (strncmp(line, "salon: ", 7) == 0) {
@@ -1303,55 +1775,22 @@ void load_rooms(Server *server, const char *filename) {
             current->nb_membres = 0;
             
             // Par défaut, le créateur est "admin" si non spécifié
-            strcpy(current->createur, "admin");
+            current->createur = intern_name("admin");
             
-            // Initialisation du tableau de membres dynamique
-            current->membres_capacity = 10; // Capacité initiale
-            current->membres = malloc(sizeof(char*) * current->membres_capacity);
-            if (!current->membres) {
-                perror("Échec malloc membres du salon");
+            if (init_room_members(current) < 0) {
                 server->nb_salons--; // Annuler la création du salon
                 continue;
             }
-            
-            // Initialisation de chaque pointeur de membre
-            for (int i = 0; i < current->membres_capacity; i++) {
-                current->membres[i] = NULL;
-            }
         } else if (strncmp(line, "createur: ", 10) == 0 && current) {
             // Charger le créateur du salon
-            sscanf(line + 10, "%49[^\n]", current->createur);
-        } else if (strncmp(line, "membre: ", 8) == 0 && current) {
-            // Vérifier si on doit augmenter la capacité
-            if (current->nb_membres >= current->membres_capacity) {
-                int new_capacity = current->membres_capacity * 2;
-                char **new_membres = realloc(current->membres, sizeof(char*) * new_capacity);
-                if (!new_membres) {
-                    perror("Échec realloc membres");
-                    continue;
-                }
-                current->membres = new_membres;
-                
-                // Initialiser les nouveaux emplacements
-                for (int i = current->membres_capacity; i < new_capacity; i++) {
-                    current->membres[i] = NULL;
-                }
-                current->membres_capacity = new_capacity;
+            if (sscanf(line + 10, "%49[^\n]", member_name) == 1) {
+                current->createur = intern_name(member_name);
             }
-            
-            // Extraire le nom du membre
-            sscanf(line + 8, "%49[^\n]", member_name);
-            
-            // Allouer et copier le nom du membre
-            current->membres[current->nb_membres] = malloc(50 * sizeof(char));
-            if (!current->membres[current->nb_membres]) {
-                perror("Échec malloc membre");
-                continue;
-            }
-            
-            strncpy(current->membres[current->nb_membres], member_name, 49);
-            current->membres[current->nb_membres][49] = '\0';
-            current->nb_membres++;
+        } else if (strncmp(line, "membre: ", 8) == 0 && current) {
+            // Extraire le nom du membre (inséré à sa place dans le tableau trié)
+            if (sscanf(line + 8, "%49[^\n]", member_name) != 1) continue;
+            NameId id = intern_name(member_name);
+            if (id != INTERN_NONE) add_room_member(current, id);
         }
     }
 
@@ -1359,35 +1798,8 @@ void load_rooms(Server *server, const char *filename) {
     fclose(f);
 }
 
-int is_client_still_connected(Server *server, int client_idx) {
-    struct sockaddr_in *addr = &server->clients[client_idx].addr;
-    
-    // Créer un message de vérification
-    Request ping_req;
-    init_request(&ping_req, REQ_MESSAGE, "Server", "", "keepalive");
-    
-    // Tenter d'envoyer un message de vérification
-    ssize_t sent = sendto(server->socket_fd, &ping_req, sizeof(Request), 0,
-                         (struct sockaddr*)addr, sizeof(struct sockaddr_in));
-    
-    return (sent > 0);
-}
-
-// Fonction pour nettoyer les clients déconnectés
-void cleanup_disconnected_clients(Server *server) {
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    for (int i = 0; i < server->client_count; i++) {
-        if (server->clients[i].connected) {
-            // Vous pouvez utiliser cette fonction pour vérifier périodiquement
-            // la connectivité des clients si nécessaire
-        }
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-}
-
-// Fonction principale
+// Fonction principale (exclue quand server.c est lié aux microbenchmarks)
+#ifndef SERVER_NO_MAIN
 int main(void) {
     printf("██████   ██████ ██████████  █████████   █████████    \n░░██████ ██████ ░░███░░░░░█ ███░░░░░███ ███░░░░░███  \n ░███░█████░███  ░███  █ ░ ░███    ░░░ ░███    ░░░   \n ░███░░███ ░███  ░██████   ░░█████████ ░░█████████   \n ░███ ░░░  ░███  ░███░░█    ░░░░░░░░███ ░░░░░░░░███  \n ░███      ░███  ░███ ░   █ ███    ░███ ███    ░███  \n █████     █████ ██████████░░█████████ ░░█████████   \n░░░░░     ░░░░░ ░░░░░░░░░░  ░░░░░░░░░   ░░░░░░░░░    \n                                                     \n                                                     \n                                                     \n ███████████    █████████    █████████  █████   █████\n░░███░░░░░███  ███░░░░░███  ███░░░░░███░░███   ░░███ \n ░███    ░███ ░███    ░███ ░███    ░░░  ░███    ░███ \n ░██████████  ░███████████ ░░█████████  ░███████████ \n ░███░░░░░███ ░███░░░░░███  ░░░░░░░░███ ░███░░░░░███ \n ░███    ░███ ░███    ░███  ███    ░███ ░███    ░███ \n ███████████  █████   █████░░█████████  █████   █████\n░░░░░░░░░░░  ░░░░░   ░░░░░  ░░░░░░░░░  ░░░░░   ░░░░░ \n");                                               
     Server server;
@@ -1400,10 +1812,41 @@ int main(void) {
     // Charger les utilisateurs depuis le fichier
     load_users_from_file(&server);
     
+    // Charger les boîtes de messages hors ligne
+    init_offline_queue();
+    
     printf("Serveur démarré sur le port %d\n", SERVER_PORT);
     printf("Appuyez sur Ctrl+C pour arrêter le serveur.\n");
     
     init_command_system();
+    if (init_preload_watch() < 0) {
+        printf("Suivi de help.txt et credits.txt indisponible: réponses figées au démarrage\n");
+    }
+    
+    // Démarrer l'écriture périodique des métriques
+    init_metrics();
+    
+    // Démarrer les threads d'envoi (les réponses restent synchrones en cas d'échec)
+    if (init_egress(server.socket_fd) < 0) {
+        printf("Envoi asynchrone indisponible: réponses envoyées directement\n");
+    }
+    
+    // Démarrer la roue de temporisation (mode muet, présence, transferts, retransmissions)
+    if (init_timers() < 0) {
+        printf("Minuteurs indisponibles: fin du mode muet et délais de transfert désactivés\n");
+    }
+    start_presence_sweep(&server);
+    init_presence(&server);
+    
+    // Démarrer la retransmission des sessions fiables (clients lancés avec --reliable)
+    if (init_reliable() < 0) {
+        printf("Retransmission indisponible: les sessions fiables ne seront pas renvoyées\n");
+    }
+    
+    // Démarrer l'indexation de l'historique des salons
+    if (init_search_index(HISTORY_FILE) < 0) {
+        printf("Historique indisponible: la commande @search est désactivée\n");
+    }
 
     // Initialiser la clé pour stocker le serveur dans les threads
     if (pthread_key_create(&server_key, NULL) != 0) {
@@ -1411,6 +1854,9 @@ int main(void) {
         return EXIT_FAILURE;
     }
     
+    // Construire le catalogue des fichiers partagés
+    init_file_catalog(UPLOAD_DIR);
+    
     // Créer le thread de transfert de fichiers TCP
     pthread_t file_thread;
     if (pthread_create(&file_thread, NULL, file_transfer_thread, &server) != 0) {
@@ -1420,6 +1866,9 @@ int main(void) {
         return EXIT_FAILURE;
     }
     
+    // Échantillonner la charge pour @stats
+    init_stats(&server);
+    
     // Créer le thread principal de réception
     pthread_t receive_thread;
     
@@ -1432,33 +1881,43 @@ int main(void) {
     
     // Attendre que les threads se terminent (lorsque running devient 0)
     pthread_join(receive_thread, NULL);
+    abort_transfers();
     pthread_join(file_thread, NULL);
     
+    // Terminer l'indexation des messages en attente
+    shutdown_search_index();
+    shutdown_file_catalog();
+    shutdown_preload();
+    shutdown_stats();
+    shutdown_metrics();
+    
     // Envoyer un message de fermeture à tous les clients
     Request shutdown_notice;
     init_request(&shutdown_notice, REQ_MESSAGE, "Server", "", "Le serveur est en train de s'arrêter.");
     
-    pthread_mutex_lock(&server.clients_mutex);
+    lock_clients(&server);
     for (int i = 0; i < server.client_count; i++) {
-        if (server.clients[i].connected) {
-            send_response(&server, &shutdown_notice, &server.clients[i].addr);
+        if (server.client_hot[i].connected) {
+            send_response(&server, &shutdown_notice, &server.client_hot[i].addr);
         }
     }
-    pthread_mutex_unlock(&server.clients_mutex);    // Sauvegarder les salons avant de quitter
+    pthread_mutex_unlock(&server.clients_mutex);
+    
+    // Arrêter les minuteurs et les retransmissions puis vider les files d'envoi avant
+    // la fermeture de la socket
+    shutdown_timers();
+    shutdown_presence();
+    shutdown_reliable();
+    shutdown_egress();
+    
+    // Sauvegarder les salons avant de quitter
         // Sauvegarde des utilisateurs APRÈS avoir déverrouillé le mutex
         save_users_to_file(&server);
     save_rooms(&server, "rooms.txt");
     
     // Libérer la mémoire de tous les membres des salons
     for (int i = 0; i < server.nb_salons; i++) {
-        Salon *s = &server.salons[i];
-        for (int j = 0; j < s->nb_membres; j++) {
-            if (s->membres[j]) {
-                free(s->membres[j]);
-                s->membres[j] = NULL;
-            }
-        }
-        free(s->membres);
+        free_room_members(&server.salons[i]);
     }
     
     // Libérer le tableau de salons
@@ -1466,21 +1925,25 @@ int main(void) {
     
     // Libérer le tableau de clients
     free(server.clients);
+    free(server.client_hot);
+    free(server.client_by_id);
     
     // Nettoyage - fermer la socket seulement après avoir envoyé tous les messages
     close(server.socket_fd);
     global_socket_fd = -1; // Réinitialisation pour éviter une double fermeture
     pthread_mutex_destroy(&server.clients_mutex);
     pthread_mutex_destroy(&server.salons_mutex);
+    free_listing_caches(&server);
     pthread_key_delete(server_key);
     
     printf("Serveur arrêté proprement.\n");
     
     return EXIT_SUCCESS;
 }
+#endif /* SERVER_NO_MAIN */
 
 int delete_room(Server *server, const char *name, const char *username) {
-    pthread_mutex_lock(&server->salons_mutex);
+    lock_salons(server);
     
     // Trouver le salon
     int rid = find_room(server, name);
@@ -1490,42 +1953,33 @@ int delete_room(Server *server, const char *name, const char *username) {
     }
     
     // Vérifier si l'utilisateur est le créateur du salon
-    if (strcmp(server->salons[rid].createur, username) != 0) {
+    if (server->salons[rid].createur != intern_find(username)) {
         pthread_mutex_unlock(&server->salons_mutex);
         return -2; // Pas le créateur du salon
     }
     
-    Salon *salon = &server->salons[rid];
-    
-    // Informer tous les membres que le salon est supprimé
-    pthread_mutex_lock(&server->clients_mutex);
-    for (int i = 0; i < salon->nb_membres; i++) {
-        int cid = find_client_by_username(server, salon->membres[i]);
-        if (cid >= 0 && server->clients[cid].connected) {
-            // Effacer le nom du salon courant
-            if (strcmp(server->clients[cid].salon_courant, name) == 0) {
-                server->clients[cid].salon_courant[0] = '\0';
-            }
-        }
-    }
-    pthread_mutex_unlock(&server->clients_mutex);
-    
-    // Libérer la mémoire des membres
-    for (int i = 0; i < salon->nb_membres; i++) {
-        if (salon->membres[i]) {
-            free(salon->membres[i]);
-        }
-    }
-    free(salon->membres);
-    
-    // Supprimer le salon en décalant tous les salons suivants
+    // Retirer le salon de la table en gardant ses membres : leur salon courant
+    // est effacé après avoir rendu salons_mutex (ordre clients puis salons)
+    Salon removed = server->salons[rid];
     for (int i = rid; i < server->nb_salons - 1; i++) {
         server->salons[i] = server->salons[i + 1];
     }
     server->nb_salons--;
+    touch_salons(server);
     
     pthread_mutex_unlock(&server->salons_mutex);
     
+    lock_clients(server);
+    for (int i = 0; i < removed.nb_membres; i++) {
+        int cid = find_client_by_id(server, removed.membres[i]);
+        if (cid >= 0 && strcmp(server->clients[cid].salon_courant, removed.nom) == 0) {
+            server->clients[cid].salon_courant[0] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+    
+    free_room_members(&removed);
+    
     // Enregistrer les modifications dans le fichier
     save_rooms(server, "rooms.txt");
     
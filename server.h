@@ -3,13 +3,33 @@
 
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "common.h"
+#include "intern.h"
+#include "metrics.h"
 
-#define MAX_CLIENTS 100
+#ifndef MAX_CLIENTS
+#define MAX_CLIENTS 100  // Modifiable à la compilation (-DMAX_CLIENTS=...) pour les tests de charge
+#endif
 #define MAX_SALONS 100 
 #define MAX_MEMBRES     32
 #define MAX_NOM_SALON   50
 
+// Dossier des fichiers partagés et zone de transit des uploads en cours
+#define UPLOAD_DIR          "./uploads"
+#define UPLOAD_PARTIAL_DIR  "./uploads/.partial"
+
+// Présence des clients (s), mesurée depuis la dernière requête ou REQ_HEARTBEAT
+#define CLIENT_PING_INTERVAL    (2 * HEARTBEAT_INTERVAL)  // Le client est sondé (@keepalive)
+#define CLIENT_SUSPECT_TIMEOUT  (3 * HEARTBEAT_INTERVAL)  // Exclu des diffusions
+#define CLIENT_IDLE_TIMEOUT     90   // Sans requête ni réponse aux sondes, il est déconnecté
+#define CLIENT_SWEEP_INTERVAL   5    // Période du balayage qui sonde et déconnecte par lots
+
+// Délais des transferts TCP (ms)
+#define TRANSFER_ACCEPT_TIMEOUT_MS  30000  // Connexion du client après @file_ready
+#define TRANSFER_ACK_TIMEOUT_MS     5000   // Accord du client avant l'envoi
+#define TRANSFER_IDLE_TIMEOUT_MS    30000  // Sans progression, le transfert est abandonné
+
 // Enumération pour les rôles d'utilisateur
 typedef enum {
     ROLE_USER,
@@ -17,44 +37,109 @@ typedef enum {
     ROLE_ADMIN
 } UserRole;
 
-//Structure Client 
+// Arrivées et départs annoncés à un client (@presence, voir presence.h)
+typedef enum {
+    PRESENCE_ALL,          // Tous les utilisateurs (par défaut)
+    PRESENCE_ROOM,         // Ceux des membres de ses salons suivis
+    PRESENCE_CONTACTS,     // Ceux de sa liste de contacts
+    PRESENCE_NONE
+} PresenceMode;
+
+#define PRESENCE_CONTACTS_MAX  32
+
+//Structure Client (partie froide : mot de passe, salon, rôle, mode muet, présence).
+// Un client peut suivre plusieurs salons ; salon_courant est celui où partent
+// ses messages sans étiquette de salon.
 typedef struct {
-    char username[50];
     char password[50];
-    struct sockaddr_in addr;
-    bool connected;
     char salon_courant[MAX_NOM_SALON]; // "" si aucun
     UserRole role;
     bool is_muted;         // Indique si l'utilisateur est muet
     time_t mute_until;     // Heure jusqu'à laquelle l'utilisateur est muet
+    PresenceMode presence_mode;
+    int nb_contacts;
+    NameId contacts[PRESENCE_CONTACTS_MAX];  // Non sauvegardés : vides au redémarrage
 } ClientInfo;
 
+// Partie chaude d'un client, au même indice que ClientInfo : seule lue par les
+// diffusions et la recherche par pseudonyme. 32 octets, deux par ligne de cache.
+typedef struct {
+    struct sockaddr_in addr;
+    time_t last_seen;      // Dernière requête reçue du client
+    NameId id;             // Pseudonyme (intern_str pour la chaîne)
+    bool connected;
+} ClientHot;
+
 //Structure Salon
 typedef struct {
     char nom[MAX_NOM_SALON];
-    char createur[50];     // pseudo du créateur/admin
-    char **membres;        // tableau dynamique de pseudos
+    NameId createur;       // pseudo du créateur/admin
+    NameId *membres;       // tableau dynamique de pseudos, trié (recherche dichotomique)
     int  nb_membres;       // nombre actuel de membres
     int  membres_capacity; // capacité du tableau membres
 } Salon;
 
+#define LISTING_CACHE_SLOTS  4   // Pages gardées par liste, rangées selon leur curseur
+
+// Page de @list ou @rooms déjà rendue, réutilisée tant que la version de sa
+// table ne change pas. Son verrou sérialise les rendus : des demandes
+// simultanées attendent le premier puis envoient le même texte.
+typedef struct {
+    pthread_mutex_t mutex;
+    unsigned long version;   // Version de la table au moment du rendu
+    int cursor;
+    char *text;              // NULL : emplacement vide
+    size_t len;
+} ListingCache;
+
 //Structure Server
 typedef struct {
     int socket_fd;
     struct sockaddr_in server_addr;
 
     ClientInfo *clients;
+    ClientHot *client_hot;   // Tableau parallèle à clients
+    int *client_by_id;       // NameId -> indice dans clients, -1 si aucun
+    uint32_t client_by_id_capacity;
     int client_capacity;
     int client_count;
+    unsigned long clients_version;  // Incrémentée à chaque changement visible dans @list
+    // Ordre de verrouillage : clients_mutex puis salons_mutex, jamais l'inverse.
+    // Un chemin qui part des salons rend salons_mutex avant lock_clients.
     pthread_mutex_t clients_mutex;
+    ListingCache client_listings[LISTING_CACHE_SLOTS];
 
     Salon *salons;
     int nb_salons;
     int salon_capacity;
+    unsigned long salons_version;   // Incrémentée à chaque changement visible dans @rooms
 
-    pthread_mutex_t salons_mutex;
+    pthread_mutex_t salons_mutex;    // Pris après clients_mutex (voir plus haut)
+    ListingCache salon_listings[LISTING_CACHE_SLOTS];
 } Server;
 
+// Verrouillage des tables avec comptage de la contention (affichée par @stats)
+static inline void lock_clients(Server *server) {
+    metrics_mutex_lock(&server->clients_mutex, M_CLIENTS_LOCK_ACQUIRED, M_CLIENTS_LOCK_CONTENDED);
+}
+
+static inline void lock_salons(Server *server) {
+    metrics_mutex_lock(&server->salons_mutex, M_SALONS_LOCK_ACQUIRED, M_SALONS_LOCK_CONTENDED);
+}
+
+// Signale une modification de la table (appelé avec son verrou) : les pages de
+// liste en cache sont rendues de nouveau à la prochaine demande
+static inline void touch_clients(Server *server) {
+    __atomic_add_fetch(&server->clients_version, 1, __ATOMIC_RELEASE);
+}
+
+static inline void touch_salons(Server *server) {
+    __atomic_add_fetch(&server->salons_version, 1, __ATOMIC_RELEASE);
+}
+
+void init_listing_caches(Server *server);
+void free_listing_caches(Server *server);
+
 // Structure étendue pour les arguments du thread d'envoi de fichier
 typedef struct {
     char filename[256];
@@ -72,8 +157,41 @@ void *receive_messages_thread(void *arg);
 
 // Thread de transfert de fichiers
 void *file_transfer_thread(void *arg);
+
+// Publication atomique des uploads
+void sweep_partial_uploads(void);
+int  commit_upload(FILE *file, const char *partial_path, const char *filename,
+                   uint64_t digest, char *final_name, size_t final_size);
 void  process_request(Server *server, Request *req, struct sockaddr_in *client_addr);
 int  send_response(Server *server, Request *res, struct sockaddr_in *client_addr);
+// Envoi abandonnable (-2) si le destinataire ne suit pas : salons et annonces
+int  send_broadcast(Server *server, Request *res, struct sockaddr_in *client_addr);
+
+// Minuteurs par client. Appelés avec clients_mutex verrouillé.
+void schedule_mute_expiry(Server *server, int client_idx);
+void cancel_mute_expiry(int client_idx);
+int  is_client_still_connected(Server *server, int client_idx);
+int  is_client_reachable(Server *server, int client_idx, time_t now);
+
+// Client enregistré sous ce pseudonyme, connecté (-1 sinon), en O(1)
+int  find_client_by_id(Server *server, NameId id);
+// Même recherche, connecté ou non
+int  find_registered_client(Server *server, NameId id);
+
+// Pseudonyme d'un client
+static inline const char *client_name(Server *server, int client_idx) {
+    return intern_str(server->client_hot[client_idx].id);
+}
+
+// Envoie msg à tous les clients joignables sauf except_idx (-1 : aucun).
+// Appelé avec clients_mutex verrouillé.
+void broadcast_all(Server *server, Request *msg, int except_idx);
+
+// Balayage périodique de présence : sondes et déconnexion des clients inactifs
+void start_presence_sweep(Server *server);
+
+// Interrompt les transferts TCP en cours (arrêt du serveur)
+void abort_transfers(void);
 
 // Fonction pour envoyer un fichier à un client
 int send_file_to_client(const char *filename, struct sockaddr_in *client_addr);
@@ -86,11 +204,27 @@ int  add_client(Server *server, const char *username, const char *password,
 void remove_client(Server *server, const char *username);
 
 //Fonctions salon
+int find_room(Server *server, const char *name);
+// Tableaux de membres, pris dans l'allocateur slab (capacité arrondie à sa classe)
+int  init_room_members(Salon *room);
+int  grow_room_members(Salon *room, int min_capacity);
+void free_room_members(Salon *room);
+// Appartenance au salon en O(log n). Appelés avec salons_mutex verrouillé ;
+// add retourne 1 si id est ajouté, 0 s'il était déjà membre, -1 si la mémoire manque.
+bool room_has_member(const Salon *room, NameId id);
+int  add_room_member(Salon *room, NameId id);
+int  remove_room_member(Salon *room, NameId id);
 int create_room(Server *server, const char *name, const char *creator);
 int delete_room(Server *server, const char *name, const char *username);
+// Ajoute l'utilisateur au salon, sans quitter les autres, et en fait son salon
+// courant. Retourne 0 s'il y entre, 1 s'il en était déjà membre, -1 si erreur.
 int join_room(Server *server, const char *username, const char *room_name);
 int add_user(Server *server, const char *user, const char *room);
+// Retire l'utilisateur du salon (room NULL : son salon courant) ; -1 s'il n'en
+// était pas membre. Son salon courant est vidé si c'était celui-ci.
 int remove_user(Server *server, const char *user, const char *room);
+// Diffuse msg aux membres du salon sauf sender, avec le nom du salon pour
+// destinataire (les clients suivent plusieurs salons)
 void broadcast_room(Server *server, const char *room, Request *msg, const char *sender);
 void save_rooms(Server *server, const char *file);
 void load_rooms(Server *server, const char *file);
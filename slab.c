@@ -0,0 +1,172 @@
+// slab.c
+// Allocateur par classes de taille. Chaque classe a une liste d'objets libres
+// protégée par son verrou, alimentée par des pages de SLAB_PAGE_SIZE ; chaque
+// thread garde jusqu'à SLAB_CACHE_SIZE objets par classe et n'échange avec la
+// liste commune que par moitiés de cache.
+#include "slab.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SLAB_CLASS_COUNT  4
+#define SLAB_BATCH        (SLAB_CACHE_SIZE / 2)  // Objets échangés par prise du verrou
+
+static const size_t class_sizes[SLAB_CLASS_COUNT] = { 64, 256, 1024, SLAB_MAX_SIZE };
+
+// Un objet libre contient le lien vers le suivant
+typedef struct SlabObject {
+    struct SlabObject *next;
+} SlabObject;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    SlabObject *free_list;
+} SlabPool;
+
+static SlabPool pools[SLAB_CLASS_COUNT] = {
+    { PTHREAD_MUTEX_INITIALIZER, NULL },
+    { PTHREAD_MUTEX_INITIALIZER, NULL },
+    { PTHREAD_MUTEX_INITIALIZER, NULL },
+    { PTHREAD_MUTEX_INITIALIZER, NULL }
+};
+
+typedef struct {
+    void *objects[SLAB_CLASS_COUNT][SLAB_CACHE_SIZE];
+    int count[SLAB_CLASS_COUNT];
+} SlabCache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static __thread SlabCache *thread_cache = NULL;
+
+static int class_of(size_t size) {
+    for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+        if (size <= class_sizes[c]) return c;
+    }
+    return -1;
+}
+
+// Découpe une nouvelle page dans la liste libre. Appelé avec le verrou de la classe.
+static int grow_pool(int c) {
+    SlabObject *page = aligned_alloc(64, SLAB_PAGE_SIZE);
+    if (!page) {
+        perror("Échec allocation page slab");
+        return -1;
+    }
+    size_t size = class_sizes[c];
+    size_t count = SLAB_PAGE_SIZE / size;
+    char *base = (char *)page;
+    for (size_t i = count; i-- > 0;) {
+        SlabObject *obj = (SlabObject *)(base + i * size);
+        obj->next = pools[c].free_list;
+        pools[c].free_list = obj;
+    }
+    metrics_gauge_add(G_SLAB_PAGES, 1);
+    return 0;
+}
+
+// Prend jusqu'à n objets de la liste commune, retourne le nombre obtenu
+static int pool_get(int c, void **out, int n) {
+    SlabPool *pool = &pools[c];
+    metrics_inc(M_SLAB_REFILLS);
+    pthread_mutex_lock(&pool->mutex);
+    int taken = 0;
+    while (taken < n) {
+        if (!pool->free_list && grow_pool(c) < 0) break;
+        SlabObject *obj = pool->free_list;
+        pool->free_list = obj->next;
+        out[taken++] = obj;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return taken;
+}
+
+static void pool_put(int c, void **objects, int n) {
+    SlabPool *pool = &pools[c];
+    pthread_mutex_lock(&pool->mutex);
+    for (int i = 0; i < n; i++) {
+        SlabObject *obj = objects[i];
+        obj->next = pool->free_list;
+        pool->free_list = obj;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Fin du thread : son cache retourne dans les listes communes
+static void release_cache(void *arg) {
+    SlabCache *cache = arg;
+    for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+        pool_put(c, cache->objects[c], cache->count[c]);
+    }
+    free(cache);
+    thread_cache = NULL;
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, release_cache);
+}
+
+// Cache du thread courant, NULL si la mémoire manque (accès direct aux listes)
+static SlabCache *get_cache(void) {
+    if (thread_cache) return thread_cache;
+
+    pthread_once(&cache_key_once, create_cache_key);
+    SlabCache *cache = calloc(1, sizeof(SlabCache));
+    if (!cache) return NULL;
+    pthread_setspecific(cache_key, cache);
+    thread_cache = cache;
+    return cache;
+}
+
+size_t slab_usable_size(size_t size) {
+    int c = class_of(size);
+    return c < 0 ? size : class_sizes[c];
+}
+
+void *slab_alloc(size_t size) {
+    int c = class_of(size);
+    if (c < 0) {
+        metrics_inc(M_SLAB_LARGE);
+        return malloc(size);
+    }
+
+    void *obj;
+    SlabCache *cache = get_cache();
+    if (!cache) {
+        if (pool_get(c, &obj, 1) != 1) return NULL;
+    } else {
+        if (cache->count[c] == 0) {
+            cache->count[c] = pool_get(c, cache->objects[c], SLAB_BATCH);
+            if (cache->count[c] == 0) return NULL;
+        }
+        obj = cache->objects[c][--cache->count[c]];
+    }
+    metrics_inc(M_SLAB_ALLOCS);
+    return obj;
+}
+
+void slab_free(void *ptr, size_t size) {
+    if (!ptr) return;
+    int c = class_of(size);
+    if (c < 0) {
+        free(ptr);
+        return;
+    }
+    metrics_inc(M_SLAB_FREES);
+
+    SlabCache *cache = get_cache();
+    if (!cache) {
+        pool_put(c, &ptr, 1);
+        return;
+    }
+    if (cache->count[c] == SLAB_CACHE_SIZE) {
+        // Cache plein : la moitié la plus ancienne retourne dans la liste commune
+        pool_put(c, cache->objects[c], SLAB_BATCH);
+        for (int i = SLAB_BATCH; i < SLAB_CACHE_SIZE; i++) {
+            cache->objects[c][i - SLAB_BATCH] = cache->objects[c][i];
+        }
+        cache->count[c] = SLAB_CACHE_SIZE - SLAB_BATCH;
+    }
+    cache->objects[c][cache->count[c]++] = ptr;
+}
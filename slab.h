@@ -0,0 +1,28 @@
+// slab.h
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+#define SLAB_PAGE_SIZE    (64 * 1024)  // Page découpée en objets d'une même classe
+#define SLAB_CACHE_SIZE   32           // Objets gardés par thread et par classe
+#define SLAB_MAX_SIZE     4096         // Au-delà : malloc (compté dans slab_large)
+
+// Allocateur par classes de taille (64, 256, 1024, 4096 octets) pour les objets
+// des chemins fréquents : tableaux de membres des salons, arguments des
+// transferts. Chaque thread garde un petit cache par classe ; le verrou d'une
+// classe n'est pris que pour remplir ou vider ce cache. Les pages ne sont jamais
+// rendues au système.
+
+// Objet d'au moins size octets, aligné sur 64 octets si size <= SLAB_MAX_SIZE.
+// NULL si la mémoire manque.
+void *slab_alloc(size_t size);
+
+// Libère un objet de slab_alloc ; size doit être celle passée à l'allocation
+// (ou toute valeur de la même classe, voir slab_usable_size)
+void  slab_free(void *ptr, size_t size);
+
+// Taille réellement réservée pour une demande de size octets
+size_t slab_usable_size(size_t size);
+
+#endif /* SLAB_H */
@@ -0,0 +1,164 @@
+// stats.c
+#include "stats.h"
+#include "egress.h"
+
+// Échantillon publié par séquence (seqlock) : un seul écrivain, les lecteurs
+// recopient puis recommencent si une publication a eu lieu entre-temps
+static struct {
+    unsigned int seq;   // Impair pendant une écriture
+    StatsSnapshot data;
+} published;
+
+static pthread_t sampler_thread;
+static int sampler_started = 0;
+
+static void publish(const StatsSnapshot *snapshot) {
+    unsigned int seq = __atomic_load_n(&published.seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&published.seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&published.data, snapshot, sizeof(StatsSnapshot));
+    __atomic_store_n(&published.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int stats_read(StatsSnapshot *snapshot) {
+    unsigned int before, after;
+    do {
+        before = __atomic_load_n(&published.seq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(snapshot, &published.data, sizeof(StatsSnapshot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&published.seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+
+    return before == 0 ? -1 : 0;
+}
+
+// Latences de l'intervalle : différence entre deux histogrammes cumulés
+static void window_percentiles(const MetricsHistogramData *now, const MetricsHistogramData *prev,
+                               StatsSnapshot *out) {
+    MetricsHistogramData window;
+    window.count = now->count - prev->count;
+    window.sum = now->sum - prev->sum;
+    window.max = now->max;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        window.buckets[b] = now->buckets[b] - prev->buckets[b];
+    }
+    out->window_requests = window.count;
+    out->p50_ns = metrics_percentile(&window, 0.50);
+    out->p99_ns = metrics_percentile(&window, 0.99);
+}
+
+// Relevé de l'état du serveur : les verrous ne sont tenus que le temps d'un comptage
+static void sample_server(Server *server, StatsSnapshot *out) {
+    lock_clients(server);
+    out->registered_clients = server->client_count;
+    out->connected_clients = 0;
+    for (int i = 0; i < server->client_count; i++) {
+        if (server->client_hot[i].connected) out->connected_clients++;
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    lock_salons(server);
+    out->nb_rooms = server->nb_salons;
+    out->nb_top_rooms = 0;
+    for (int i = 0; i < server->nb_salons; i++) {
+        int members = server->salons[i].nb_membres;
+
+        // Insertion dans le classement des plus grands salons
+        int pos = out->nb_top_rooms;
+        while (pos > 0 && out->top_rooms[pos - 1].nb_membres < members) pos--;
+        if (pos >= STATS_TOP_ROOMS) continue;
+
+        int last = out->nb_top_rooms < STATS_TOP_ROOMS ? out->nb_top_rooms : STATS_TOP_ROOMS - 1;
+        memmove(&out->top_rooms[pos + 1], &out->top_rooms[pos],
+                sizeof(StatsRoom) * (size_t)(last - pos));
+        strncpy(out->top_rooms[pos].nom, server->salons[i].nom, MAX_NOM_SALON - 1);
+        out->top_rooms[pos].nom[MAX_NOM_SALON - 1] = '\0';
+        out->top_rooms[pos].nb_membres = members;
+        if (out->nb_top_rooms < STATS_TOP_ROOMS) out->nb_top_rooms++;
+    }
+    pthread_mutex_unlock(&server->salons_mutex);
+}
+
+static void *stats_sampler_thread(void *arg) {
+    Server *server = (Server *)arg;
+
+    MetricsSnapshot *prev = malloc(sizeof(MetricsSnapshot));
+    MetricsSnapshot *now = malloc(sizeof(MetricsSnapshot));
+    if (!prev || !now) {
+        perror("Échec malloc statistiques");
+        free(prev);
+        free(now);
+        return NULL;
+    }
+
+    metrics_snapshot(prev);
+    uint64_t prev_ns = metrics_now_ns();
+
+    while (running) {
+        sleep(STATS_SAMPLE_INTERVAL);
+        if (!running) break;
+
+        StatsSnapshot out;
+        memset(&out, 0, sizeof(out));
+
+        // Relevé en premier pour que ses acquisitions de verrous soient comptées
+        sample_server(server, &out);
+
+        metrics_snapshot(now);
+        uint64_t now_ns = metrics_now_ns();
+        double elapsed = (double)(now_ns - prev_ns) / 1e9;
+        if (elapsed <= 0) elapsed = STATS_SAMPLE_INTERVAL;
+
+        out.sampled_at = time(NULL);
+        out.interval = elapsed;
+
+#define RATE(c) ((double)(now->counters[c] - prev->counters[c]) / elapsed)
+        out.requests_per_sec = RATE(M_REQUESTS_RECEIVED);
+        out.bytes_in_per_sec = RATE(M_BYTES_RECEIVED);
+        out.responses_per_sec = RATE(M_RESPONSES_SENT);
+        out.bytes_out_per_sec = RATE(M_BYTES_SENT);
+        out.broadcasts_per_sec = RATE(M_MESSAGES_BROADCAST);
+#undef RATE
+
+        window_percentiles(&now->histograms[H_PROCESS_REQUEST],
+                           &prev->histograms[H_PROCESS_REQUEST], &out);
+
+        out.active_uploads = metrics_gauge_get(G_ACTIVE_UPLOADS);
+        out.active_downloads = metrics_gauge_get(G_ACTIVE_DOWNLOADS);
+        out.egress_pending = egress_pending();
+        out.egress_queue_full = now->counters[M_EGRESS_QUEUE_FULL];
+
+        out.clients_lock_acquired = now->counters[M_CLIENTS_LOCK_ACQUIRED];
+        out.clients_lock_contended = now->counters[M_CLIENTS_LOCK_CONTENDED];
+        out.salons_lock_acquired = now->counters[M_SALONS_LOCK_ACQUIRED];
+        out.salons_lock_contended = now->counters[M_SALONS_LOCK_CONTENDED];
+
+        publish(&out);
+
+        MetricsSnapshot *tmp = prev;
+        prev = now;
+        now = tmp;
+        prev_ns = now_ns;
+    }
+
+    free(prev);
+    free(now);
+    return NULL;
+}
+
+int init_stats(Server *server) {
+    if (pthread_create(&sampler_thread, NULL, stats_sampler_thread, server) != 0) {
+        perror("Erreur lors de la création du thread des statistiques");
+        return -1;
+    }
+    sampler_started = 1;
+    return 0;
+}
+
+void shutdown_stats(void) {
+    if (sampler_started) {
+        pthread_join(sampler_thread, NULL);
+        sampler_started = 0;
+    }
+}
@@ -0,0 +1,58 @@
+// stats.h
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "server.h"
+
+#define STATS_SAMPLE_INTERVAL  1   // Secondes entre deux échantillons
+#define STATS_TOP_ROOMS        5   // Nombre de salons affichés par @stats
+
+typedef struct {
+    char nom[MAX_NOM_SALON];
+    int nb_membres;
+} StatsRoom;
+
+// Dernier échantillon publié par le thread d'échantillonnage
+typedef struct {
+    time_t sampled_at;
+    double interval;             // Durée couverte par les débits (secondes)
+
+    double requests_per_sec;     // Entrée
+    double bytes_in_per_sec;
+    double responses_per_sec;    // Sortie
+    double bytes_out_per_sec;
+    double broadcasts_per_sec;
+
+    uint64_t window_requests;    // Requêtes traitées pendant l'intervalle
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+
+    int connected_clients;
+    int registered_clients;
+    int nb_rooms;
+    StatsRoom top_rooms[STATS_TOP_ROOMS];
+    int nb_top_rooms;
+
+    int64_t active_uploads;
+    int64_t active_downloads;
+
+    uint64_t egress_pending;       // Datagrammes en attente d'envoi
+    uint64_t egress_queue_full;    // Attentes faute de place en file (cumul)
+
+    uint64_t clients_lock_acquired;
+    uint64_t clients_lock_contended;
+    uint64_t salons_lock_acquired;
+    uint64_t salons_lock_contended;
+} StatsSnapshot;
+
+// Démarre le thread qui échantillonne les métriques et l'état du serveur
+int  init_stats(Server *server);
+void shutdown_stats(void);
+
+// Copie le dernier échantillon sans prendre de verrou.
+// Retourne -1 si aucun échantillon n'est encore disponible.
+int  stats_read(StatsSnapshot *snapshot);
+
+#endif /* STATS_H */
@@ -0,0 +1,195 @@
+// timer.c
+// Roue de temporisation hiérarchique partagée par tout le serveur. Le niveau 0
+// couvre les 64 prochains intervalles, chaque niveau suivant 64 fois plus ; un
+// minuteur redescend d'un niveau quand le niveau inférieur a fait un tour.
+// Armer et désarmer coûtent O(1) ; les rappels s'exécutent sur un seul thread.
+#include "timer.h"
+#include "metrics.h"
+#include <time.h>
+
+#define TIMER_SLOT_MASK  (TIMER_SLOTS - 1)
+#define TIMER_TICK_NS    ((uint64_t)TIMER_TICK_MS * 1000000ULL)
+#define TIMER_MAX_TICKS  ((1ULL << (TIMER_LEVEL_BITS * TIMER_LEVELS)) - 1)
+
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_done = PTHREAD_COND_INITIALIZER;
+static Timer *wheel[TIMER_LEVELS][TIMER_SLOTS];
+static Timer *expired;           // Échus, en attente d'exécution
+static uint64_t current_tick;    // Prochain intervalle à traiter
+static uint64_t base_ns;         // Instant de l'intervalle 0
+static Timer *running_timer;     // Minuteur dont le rappel s'exécute
+
+static pthread_t timer_thread;
+static int timer_started = 0;
+static int timer_stopping = 0;
+
+static void link_timer(Timer **head, Timer *timer) {
+    timer->next = *head;
+    if (timer->next) timer->next->pprev = &timer->next;
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void unlink_timer(Timer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Les fonctions suivantes sont appelées avec timer_mutex verrouillé
+
+static void ensure_base(void) {
+    if (base_ns == 0) base_ns = metrics_now_ns();
+}
+
+// Range le minuteur au niveau dont la portée couvre son échéance
+static void wheel_insert(Timer *timer) {
+    if (timer->expires < current_tick) timer->expires = current_tick;
+    uint64_t delta = timer->expires - current_tick;
+    if (delta > TIMER_MAX_TICKS) {
+        timer->expires = current_tick + TIMER_MAX_TICKS;
+        delta = TIMER_MAX_TICKS;
+    }
+
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= 1ULL << (TIMER_LEVEL_BITS * (level + 1))) {
+        level++;
+    }
+    uint64_t slot = (timer->expires >> (TIMER_LEVEL_BITS * level)) & TIMER_SLOT_MASK;
+    link_timer(&wheel[level][slot], timer);
+}
+
+// Redistribue l'intervalle courant d'un niveau dans les niveaux inférieurs
+static void cascade(int level) {
+    uint64_t slot = (current_tick >> (TIMER_LEVEL_BITS * level)) & TIMER_SLOT_MASK;
+    Timer *list = wheel[level][slot];
+    wheel[level][slot] = NULL;
+    while (list) {
+        Timer *timer = list;
+        list = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        wheel_insert(timer);
+    }
+}
+
+// Traite l'intervalle current_tick : les échus passent dans la liste expired
+static void advance(void) {
+    uint64_t slot = current_tick & TIMER_SLOT_MASK;
+    if (slot == 0) {
+        for (int level = 1; level < TIMER_LEVELS; level++) {
+            cascade(level);
+            if (((current_tick >> (TIMER_LEVEL_BITS * level)) & TIMER_SLOT_MASK) != 0) break;
+        }
+    }
+
+    Timer *timer;
+    while ((timer = wheel[0][slot]) != NULL) {
+        unlink_timer(timer);
+        link_timer(&expired, timer);
+    }
+    current_tick++;
+}
+
+// Exécute les rappels hors verrou : un rappel peut réarmer son propre minuteur
+static void run_expired(void) {
+    Timer *timer;
+    while ((timer = expired) != NULL) {
+        unlink_timer(timer);
+        running_timer = timer;
+        TimerCallback callback = timer->callback;
+        void *arg = timer->arg;
+        pthread_mutex_unlock(&timer_mutex);
+
+        callback(arg);
+        metrics_inc(M_TIMERS_FIRED);
+
+        pthread_mutex_lock(&timer_mutex);
+        running_timer = NULL;
+        pthread_cond_broadcast(&timer_done);
+    }
+}
+
+static void *timer_thread_main(void *arg) {
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!__atomic_load_n(&timer_stopping, __ATOMIC_ACQUIRE)) {
+        next.tv_nsec += (long)TIMER_TICK_NS;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&timer_mutex);
+        uint64_t target = (metrics_now_ns() - base_ns) / TIMER_TICK_NS;
+        while (current_tick <= target) advance();
+        run_expired();
+        pthread_mutex_unlock(&timer_mutex);
+    }
+    return NULL;
+}
+
+int init_timers(void) {
+    pthread_mutex_lock(&timer_mutex);
+    ensure_base();
+    pthread_mutex_unlock(&timer_mutex);
+
+    timer_stopping = 0;
+    if (pthread_create(&timer_thread, NULL, timer_thread_main, NULL) != 0) {
+        perror("Erreur lors de la création du thread des minuteurs");
+        return -1;
+    }
+    timer_started = 1;
+    return 0;
+}
+
+void shutdown_timers(void) {
+    if (!timer_started) return;
+    __atomic_store_n(&timer_stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(timer_thread, NULL);
+    timer_started = 0;
+}
+
+void timer_init(Timer *timer, TimerCallback callback, void *arg) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+void timer_schedule(Timer *timer, uint64_t delay_ms) {
+    pthread_mutex_lock(&timer_mutex);
+    ensure_base();
+    if (timer->pprev) unlink_timer(timer);
+
+    // Arrondi par excès : un minuteur n'expire jamais avant son délai
+    uint64_t deadline_ns = metrics_now_ns() - base_ns + delay_ms * 1000000ULL;
+    timer->expires = (deadline_ns + TIMER_TICK_NS - 1) / TIMER_TICK_NS;
+    wheel_insert(timer);
+    pthread_mutex_unlock(&timer_mutex);
+}
+
+int timer_cancel(Timer *timer) {
+    pthread_mutex_lock(&timer_mutex);
+    int pending = timer->pprev != NULL;
+    if (pending) unlink_timer(timer);
+    pthread_mutex_unlock(&timer_mutex);
+    return pending;
+}
+
+int timer_cancel_sync(Timer *timer) {
+    pthread_mutex_lock(&timer_mutex);
+    int pending = timer->pprev != NULL;
+    if (pending) unlink_timer(timer);
+    // Un rappel qui se désarme lui-même ne s'attend pas
+    while (running_timer == timer && !pthread_equal(pthread_self(), timer_thread)) {
+        pthread_cond_wait(&timer_done, &timer_mutex);
+    }
+    pthread_mutex_unlock(&timer_mutex);
+    return pending;
+}
@@ -0,0 +1,43 @@
+// timer.h
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "common.h"
+
+#define TIMER_TICK_MS     10     // Résolution de la roue
+#define TIMER_LEVEL_BITS  6
+#define TIMER_SLOTS       (1 << TIMER_LEVEL_BITS)  // Intervalles par niveau
+#define TIMER_LEVELS      4      // Horizon : 64^4 intervalles, environ 46 heures
+
+typedef void (*TimerCallback)(void *arg);
+
+// Minuteur intrusif : la structure appartient à l'appelant et doit rester valide
+// tant qu'il est armé (ou que son rappel s'exécute, voir timer_cancel_sync)
+typedef struct Timer {
+    struct Timer *next;
+    struct Timer **pprev;    // Lien qui pointe sur ce minuteur, NULL s'il n'est pas armé
+    uint64_t expires;        // Intervalle d'échéance
+    TimerCallback callback;
+    void *arg;
+} Timer;
+
+// Démarre le thread qui fait avancer la roue et exécute les rappels
+int  init_timers(void);
+void shutdown_timers(void);
+
+void timer_init(Timer *timer, TimerCallback callback, void *arg);
+
+// Arme (ou réarme) le minuteur. Utilisable avant init_timers : les échéances
+// passées sont traitées au démarrage du thread.
+void timer_schedule(Timer *timer, uint64_t delay_ms);
+
+// Désarme le minuteur en O(1). Retourne 1 s'il était armé. Un rappel déjà en
+// cours d'exécution n'est pas attendu : il doit revalider son état.
+int  timer_cancel(Timer *timer);
+
+// Comme timer_cancel, mais attend la fin d'un rappel en cours. À utiliser avant
+// de libérer la structure ; jamais avec un verrou que le rappel prend.
+int  timer_cancel_sync(Timer *timer);
+
+#endif /* TIMER_H */